@@ -0,0 +1,844 @@
+// Benchmarks de la app, fuera de la compilación normal (todo el fichero va dentro de EOLE_BENCHMARK)
+// Sin Qt (CRC, codec, búsqueda de tramas y ida y vuelta por un pty contra el emulador):
+//   g++ -O2 -std=c++17 -pthread -DEOLE_BENCHMARK crc16.cpp readframes.cpp emulator.cpp serialreactor.cpp transport.cpp tracing.cpp
+//       metrics.cpp rttestimator.cpp benchmark.cpp -o eole_benchmark
+// Con Qt además mide el manejador completo: añadir -DEOLE_BENCHMARK_QT y compilar junto a manager.cpp, serialworker.cpp,
+// serialmanager.cpp, qserialtransport.cpp, lowlatency.cpp, registercache.cpp, transactionscheduler.cpp, logqueue.cpp, logging.cpp y capturewriter.cpp
+// (con moc de manager.h y serialworker.h, Qt6Core y Qt6SerialPort)
+// Uso: eole_benchmark [--json fichero] [--latency-us N] [--iterations N] [--links N]
+
+#ifdef EOLE_BENCHMARK
+
+#include "crc16.h"
+#include "packetcodec.h"
+#include "readframes.h"
+#include "emulator.h"
+#include "serialreactor.h"
+#include "transport.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#ifdef EOLE_BENCHMARK_QT
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <iostream>
+#include <sstream>
+#include "manager.h"
+#include "qserialtransport.h"
+#endif
+
+using namespace std;
+
+#define BENCHMARK_DEFAULT_JSON "benchmark_results.json" // Resultados para comparar entre versiones
+#define BENCHMARK_DEFAULT_ITERATIONS 2000 // Transacciones por prueba macro
+#define BENCHMARK_MICRO_BATCHES 2000 // Lotes por prueba micro (cada lote da una muestra)
+#define BENCHMARK_MICRO_BATCH_SIZE 1000 // Operaciones por lote, para que el reloj tenga resolución de sobra
+#define BENCHMARK_IO_TIMEOUT 1000 // Timeout de cada respuesta en las pruebas por pty (ms)
+#define BENCHMARK_DEFAULT_LINKS 16 // Sensores emulados a la vez en las pruebas de muchos puertos
+#define BENCHMARK_BRIDGE_POLL_TIME 50 // Cada cuánto (ms) mira el puente de sockets si tiene que parar
+#define BENCHMARK_BULK_BACKLOG 256 // Lecturas masivas que se mantienen encoladas mientras se miden las escrituras interactivas
+#define BENCHMARK_BULK_FIRST_ADDRESS 0x400 // Registros sin uso (el emulador contesta 0), cada lectura del volcado va a uno distinto para que no se junten
+
+struct KnownCrc { // Trama y el CRC que tiene que salirle
+    vector<uint8_t> data;
+    uint16_t crc;
+};
+
+static const vector<KnownCrc> RECORDED_CRCS = { // Apuntados a mano en test.cpp
+    {{0x40, 0x90, 0x00, 0x00, 0x00, 0x98}, 0x6CCF}, // Lectura TINT
+    {{0x40, 0x90, 0x00, 0x00, 0x00, 0x94}, 0x69CF}, // Lectura TFRAME
+    {{0x40, 0x90, 0x00, 0x00, 0x00, 0x90}, 0xAACE}, // Lectura GPOL
+    {{0x40, 0x99, 0x00, 0x00, 0x00, 0x98, 0x00, 0x02, 0xB2, 0xA0}, 0x4140}, // Escritura TINT 0x2B2A0
+    {{0x40, 0x99, 0x00, 0x00, 0x00, 0x98, 0x00, 0x01, 0xE6, 0xB8}, 0x8B8E}, // Escritura TINT 0x1E6B8
+    {{0x40, 0x99, 0x00, 0x00, 0x00, 0x94, 0x00, 0x03, 0xBD, 0x08}, 0xCE05}, // Escritura TFRAME 0x3BD08
+    {{0x40, 0x99, 0x00, 0x00, 0x00, 0x94, 0x00, 0x03, 0x46, 0x16}, 0xF6C6}, // Escritura TFRAME 0x34616
+    {{0x40, 0x99, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x07, 0x08}, 0x6E77}, // Escritura GPOL 0x708
+    {{0x40, 0x99, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x08, 0x52}, 0xA5F2} // Escritura GPOL 0x852
+};
+
+// Calculados con el propio algoritmo, no comprobados en ningún otro sitio: solo avisan si una variante deja de dar lo mismo
+// (test.cpp no tiene las lecturas de MCK y OUTPUT, y para la escritura de GPOL 0x2B2A0 y la respuesta con 0x3BD08 apunta otros
+// valores marcados como INCORRECTO)
+static const vector<KnownCrc> COMPUTED_CRCS = {
+    {{0x40, 0x90, 0x00, 0x00, 0x00, 0x28}, 0xD8CE}, // Lectura MCK
+    {{0x40, 0x90, 0x00, 0x00, 0x00, 0xB0}, 0x72CF}, // Lectura OUTPUT
+    {{0x40, 0x99, 0x00, 0x00, 0x00, 0x90, 0x00, 0x02, 0xB2, 0xA0}, 0x80A1}, // Escritura GPOL 0x2B2A0
+    {{0x40, 0x80, 0x00, 0x03, 0xBD, 0x08}, 0x938F} // Respuesta OK con 0x3BD08
+};
+
+static const CRCVARIANT VARIANTS[] = {CRC_BITWISE, CRC_TABLE, CRC_SLICING4, CRC_SLICING8, CRC_CLMUL};
+
+// Lo mismo que pide updateValues al conectar: TINT, OUTPUT, MCK, TFRAME y GPOL
+static const int CONNECT_ADDRESSES[] = {INT_TIME_ADDRESS, OUTPUT_ADDRESS, MCK_ADDRESS, INT_PERIOD_ADDRESS, GPOL_ADDRESS};
+#define CONNECT_READS 5
+
+struct BenchmarkResult { // Una fila del informe
+    string layer;          // micro, pty o manager
+    string name;           // Qué se ha medido
+    size_t operations;     // Operaciones medidas en total
+    double p50Ns;          // Mediana por operación
+    double p99Ns;          // Percentil 99 por operación
+    double maxNs;          // Peor caso por operación
+    double opsPerSecond;   // Operaciones (transacciones en macro) por segundo
+};
+
+static vector<BenchmarkResult> benchmarkResults;
+static volatile uint32_t benchmarkSink; // Evita que el compilador se salte los bucles medidos
+
+static double nowNs() {
+    return chrono::duration<double, nano>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double percentile(const vector<double> &sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[min(index, sorted.size() - 1)];
+}
+
+static void record(const string &layer, const string &name, vector<double> samplesNs, size_t operationsPerSample, double totalNs) {
+    // Cada muestra es el tiempo de operationsPerSample operaciones, el informe es siempre por operación
+    BenchmarkResult result;
+    result.layer = layer;
+    result.name = name;
+    result.operations = samplesNs.size() * operationsPerSample;
+
+    for (double &sample : samplesNs) sample /= operationsPerSample;
+    sort(samplesNs.begin(), samplesNs.end());
+    result.p50Ns = percentile(samplesNs, 0.50);
+    result.p99Ns = percentile(samplesNs, 0.99);
+    result.maxNs = samplesNs.empty() ? 0.0 : samplesNs.back();
+    result.opsPerSecond = totalNs > 0 ? result.operations * 1e9 / totalNs : 0.0;
+    benchmarkResults.push_back(result);
+
+    printf("  %-7s %-34s p50 %11.1f ns  p99 %11.1f ns  max %11.1f ns  %14.0f ops/s\n", layer.c_str(), name.c_str(),
+           result.p50Ns, result.p99Ns, result.maxNs, result.opsPerSecond);
+}
+
+template <typename Function>
+static void runMicro(const string &name, Function function) {
+    // Operaciones de nanosegundos: se mide por lotes y cada lote es una muestra
+    vector<double> samples;
+    samples.reserve(BENCHMARK_MICRO_BATCHES);
+    size_t operation = 0;
+
+    for (size_t i = 0; i < BENCHMARK_MICRO_BATCH_SIZE * 10; ++i) function(operation++); // Calentamiento
+
+    double start = nowNs();
+    for (size_t batch = 0; batch < BENCHMARK_MICRO_BATCHES; ++batch) {
+        double batchStart = nowNs();
+        for (size_t i = 0; i < BENCHMARK_MICRO_BATCH_SIZE; ++i) function(operation++);
+        samples.push_back(nowNs() - batchStart);
+    }
+    record("micro", name, samples, BENCHMARK_MICRO_BATCH_SIZE, nowNs() - start);
+}
+
+static bool checkKnownValues() {
+    bool ok = true;
+
+    for (CRCVARIANT variant : VARIANTS) {
+        for (const vector<KnownCrc> *list : {&RECORDED_CRCS, &COMPUTED_CRCS}) {
+            for (const KnownCrc &known : *list) {
+                uint16_t crc = crc16Compute(variant, known.data.data(), known.data.size());
+                if (crc != known.crc) {
+                    printf("FAIL %s: got 0x%04X, expected 0x%04X (%s)\n", crc16VariantName(variant), crc, known.crc,
+                           list == &RECORDED_CRCS ? "recorded in test.cpp" : "computed");
+                    ok = false;
+                }
+            }
+        }
+    }
+
+    // Todas las longitudes y alineaciones contra la versión bit a bit (los restos de CLMUL y slicing son lo delicado)
+    vector<uint8_t> buffer(1024 + 8);
+    uint32_t seed = 12345;
+    for (uint8_t &byte : buffer) {
+        seed = seed * 1103515245 + 12345;
+        byte = static_cast<uint8_t>(seed >> 16);
+    }
+    for (size_t offset = 0; offset < 8; ++offset) {
+        for (size_t size = 0; size <= 1024; ++size) {
+            uint16_t expected = crc16Bitwise(buffer.data() + offset, size);
+            for (CRCVARIANT variant : VARIANTS) {
+                if (crc16Compute(variant, buffer.data() + offset, size) != expected) {
+                    printf("FAIL %s: size %zu offset %zu\n", crc16VariantName(variant), size, offset);
+                    ok = false;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+static vector<uint8_t> makeResponses(size_t count, size_t garbageBetween) {
+    // Respuestas válidas seguidas, opcionalmente con basura delante de cada una (incluidos 0x40 falsos)
+    vector<uint8_t> stream;
+    uint32_t seed = 777;
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t g = 0; g < garbageBetween; ++g) {
+            seed = seed * 1103515245 + 12345;
+            stream.push_back((g % 3 == 0) ? PACKET_HEADER_BYTE : static_cast<uint8_t>(seed >> 16));
+        }
+        uint8_t response[RESPONSE_SIZE] = {PACKET_HEADER_BYTE, PACKET_STATUS_OK};
+        storeBigEndian32(response + 2, static_cast<uint32_t>(i * 2654435761u));
+        sealPacket(response, RESPONSE_SIZE);
+        stream.insert(stream.end(), response, response + RESPONSE_SIZE);
+    }
+    return stream;
+}
+
+static void benchmarkMicro() {
+    printf("\nMicro\n");
+
+    // CRC de cada variante con el tamaño de las lecturas y respuestas (6 bytes) y de las escrituras (10 bytes)
+    vector<uint8_t> messages(16 * 256);
+    for (size_t i = 0; i < messages.size(); ++i) messages[i] = static_cast<uint8_t>(i * 7 + 3);
+    for (size_t payload : {size_t(6), size_t(10)}) {
+        for (CRCVARIANT variant : VARIANTS) {
+            runMicro(string("crc/") + crc16VariantName(variant) + "/" + to_string(payload) + "B", [&](size_t i) {
+                benchmarkSink += crc16Compute(variant, messages.data() + (i & 0xFF) * 16, payload);
+            });
+        }
+    }
+    runMicro("crc/active(" + string(crc16VariantName(crc16ActiveVariant())) + ")/6B", [&](size_t i) {
+        benchmarkSink += crc16Compute(messages.data() + (i & 0xFF) * 16, 6);
+    });
+
+    // Validación por lotes (por trama)
+    vector<uint8_t> frames = makeResponses(4096, 0);
+    vector<uint8_t> valid(4096);
+    for (CRCVARIANT variant : {CRC_TABLE, CRC_SLICING4, CRC_CLMUL}) {
+        vector<double> samples;
+        double start = nowNs();
+        for (int round = 0; round < 200; ++round) {
+            double roundStart = nowNs();
+            benchmarkSink += static_cast<uint32_t>(crc16ValidateFrames(variant, frames.data(), RESPONSE_SIZE, 4096, valid.data()));
+            samples.push_back(nowNs() - roundStart);
+        }
+        record("micro", string("crc/batch-validate/") + crc16VariantName(variant), samples, 4096, nowNs() - start);
+    }
+
+    // Codificación de peticiones
+    runMicro("encode/read-request", [&](size_t i) {
+        ReadRequest request(static_cast<uint32_t>(i & 0xFFF));
+        benchmarkSink += request.bytes[7];
+    });
+    runMicro("encode/write-request", [&](size_t i) {
+        WriteRequest request(INT_TIME_ADDRESS, static_cast<uint32_t>(i));
+        benchmarkSink += request.bytes[11];
+    });
+    ReadFrameCache frameCache;
+    runMicro("encode/read-frame-cache/known", [&](size_t i) {
+        benchmarkSink += frameCache.lookup(CONNECT_ADDRESSES[i % CONNECT_READS])[7];
+    });
+    runMicro("encode/read-frame-cache/custom", [&](size_t i) {
+        benchmarkSink += frameCache.lookup(0x100 + static_cast<int>(i & 3))[7];
+    });
+
+    // Decodificación y búsqueda de tramas
+    runMicro("parse/decode-response", [&](size_t i) {
+        uint32_t value = 0;
+        benchmarkSink += decodeResponse(frames.data() + (i & 4095) * RESPONSE_SIZE, value) + value;
+    });
+
+    for (size_t garbage : {size_t(0), size_t(3), size_t(16)}) {
+        vector<uint8_t> stream = makeResponses(4096, garbage);
+        string name = garbage == 0 ? "parse/find-frame/clean" : "resync/find-frame/" + to_string(garbage) + "B-garbage";
+        size_t offset = 0;
+        runMicro(name, [&](size_t) {
+            size_t frameStart = 0;
+            size_t consumed = 0;
+            FRAMESEARCH search = findResponseFrame(stream.data() + offset, stream.size() - offset, true, frameStart, consumed);
+            offset += consumed;
+            if (search == SEARCH_NEED_MORE || offset >= stream.size()) offset = 0;
+            benchmarkSink += search;
+        });
+    }
+}
+
+static int openClient(const string &portName) {
+    // Lado de la app con termios a pelo: 115200 8N1 en crudo, lo mismo que configura SerialManager::openPort
+    int fd = open(portName.c_str(), O_RDWR | O_NOCTTY);
+    if (fd < 0) return -1;
+
+    termios settings;
+    tcgetattr(fd, &settings);
+    cfmakeraw(&settings);
+    cfsetispeed(&settings, B115200);
+    cfsetospeed(&settings, B115200);
+    settings.c_cflag |= CLOCAL | CREAD;
+    tcsetattr(fd, TCSANOW, &settings);
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static bool clientReadResponses(int fd, size_t count) {
+    // Espera count respuestas completas usando la misma búsqueda de tramas que SerialManager
+    uint8_t buffer[RX_BUFFER_SIZE];
+    size_t length = 0;
+    size_t found = 0;
+
+    while (found < count) {
+        pollfd descriptor = {fd, POLLIN, 0};
+        if (poll(&descriptor, 1, BENCHMARK_IO_TIMEOUT) <= 0) return false;
+
+        ssize_t received = read(fd, buffer + length, sizeof(buffer) - length);
+        if (received <= 0) return false;
+        length += static_cast<size_t>(received);
+
+        while (true) {
+            size_t frameStart = 0;
+            size_t consumed = 0;
+            FRAMESEARCH search = findResponseFrame(buffer, length, true, frameStart, consumed);
+            memmove(buffer, buffer + consumed, length - consumed);
+            length -= consumed;
+            if (search == SEARCH_NEED_MORE) break;
+            found++;
+        }
+    }
+    return true;
+}
+
+static void benchmarkPty(size_t iterations, int latencyUs) {
+    printf("\nPty loopback against the emulator (latency %d us)\n", latencyUs);
+
+    EmulatorConfig config;
+    config.latencyUs = latencyUs;
+    EoleEmulator emulator(config);
+    if (!emulator.start()) return;
+
+    int fd = openClient(emulator.portName());
+    if (fd < 0) {
+        printf("  Could not open %s\n", emulator.portName().c_str());
+        return;
+    }
+
+    // Una lectura cada vez, esperando su respuesta
+    ReadFrameCache frameCache;
+    vector<double> samples;
+    size_t failures = 0;
+    double start = nowNs();
+    for (size_t i = 0; i < iterations; ++i) {
+        double transactionStart = nowNs();
+        if (write(fd, frameCache.lookup(INT_TIME_ADDRESS), READ_REQUEST_SIZE) != READ_REQUEST_SIZE || !clientReadResponses(fd, 1)) {
+            failures++;
+            continue;
+        }
+        samples.push_back(nowNs() - transactionStart);
+    }
+    record("pty", "round-trip/read", samples, 1, nowNs() - start);
+
+    // Secuencia de conexión: las 5 lecturas de updateValues en ráfaga y la escritura del periodo mínimo
+    uint8_t burst[READ_REQUEST_SIZE * CONNECT_READS];
+    for (size_t i = 0; i < CONNECT_READS; ++i) {
+        memcpy(burst + i * READ_REQUEST_SIZE, frameCache.lookup(CONNECT_ADDRESSES[i]), READ_REQUEST_SIZE);
+    }
+    samples.clear();
+    start = nowNs();
+    for (size_t i = 0; i < iterations / 4; ++i) {
+        double sequenceStart = nowNs();
+        WriteRequest period(INT_PERIOD_ADDRESS, EMULATOR_DEFAULT_TFRAME);
+        if (write(fd, burst, sizeof(burst)) != static_cast<ssize_t>(sizeof(burst)) || !clientReadResponses(fd, CONNECT_READS) ||
+            write(fd, period.data(), period.size()) != static_cast<ssize_t>(period.size()) || !clientReadResponses(fd, 1)) {
+            failures++;
+            continue;
+        }
+        samples.push_back(nowNs() - sequenceStart);
+    }
+    record("pty", "connect-sequence (6 transactions)", samples, 1, (nowNs() - start) / (CONNECT_READS + 1));
+
+    if (failures > 0) printf("  %zu failed transactions\n", failures);
+    close(fd);
+    emulator.stop();
+}
+
+#ifdef __linux__
+
+class SocketBridge { // Puente tipo ser2net: acepta una conexión TCP o Unix y pasa los bytes entre ella y el pty del emulador
+public:
+    ~SocketBridge() { stop(); }
+
+    bool start(const string &serialPath, bool unixSocket) {
+        serialFd = openClient(serialPath);
+        if (serialFd < 0) return false;
+
+        if (unixSocket) {
+            socketPath = "/tmp/eole_benchmark_" + to_string(getpid()) + ".sock";
+            unlink(socketPath.c_str());
+            sockaddr_un address = {};
+            address.sun_family = AF_UNIX;
+            memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) return false;
+            endpoint = TRANSPORT_UNIX_PREFIX + socketPath;
+        } else {
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port = 0; // El sistema elige un puerto libre
+            socklen_t length = sizeof(address);
+            listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+                getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length) != 0) return false;
+            endpoint = TRANSPORT_TCP_PREFIX + to_string(ntohs(address.sin_port));
+        }
+        if (listen(listenFd, 1) != 0) return false;
+
+        running = true;
+        relay = thread([this]() { run(); });
+        return true;
+    }
+
+    void stop() {
+        running = false;
+        if (relay.joinable()) relay.join();
+        if (clientFd >= 0) close(clientFd);
+        if (listenFd >= 0) close(listenFd);
+        if (serialFd >= 0) close(serialFd);
+        if (!socketPath.empty()) unlink(socketPath.c_str());
+        clientFd = listenFd = serialFd = -1;
+        socketPath.clear();
+    }
+
+    string address() const { return endpoint; } // Nombre de puerto para el transporte (tcp:puerto o unix:ruta)
+
+private:
+    void run() {
+        while (running && clientFd < 0) {
+            pollfd descriptor = {listenFd, POLLIN, 0};
+            if (poll(&descriptor, 1, BENCHMARK_BRIDGE_POLL_TIME) > 0) clientFd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        }
+        int noDelay = 1;
+        setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)); // En un socket Unix falla sin más
+
+        uint8_t buffer[RX_BUFFER_SIZE];
+        while (running) {
+            pollfd descriptors[2] = {{clientFd, POLLIN, 0}, {serialFd, POLLIN, 0}};
+            if (poll(descriptors, 2, BENCHMARK_BRIDGE_POLL_TIME) <= 0) continue;
+            for (int i = 0; i < 2; ++i) {
+                if (!(descriptors[i].revents & POLLIN)) continue;
+                ssize_t received = read(descriptors[i].fd, buffer, sizeof(buffer));
+                if (received <= 0) return; // El cliente cerró
+                ssize_t written = write(descriptors[1 - i].fd, buffer, static_cast<size_t>(received));
+                (void)written;
+            }
+        }
+    }
+
+    int listenFd = -1;       // Socket que espera la conexión
+    int clientFd = -1;       // Conexión aceptada
+    int serialFd = -1;       // Lado esclavo del pty del emulador
+    string socketPath;       // Ruta del socket Unix (vacía con TCP)
+    string endpoint;         // Lo que se le pasa al transporte
+    thread relay;            // Hilo que pasa los bytes
+    atomic<bool> running{false};
+};
+
+static void benchmarkTransport(const string &name, Transport &transport, const string &portName, size_t iterations) {
+    if (!transport.open(portName)) {
+        printf("  Could not open %s: %s\n", portName.c_str(), transport.errorString().c_str());
+        return;
+    }
+
+    // Lo mismo que hace el SerialManager por cada lectura: la petición ya codificada y esperar la trama con la misma búsqueda
+    ReadFrameCache frameCache;
+    uint8_t buffer[RX_BUFFER_SIZE];
+    vector<double> samples;
+    size_t failures = 0;
+    double start = nowNs();
+    for (size_t i = 0; i < iterations; ++i) {
+        double transactionStart = nowNs();
+        bool answered = transport.write(frameCache.lookup(INT_TIME_ADDRESS), READ_REQUEST_SIZE, BENCHMARK_IO_TIMEOUT);
+        size_t length = 0;
+        while (answered) {
+            int received = transport.read(buffer + length, sizeof(buffer) - length, BENCHMARK_IO_TIMEOUT);
+            if (received <= 0) {
+                answered = false;
+                break;
+            }
+            length += static_cast<size_t>(received);
+            size_t frameStart = 0;
+            size_t consumed = 0;
+            if (findResponseFrame(buffer, length, true, frameStart, consumed) == SEARCH_FRAME_OK) break;
+            memmove(buffer, buffer + consumed, length - consumed);
+            length -= consumed;
+        }
+        if (!answered) {
+            failures++;
+            continue;
+        }
+        samples.push_back(nowNs() - transactionStart);
+    }
+    record("transport", name + " round-trip/read", samples, 1, nowNs() - start);
+    if (failures > 0) printf("  %zu failed transactions\n", failures);
+    transport.close();
+}
+
+static void benchmarkTransports(size_t iterations, int latencyUs) {
+    printf("\nTransports against the emulator (latency %d us)\n", latencyUs);
+
+    EmulatorConfig config;
+    config.latencyUs = latencyUs;
+    EoleEmulator emulator(config);
+    if (!emulator.start()) return;
+
+    // Directo al pty, y después por un puente de sockets como ser2net (un salto más por el puente, como en la realidad)
+    TermiosTransport termiosTransport;
+    benchmarkTransport("termios", termiosTransport, emulator.portName(), iterations);
+#ifdef EOLE_BENCHMARK_QT
+    QSerialTransport qserialTransport;
+    benchmarkTransport("qserialport", qserialTransport, emulator.portName(), iterations);
+#endif
+
+    for (bool unixSocket : {false, true}) {
+        SocketBridge bridge;
+        if (!bridge.start(emulator.portName(), unixSocket)) {
+            printf("  Could not start the %s bridge\n", unixSocket ? "Unix socket" : "TCP");
+            continue;
+        }
+        SocketTransport socketTransport;
+        benchmarkTransport(unixSocket ? "unix" : "tcp", socketTransport, bridge.address(), iterations);
+        bridge.stop();
+    }
+    emulator.stop();
+}
+
+static void benchmarkReactor(size_t iterations, int latencyUs, size_t links) {
+    printf("\nEpoll reactor, %zu links on one thread (latency %d us)\n", links, latencyUs);
+
+    EmulatorConfig config;
+    config.latencyUs = latencyUs;
+    vector<unique_ptr<EoleEmulator>> emulators;
+    for (size_t i = 0; i < links; ++i) {
+        emulators.emplace_back(new EoleEmulator(config));
+        if (!emulators.back()->start()) return;
+    }
+
+    SerialReactor reactor;
+    if (!reactor.start()) return;
+
+    // Cada enlace lee en bucle cerrado (la siguiente lectura sale al llegar la respuesta), todos a la vez
+    // Los callbacks corren en el hilo del reactor, así que samples, starts y remaining solo se tocan desde allí
+    vector<double> samples;
+    vector<double> starts(links, 0.0);
+    vector<size_t> remaining(links, iterations / links);
+    vector<int> ids(links, -1);
+    size_t failures = 0;
+    size_t activeLinks = links;
+    promise<void> done;
+
+    for (size_t i = 0; i < links; ++i) {
+        ids[i] = reactor.openPort(emulators[i]->portName(), [&, i](const Transaction &transaction, const TransactionResult &result) {
+            if (result.status == TRANSACTION_OK) samples.push_back(nowNs() - starts[i]);
+            else failures++;
+
+            if (--remaining[i] == 0) {
+                if (--activeLinks == 0) done.set_value();
+                return;
+            }
+            starts[i] = nowNs();
+            reactor.submit(ids[i], transaction);
+        });
+        if (ids[i] < 0) {
+            printf("  Could not open %s\n", emulators[i]->portName().c_str());
+            return;
+        }
+    }
+
+    Transaction read;
+    read.type = READ_TRANSACTION;
+    read.address = INT_TIME_ADDRESS;
+    double start = nowNs();
+    for (size_t i = 0; i < links; ++i) {
+        starts[i] = nowNs();
+        reactor.submit(ids[i], read);
+    }
+    done.get_future().wait();
+    double total = nowNs() - start;
+
+    for (int id : ids) reactor.closePort(id);
+    reactor.stop();
+    record("reactor", "round-trip/read x" + to_string(links), samples, 1, total);
+    if (failures > 0) printf("  %zu failed transactions\n", failures);
+    for (unique_ptr<EoleEmulator> &emulator : emulators) emulator->stop();
+}
+
+#endif // __linux__
+
+#ifdef EOLE_BENCHMARK_QT
+
+static void benchmarkManagerLinks(size_t iterations, int latencyUs, size_t links, bool useReactor) {
+    // La misma carga que benchmarkReactor pero a través de manejadores: cada uno con su QSerialPort y su hilo, o todos sobre el reactor
+    const char *backend = useReactor ? "epoll reactor" : "QSerialPort";
+    printf("\nManager with the %s backend, %zu links (latency %d us)\n", backend, links, latencyUs);
+
+    EmulatorConfig config;
+    config.latencyUs = latencyUs;
+    vector<unique_ptr<EoleEmulator>> emulators;
+    for (size_t i = 0; i < links; ++i) {
+        emulators.emplace_back(new EoleEmulator(config));
+        if (!emulators.back()->start()) return;
+    }
+
+    // El manejador elige el backend al construirse
+    if (useReactor) qputenv(REACTOR_VARIABLE, REACTOR_BACKEND);
+    else qunsetenv(REACTOR_VARIABLE);
+
+    ostringstream discarded;
+    streambuf *console = cout.rdbuf(discarded.rdbuf());
+
+    vector<unique_ptr<manager>> managers;
+    QEventLoop loop;
+    size_t pendingOpens = links;
+    size_t openFailures = 0;
+    for (size_t i = 0; i < links; ++i) {
+        managers.emplace_back(new manager);
+        managers.back()->openPort(QString::fromStdString(emulators[i]->portName()), [&](bool opened) {
+            if (!opened) openFailures++;
+            if (--pendingOpens == 0) loop.quit();
+        });
+    }
+    loop.exec();
+    if (openFailures > 0) {
+        cout.rdbuf(console);
+        printf("  Could not open %zu ports\n", openFailures);
+        qunsetenv(REACTOR_VARIABLE);
+        return;
+    }
+
+    // Los callbacks llegan todos al hilo de la UI, aquí no hace falta proteger nada
+    vector<double> samples;
+    vector<double> starts(links, 0.0);
+    vector<size_t> remaining(links, iterations / links);
+    vector<function<void()>> next(links);
+    size_t failures = 0;
+    size_t activeLinks = links;
+    for (size_t i = 0; i < links; ++i) {
+        next[i] = [&, i]() {
+            if (remaining[i]-- == 0) {
+                if (--activeLinks == 0) loop.quit();
+                return;
+            }
+            starts[i] = nowNs();
+            managers[i]->readRegister(INT_TIME_ADDRESS, [&, i](const TransactionResult &result) {
+                if (result.status == TRANSACTION_OK) samples.push_back(nowNs() - starts[i]);
+                else failures++;
+                next[i]();
+            });
+        };
+    }
+    double start = nowNs();
+    for (size_t i = 0; i < links; ++i) next[i]();
+    loop.exec();
+    double total = nowNs() - start;
+
+    for (unique_ptr<manager> &eoleManager : managers) eoleManager->closePort();
+    managers.clear();
+    cout.rdbuf(console);
+    qunsetenv(REACTOR_VARIABLE);
+
+    record("manager", string(useReactor ? "reactor" : "qserialport") + " round-trip/read x" + to_string(links), samples, 1, total);
+    if (failures > 0) printf("  %zu failed transactions\n", failures);
+    for (unique_ptr<EoleEmulator> &emulator : emulators) emulator->stop();
+}
+
+static void benchmarkManager(size_t iterations, int latencyUs) {
+    printf("\nManager against the emulator (latency %d us)\n", latencyUs);
+
+    EmulatorConfig config;
+    config.latencyUs = latencyUs;
+    EoleEmulator emulator(config);
+    if (!emulator.start()) return;
+
+    // Los logs del camino serie se siguen formateando (al nivel por defecto, como en la app), pero no se escriben en la terminal del informe
+    ostringstream discarded;
+    streambuf *console = cout.rdbuf(discarded.rdbuf());
+
+    manager eoleManager;
+    QEventLoop loop;
+    bool opened = false;
+    eoleManager.openPort(QString::fromStdString(emulator.portName()), [&](bool result) { opened = result; loop.quit(); });
+    loop.exec();
+    if (!opened) {
+        cout.rdbuf(console);
+        printf("  Could not open %s\n", emulator.portName().c_str());
+        return;
+    }
+
+    // Lecturas de una en una: desde que se encola hasta que el callback llega al hilo de la UI
+    vector<double> samples;
+    size_t failures = 0;
+    size_t remaining = iterations;
+    double transactionStart = 0;
+    function<void()> next = [&]() {
+        if (remaining-- == 0) {
+            loop.quit();
+            return;
+        }
+        transactionStart = nowNs();
+        eoleManager.readRegister(INT_TIME_ADDRESS, [&](const TransactionResult &result) {
+            if (result.status == TRANSACTION_OK) samples.push_back(nowNs() - transactionStart);
+            else failures++;
+            next();
+        });
+    };
+    double start = nowNs();
+    next();
+    loop.exec();
+    double total = nowNs() - start;
+
+    // Secuencia de conexión: readRegisters como updateValues y después la escritura del periodo mínimo
+    vector<double> sequenceSamples;
+    vector<int> addresses(CONNECT_ADDRESSES, CONNECT_ADDRESSES + CONNECT_READS);
+    remaining = iterations / 4;
+    double sequenceStart = 0;
+    function<void()> nextSequence = [&]() {
+        if (remaining-- == 0) {
+            loop.quit();
+            return;
+        }
+        sequenceStart = nowNs();
+        eoleManager.readRegisters(addresses, [&](const RegisterResults &results) {
+            for (const auto &entry : results) {
+                if (entry.second.status != TRANSACTION_OK) failures++;
+            }
+            eoleManager.writeRegister(INT_PERIOD_ADDRESS, EMULATOR_DEFAULT_TFRAME, [&](const TransactionResult &result) {
+                if (result.status == TRANSACTION_OK) sequenceSamples.push_back(nowNs() - sequenceStart);
+                else failures++;
+                nextSequence();
+            });
+        });
+    };
+    double sequenceTotalStart = nowNs();
+    nextSequence();
+    loop.exec();
+    double sequenceTotal = nowNs() - sequenceTotalStart;
+
+    // Escrituras interactivas con un volcado saturando el enlace: el planificador las adelanta, no esperan a todo lo encolado
+    vector<double> underBulkSamples;
+    size_t bulkPending = 0;
+    size_t bulkIssued = 0;
+    bool bulkRunning = true;
+    function<void()> refillBulk = [&]() {
+        while (bulkRunning && bulkPending < BENCHMARK_BULK_BACKLOG) {
+            bulkPending++;
+            int address = BENCHMARK_BULK_FIRST_ADDRESS + static_cast<int>(bulkIssued++ % (2 * BENCHMARK_BULK_BACKLOG));
+            eoleManager.readRegister(address, [&](const TransactionResult &) {
+                bulkPending--;
+                if (bulkRunning) refillBulk();
+                else if (bulkPending == 0) loop.quit();
+            }, true, PRIORITY_BULK);
+        }
+    };
+    remaining = iterations / 4;
+    function<void()> nextWrite = [&]() {
+        if (remaining-- == 0) {
+            bulkRunning = false; // El bucle sigue hasta que termine lo que quedaba del volcado
+            return;
+        }
+        transactionStart = nowNs();
+        eoleManager.writeRegister(INT_PERIOD_ADDRESS, EMULATOR_DEFAULT_TFRAME, [&](const TransactionResult &result) {
+            if (result.status == TRANSACTION_OK) underBulkSamples.push_back(nowNs() - transactionStart);
+            else failures++;
+            nextWrite();
+        });
+    };
+    double underBulkStart = nowNs();
+    refillBulk();
+    nextWrite();
+    loop.exec();
+    double underBulkTotal = nowNs() - underBulkStart;
+
+    eoleManager.closePort();
+    cout.rdbuf(console);
+
+    record("manager", "round-trip/read", samples, 1, total);
+    record("manager", "connect-sequence (6 transactions)", sequenceSamples, 1, sequenceTotal / (CONNECT_READS + 1));
+    record("manager", "write/under-bulk-load", underBulkSamples, 1, underBulkTotal);
+    if (failures > 0) printf("  %zu failed transactions\n", failures);
+    emulator.stop();
+}
+
+#endif // EOLE_BENCHMARK_QT
+
+static bool writeJson(const string &path, int latencyUs) {
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    fprintf(file, "{\n  \"crc_variant\": \"%s\",\n  \"emulator_latency_us\": %d,\n  \"results\": [\n",
+            crc16VariantName(crc16ActiveVariant()), latencyUs);
+    for (size_t i = 0; i < benchmarkResults.size(); ++i) {
+        const BenchmarkResult &result = benchmarkResults[i];
+        fprintf(file, "    {\"layer\": \"%s\", \"name\": \"%s\", \"operations\": %zu, \"p50_ns\": %.1f, \"p99_ns\": %.1f, "
+                      "\"max_ns\": %.1f, \"ops_per_second\": %.1f}%s\n",
+                result.layer.c_str(), result.name.c_str(), result.operations, result.p50Ns, result.p99Ns, result.maxNs,
+                result.opsPerSecond, i + 1 < benchmarkResults.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+#ifdef EOLE_BENCHMARK_QT
+    QCoreApplication application(argc, argv);
+#endif
+
+    string jsonPath = BENCHMARK_DEFAULT_JSON;
+    size_t iterations = BENCHMARK_DEFAULT_ITERATIONS;
+    int latencyUs = 0; // Por defecto se mide solo el software, sin el tiempo de respuesta del sensor
+    size_t links = BENCHMARK_DEFAULT_LINKS;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i];
+        if (option == "--json") jsonPath = argv[i + 1];
+        else if (option == "--latency-us") latencyUs = atoi(argv[i + 1]);
+        else if (option == "--iterations") iterations = static_cast<size_t>(strtoul(argv[i + 1], nullptr, 10));
+        else if (option == "--links") links = max<size_t>(1, strtoul(argv[i + 1], nullptr, 10));
+    }
+
+    if (!checkKnownValues()) {
+        printf("CRC variants do not match the known values, not benchmarking.\n");
+        return 1;
+    }
+    printf("All CRC variants match the known values.\n");
+    printf("Active CRC variant: %s (CLMUL %s)\n", crc16VariantName(crc16ActiveVariant()),
+           crc16ClmulSupported() ? "available" : "not available");
+
+    benchmarkMicro();
+    benchmarkPty(iterations, latencyUs);
+#ifdef __linux__
+    benchmarkTransports(iterations, latencyUs);
+    benchmarkReactor(iterations, latencyUs, links);
+#endif
+#ifdef EOLE_BENCHMARK_QT
+    benchmarkManager(iterations, latencyUs);
+    benchmarkManagerLinks(iterations, latencyUs, links, false);
+    benchmarkManagerLinks(iterations, latencyUs, links, true);
+#endif
+
+    if (!writeJson(jsonPath, latencyUs)) {
+        printf("\nCould not write %s\n", jsonPath.c_str());
+        return 1;
+    }
+    printf("\nResults written to %s\n", jsonPath.c_str());
+    return 0;
+}
+
+#endif // EOLE_BENCHMARK
@@ -0,0 +1,766 @@
+// Analizador offline de las capturas binarias (.eolecap) que escribe la app con EOLE_CAPTURE=1, fuera de la compilación normal
+// (todo el fichero va dentro de EOLE_ANALYZER). Sin Qt, solo Linux/POSIX como el benchmark y el emulador:
+//   g++ -O2 -std=c++17 -pthread -DEOLE_ANALYZER crc16.cpp rttestimator.cpp captureanalyzer.cpp -o eole_analyzer
+// Uso: eole_analyzer captura.eolecap [--threads N]          informe de latencias, errores y accesos por registro
+//      eole_analyzer captura.eolecap --timeline [--speed X] cada transacción decodificada (con --speed, al ritmo original)
+//      eole_analyzer captura.eolecap --replay [--speed X] [--link PATH]
+//                                                          pty que contesta a la app con las respuestas capturadas
+//      eole_analyzer --self-test                           comprueba el emparejamiento con tráfico sintético (sin captura)
+
+#ifdef EOLE_ANALYZER
+
+#include "captureformat.h"
+#include "packetcodec.h"
+#include "metrics.h"
+#include "rttestimator.h"
+#include "values.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fcntl.h>
+#include <functional>
+#include <map>
+#include <poll.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+#define ANALYZER_WARMUP_BLOCKS 1 // Bloques que cada hilo decodifica antes de los suyos para llegar con las respuestas emparejadas
+#define ANALYZER_STATUSES 5 // Los cuatro DECODESTATUS más el timeout
+#define ANALYZER_TIMEOUT 4 // Estado de una petición sin respuesta a tiempo
+#define ANALYZER_OCTAVE_BUCKETS 16 // Buckets por cada potencia de 2 en el histograma fino de latencias (unos 4% de precisión)
+#define ANALYZER_OCTAVES 26 // Desde 1 us hasta unos 67 s
+#define ANALYZER_POLL_TIME 200 // Cada cuánto (ms) mira el modo replay si le han pedido parar
+
+struct MappedCapture { // Captura mapeada entera en memoria (solo lectura)
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    size_t blockSize = 0;
+    size_t blocks = 0;
+    CaptureFileHeader header = {};
+};
+
+struct PendingRequest { // Petición enviada que espera respuesta
+    int64_t sentNs = 0;
+    uint32_t address = 0;
+    uint32_t value = 0;  // Valor escrito (solo escrituras)
+    bool write = false;
+    bool owned = false;  // La envió un bloque de este hilo, solo esas cuentan en sus estadísticas
+    int retries = 0;     // Veces que la app ya la había mandado antes (0 en el primer intento)
+};
+
+struct DecodedTransaction { // Petición con su resultado, para el modo timeline
+    int64_t sentNs = 0;
+    int64_t answeredNs = 0; // 0 si no hubo respuesta
+    uint32_t address = 0;
+    bool write = false;
+    int status = DECODE_OK; // DECODESTATUS o ANALYZER_TIMEOUT
+    uint32_t value = 0;
+    int retries = 0;
+};
+
+class LatencyHistogram { // Buckets logarítmicos: se puede juntar el de cada hilo y sacar percentiles sin guardar cada muestra
+public:
+    void observe(int64_t ns) {
+        double us = ns / 1000.0;
+        int bucket = us <= 1.0 ? 0 : static_cast<int>(log2(us) * ANALYZER_OCTAVE_BUCKETS);
+        bucket = min(bucket, ANALYZER_OCTAVES * ANALYZER_OCTAVE_BUCKETS - 1);
+        fine[bucket]++;
+
+        double seconds = ns / 1e9;
+        int coarse = 0;
+        while (coarse < METRICS_LATENCY_BUCKETS && seconds > METRICS_LATENCY_BOUNDS[coarse]) ++coarse;
+        buckets[coarse]++;
+
+        samples++;
+        sumSeconds += seconds;
+        maxSeconds = max(maxSeconds, seconds);
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (size_t i = 0; i < fine.size(); ++i) fine[i] += other.fine[i];
+        for (size_t i = 0; i < buckets.size(); ++i) buckets[i] += other.buckets[i];
+        samples += other.samples;
+        sumSeconds += other.sumSeconds;
+        maxSeconds = max(maxSeconds, other.maxSeconds);
+    }
+
+    double percentile(double fraction) const {
+        // Límite superior del bucket donde cae el percentil (en segundos)
+        if (samples == 0) return 0.0;
+        uint64_t target = static_cast<uint64_t>(ceil(fraction * samples));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < fine.size(); ++i) {
+            seen += fine[i];
+            if (seen >= max<uint64_t>(target, 1)) {
+                return min(exp2(static_cast<double>(i + 1) / ANALYZER_OCTAVE_BUCKETS) / 1e6, maxSeconds);
+            }
+        }
+        return maxSeconds;
+    }
+
+    uint64_t count() const { return samples; }
+    double mean() const { return samples ? sumSeconds / samples : 0.0; }
+    double maximum() const { return maxSeconds; }
+    uint64_t bucket(int index) const { return buckets[index]; } // Mismos buckets que las métricas de la app
+
+private:
+    array<uint64_t, ANALYZER_OCTAVES * ANALYZER_OCTAVE_BUCKETS> fine = {};
+    array<uint64_t, METRICS_LATENCY_BUCKETS + 1> buckets = {};
+    uint64_t samples = 0;
+    double sumSeconds = 0;
+    double maxSeconds = 0;
+};
+
+struct RegisterAccess { // Accesos a un registro
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t failures = 0; // Cualquier estado que no sea OK
+};
+
+struct AnalyzerStats { // Lo que acumula cada hilo, luego se juntan en orden
+    uint64_t txRecords = 0;
+    uint64_t rxRecords = 0;
+    uint64_t txBytes = 0;
+    uint64_t rxBytes = 0;
+    uint64_t badRequestBytes = 0; // Bytes enviados que no forman una petición con CRC correcto
+    uint64_t unsolicited = 0;     // Respuestas sin ninguna petición pendiente
+    uint64_t resyncBytes = 0;     // Basura saltada al buscar respuestas
+    uint64_t skippedBadCrc = 0;   // Respuestas con CRC malo saltadas al resincronizar (en la app acaban en timeout)
+    uint64_t requeued = 0;        // Peticiones de una ráfaga que la app volvió a mandar porque falló una de delante
+    uint64_t drainedBytes = 0;    // Bytes que llegaron tarde, tras un timeout, y la app tiró antes de reenviar
+    array<uint64_t, 2> retries = {};   // [lectura/escritura] reenvíos de una petición que falló
+    array<uint64_t, 2> recovered = {}; // [lectura/escritura] reenvíos que acabaron bien
+    array<array<uint64_t, ANALYZER_STATUSES>, 2> statuses = {}; // [lectura/escritura][estado]
+    array<LatencyHistogram, 2> latencies;                     // [lectura/escritura], solo las que tuvieron respuesta
+    map<uint32_t, RegisterAccess> registers;
+    int64_t firstNs = 0; // Primer y último registro de la captura que ha visto el hilo
+    int64_t lastNs = 0;
+
+    void seen(int64_t timestampNs) {
+        if (firstNs == 0 || timestampNs < firstNs) firstNs = timestampNs;
+        lastNs = max(lastNs, timestampNs);
+    }
+
+    void merge(const AnalyzerStats &other) {
+        txRecords += other.txRecords;
+        rxRecords += other.rxRecords;
+        txBytes += other.txBytes;
+        rxBytes += other.rxBytes;
+        badRequestBytes += other.badRequestBytes;
+        unsolicited += other.unsolicited;
+        resyncBytes += other.resyncBytes;
+        skippedBadCrc += other.skippedBadCrc;
+        requeued += other.requeued;
+        drainedBytes += other.drainedBytes;
+        for (int type = 0; type < 2; ++type) {
+            retries[type] += other.retries[type];
+            recovered[type] += other.recovered[type];
+            for (int status = 0; status < ANALYZER_STATUSES; ++status) statuses[type][status] += other.statuses[type][status];
+            latencies[type].merge(other.latencies[type]);
+        }
+        for (const auto &entry : other.registers) {
+            RegisterAccess &access = registers[entry.first];
+            access.reads += entry.second.reads;
+            access.writes += entry.second.writes;
+            access.failures += entry.second.failures;
+        }
+        if (other.firstNs != 0) seen(other.firstNs);
+        lastNs = max(lastNs, other.lastNs);
+    }
+};
+
+static size_t parseRequests(const uint8_t *data, size_t size, int64_t timestampNs, vector<PendingRequest> &requests, uint64_t &badBytes) {
+    // Separa las peticiones de un trozo TX (una ráfaga pipelined son varias seguidas); devuelve los bytes consumidos,
+    // una petición cortada al final se deja para cuando llegue el resto
+    size_t position = 0;
+    while (size - position >= 2) {
+        const uint8_t *packet = data + position;
+        size_t packetSize = 0;
+        if (packet[0] == PACKET_HEADER_BYTE && packet[1] == PACKET_READ_COMMAND) packetSize = READ_REQUEST_SIZE;
+        if (packet[0] == PACKET_HEADER_BYTE && packet[1] == PACKET_WRITE_COMMAND) packetSize = WRITE_REQUEST_SIZE;
+
+        if (packetSize == 0 || (size - position >= packetSize && !packetCrcMatches(packet, packetSize))) {
+            badBytes++;
+            position++;
+            continue;
+        }
+        if (size - position < packetSize) break;
+
+        PendingRequest request;
+        request.sentNs = timestampNs;
+        request.write = packetSize == WRITE_REQUEST_SIZE;
+        request.address = loadBigEndian32(packet + 2);
+        request.value = request.write ? loadBigEndian32(packet + 6) : 0;
+        requests.push_back(request);
+        position += packetSize;
+    }
+    return position;
+}
+
+// Reconstruye las transacciones a partir de los trozos TX y RX, igual que las empareja el SerialWorker
+// La app no espera siempre RESPONSE_TIMEOUT: su timeout sale de la ida y vuelta medida (RttEstimator), así que aquí se lleva
+// otro estimador con las mismas reglas para dar por perdida una petición cuando la app lo hizo, y no emparejarla con la respuesta tardía
+class CaptureDecoder {
+public:
+    CaptureDecoder(AnalyzerStats &stats, function<void(const DecodedTransaction&)> onTransaction = nullptr)
+        : stats(stats), onTransaction(onTransaction) {}
+
+    void transmit(const uint8_t *data, size_t size, int64_t timestampNs, bool owned) {
+        expire(timestampNs);
+        if (owned) {
+            stats.txRecords++;
+            stats.txBytes += size;
+            stats.seen(timestampNs);
+        }
+
+        vector<PendingRequest> requests;
+        uint64_t badBytes = 0;
+        size_t consumed = parseRequests(data, size, timestampNs, requests, badBytes);
+        badBytes += size - consumed; // En la captura cada escritura va entera, lo que sobre es basura
+        if (owned) stats.badRequestBytes += badBytes;
+
+        // Tras un fallo la app vacía la línea y reintenta antes que nada, así que solo la primera petición puede ser el reintento
+        bool retryChecked = false;
+        for (PendingRequest &request : requests) {
+            request.owned = owned;
+            if (!retryChecked && failed && request.write == lastFailed.write && request.address == lastFailed.address &&
+                request.value == lastFailed.value && lastFailed.retries < RETRY_MAX) {
+                request.retries = lastFailed.retries + 1;
+                if (owned) stats.retries[request.write ? 1 : 0]++;
+            }
+            retryChecked = true;
+            if (owned) {
+                RegisterAccess &access = stats.registers[request.address];
+                (request.write ? access.writes : access.reads)++;
+            }
+            pending.push_back(request);
+        }
+        failed = false;
+        draining = false;
+    }
+
+    void receive(const uint8_t *data, size_t size, int64_t timestampNs, bool owned) {
+        expire(timestampNs);
+        if (owned) {
+            stats.rxRecords++;
+            stats.rxBytes += size;
+            stats.seen(timestampNs);
+        }
+        if (draining) {
+            // Lo que llegue entre el fallo y el siguiente envío la app lo tira al vaciar la línea
+            if (owned) stats.drainedBytes += size;
+            return;
+        }
+
+        rx.insert(rx.end(), data, data + size);
+        while (true) {
+            // La misma búsqueda que extractFrame: con una sola petición pendiente se resincroniza, en ráfaga cada trama ocupa su hueco
+            size_t frameStart = 0;
+            size_t consumed = 0;
+            FRAMESEARCH search = findResponseFrame(rx.data(), rx.size(), pending.size() <= 1, frameStart, consumed);
+            size_t discarded = (search == SEARCH_NEED_MORE) ? consumed : frameStart;
+            if (owned) {
+                stats.resyncBytes += discarded;
+                countSkippedFrames(discarded);
+            }
+            if (search == SEARCH_NEED_MORE) {
+                rx.erase(rx.begin(), rx.begin() + consumed);
+                return;
+            }
+
+            uint32_t value = 0;
+            DECODESTATUS status = decodeResponse(rx.data() + frameStart, value);
+            rx.erase(rx.begin(), rx.begin() + consumed);
+
+            if (pending.empty()) {
+                if (owned) stats.unsolicited++;
+                continue;
+            }
+            // Igual que la app, solo se mide una petición sola y sin reintentos (en ráfaga cada una espera a las de delante)
+            PendingRequest request = pending.front();
+            bool burst = pending.size() > 1;
+            if (!burst && request.retries == 0) roundTrip.sample((timestampNs - request.sentNs) / 1e6);
+            pending.pop_front();
+            lastAnswerNs = timestampNs;
+            complete(request, status, timestampNs, value);
+            // NOTOK es una trama válida y no descuadra la ráfaga (la app sigue con las de detrás), cualquier otro fallo sí
+            if (status != DECODE_OK && status != DECODE_NOTOK && (burst || status == DECODE_BAD_FORMAT)) {
+                abandonBurst();
+                return;
+            }
+        }
+    }
+
+    void finish() {
+        // Lo que siga pendiente al acabar la captura no llegó a tener respuesta
+        while (!pending.empty()) {
+            complete(pending.front(), ANALYZER_TIMEOUT, 0, 0);
+            pending.pop_front();
+        }
+    }
+
+    int responseTimeout() const { return roundTrip.timeout(); } // Timeout que tendría ahora la app (ms)
+
+    bool hasOwnedPending() const {
+        for (const PendingRequest &request : pending) {
+            if (request.owned) return true;
+        }
+        return false;
+    }
+
+private:
+    void countSkippedFrames(size_t discarded) {
+        // Entre lo descartado, cabeceras con una trama entera detrás son respuestas que se saltaron por el CRC
+        for (size_t i = 0; i < discarded && rx.size() - i >= RESPONSE_SIZE; ++i) {
+            if (isResponseStart(rx.data() + i) && !packetCrcMatches(rx.data() + i, RESPONSE_SIZE)) stats.skippedBadCrc++;
+        }
+    }
+
+    void expire(int64_t nowNs) {
+        // La app espera cada respuesta desde que la pide o desde que llegó la de delante (en ráfaga), con el timeout estimado
+        if (pending.empty()) return;
+        int64_t deadlineNs = max(pending.front().sentNs, lastAnswerNs) + static_cast<int64_t>(roundTrip.timeout()) * 1000000;
+        if (nowNs <= deadlineNs) return;
+
+        // Allí se dio por perdida, se tiró lo recibido a medias y lo que iba detrás en la ráfaga se vuelve a mandar
+        complete(pending.front(), ANALYZER_TIMEOUT, 0, 0);
+        pending.pop_front();
+        roundTrip.backoff();
+        lastAnswerNs = deadlineNs;
+        abandonBurst();
+    }
+
+    void abandonBurst() {
+        // Timeout o fallo que descuadra la ráfaga: la app vacía la línea y vuelve a mandar lo que quedaba detrás
+        for (const PendingRequest &request : pending) {
+            if (request.owned) stats.requeued++;
+        }
+        pending.clear();
+        rx.clear();
+        draining = true;
+    }
+
+    void complete(const PendingRequest &request, int status, int64_t answeredNs, uint32_t value) {
+        // La app reintenta cualquier fallo, NOTOK incluido (isRetryable), y lo primero que falló desde el último envío es lo que
+        // vuelve a salir primero (también en los bloques de calentamiento, para seguir la pista)
+        if (status != DECODE_OK && !failed) {
+            failed = true;
+            lastFailed = request;
+        }
+        if (!request.owned) return;
+
+        int type = request.write ? 1 : 0;
+        stats.statuses[type][status]++;
+        if (status != ANALYZER_TIMEOUT) stats.latencies[type].observe(answeredNs - request.sentNs);
+        if (status != DECODE_OK) stats.registers[request.address].failures++;
+        if (status == DECODE_OK && request.retries > 0) stats.recovered[type]++;
+
+        if (onTransaction) {
+            DecodedTransaction transaction;
+            transaction.sentNs = request.sentNs;
+            transaction.answeredNs = answeredNs;
+            transaction.address = request.address;
+            transaction.write = request.write;
+            transaction.status = status;
+            transaction.value = request.write ? request.value : value;
+            transaction.retries = request.retries;
+            onTransaction(transaction);
+        }
+    }
+
+    AnalyzerStats &stats;
+    function<void(const DecodedTransaction&)> onTransaction;
+    vector<uint8_t> rx;            // Bytes recibidos que aún no forman una respuesta
+    deque<PendingRequest> pending; // Peticiones sin respuesta, en orden de envío
+    RttEstimator roundTrip;        // El timeout que tendría la app en cada momento
+    int64_t lastAnswerNs = 0;      // Última respuesta (o timeout), desde ahí espera la app a la siguiente de una ráfaga
+    bool draining = false;         // Tras un timeout o una ráfaga descuadrada, hasta el siguiente envío
+    bool failed = false;           // Algo falló desde el último envío y la siguiente petición que se mande puede ser su reintento
+    PendingRequest lastFailed;
+};
+
+static bool mapCapture(const string &path, MappedCapture &capture) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(CaptureFileHeader)) {
+        fprintf(stderr, "%s is not a capture file.\n", path.c_str());
+        close(fd);
+        return false;
+    }
+
+    capture.size = static_cast<size_t>(info.st_size);
+    void *mapped = mmap(nullptr, capture.size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // El mapeo sigue valiendo sin el descriptor
+    if (mapped == MAP_FAILED) {
+        fprintf(stderr, "Could not map %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    madvise(mapped, capture.size, MADV_SEQUENTIAL); // Cada hilo lee su trozo de principio a fin
+
+    capture.data = static_cast<const uint8_t*>(mapped);
+    memcpy(&capture.header, capture.data, sizeof(capture.header));
+    if (!captureHeaderValid(capture.header)) {
+        fprintf(stderr, "%s is not a capture file (or has an unsupported version).\n", path.c_str());
+        munmap(mapped, capture.size);
+        return false;
+    }
+    capture.blockSize = capture.header.blockSize;
+    capture.blocks = (capture.size + capture.blockSize - 1) / capture.blockSize;
+    return true;
+}
+
+template <typename Function>
+static void forEachRecord(const MappedCapture &capture, size_t block, Function function) {
+    // Registros de un bloque en orden, el primero lleva delante la cabecera del fichero
+    const uint8_t *start = capture.data + block * capture.blockSize;
+    size_t size = min(capture.blockSize, capture.size - block * capture.blockSize);
+    size_t offset = block == 0 ? sizeof(CaptureFileHeader) : 0;
+
+    while (const CaptureRecordHeader *record = captureRecordAt(start, size, offset)) {
+        function(*record, start + offset + sizeof(CaptureRecordHeader));
+        offset += captureRecordSpan(record->size);
+    }
+}
+
+static void analyzeRange(const MappedCapture &capture, size_t firstBlock, size_t endBlock, AnalyzerStats &stats) {
+    // Cada hilo cuenta las peticiones enviadas en sus bloques [firstBlock, endBlock). Empieza un poco antes para emparejar bien
+    // las respuestas que le lleguen y sigue después hasta que sus últimas peticiones tienen respuesta
+    CaptureDecoder decoder(stats);
+    size_t block = firstBlock > ANALYZER_WARMUP_BLOCKS ? firstBlock - ANALYZER_WARMUP_BLOCKS : 0;
+
+    for (; block < capture.blocks; ++block) {
+        if (block >= endBlock && !decoder.hasOwnedPending()) return;
+        bool owned = block >= firstBlock && block < endBlock;
+
+        forEachRecord(capture, block, [&](const CaptureRecordHeader &record, const uint8_t *data) {
+            if (record.direction == CAPTURE_TX) decoder.transmit(data, record.size, record.timestampNs, owned);
+            else if (record.direction == CAPTURE_RX) decoder.receive(data, record.size, record.timestampNs, owned);
+        });
+    }
+    decoder.finish();
+}
+
+static const char *statusName(int status) {
+    switch (status) {
+    case DECODE_OK: return "ok";
+    case DECODE_NOTOK: return "notok";
+    case DECODE_BAD_FORMAT: return "bad_format";
+    case DECODE_BAD_CRC: return "bad_crc";
+    case ANALYZER_TIMEOUT: return "timeout";
+    default: return "unknown";
+    }
+}
+
+static double rate(uint64_t part, uint64_t total) {
+    return total ? 100.0 * part / total : 0.0;
+}
+
+static void printReport(const MappedCapture &capture, const AnalyzerStats &stats, unsigned threads, double elapsedSeconds) {
+    time_t started = static_cast<time_t>(capture.header.startWallMs / 1000);
+    char startedText[32];
+    strftime(startedText, sizeof(startedText), "%Y-%m-%d %H:%M:%S", localtime(&started));
+    double duration = stats.lastNs > stats.firstNs ? (stats.lastNs - stats.firstNs) / 1e9 : 0.0;
+
+    printf("Capture of %s started %s, %.3f s of traffic\n", capture.header.portName, startedText, duration);
+    printf("Analyzed %.1f MB in %.3f s with %u thread/s (%.1f MB/s)\n\n", capture.size / 1e6, elapsedSeconds, threads,
+           elapsedSeconds > 0 ? capture.size / 1e6 / elapsedSeconds : 0.0);
+
+    printf("Traffic: %llu TX chunks (%llu bytes), %llu RX chunks (%llu bytes)\n",
+           static_cast<unsigned long long>(stats.txRecords), static_cast<unsigned long long>(stats.txBytes),
+           static_cast<unsigned long long>(stats.rxRecords), static_cast<unsigned long long>(stats.rxBytes));
+    printf("Malformed request bytes %llu, unsolicited responses %llu, bytes discarded resynchronising %llu "
+           "(%llu responses with a wrong CRC skipped)\n",
+           static_cast<unsigned long long>(stats.badRequestBytes), static_cast<unsigned long long>(stats.unsolicited),
+           static_cast<unsigned long long>(stats.resyncBytes), static_cast<unsigned long long>(stats.skippedBadCrc));
+    printf("Retries: %llu reads (%llu recovered), %llu writes (%llu recovered); %llu pipelined requests resent, "
+           "%llu late bytes drained\n\n",
+           static_cast<unsigned long long>(stats.retries[0]), static_cast<unsigned long long>(stats.recovered[0]),
+           static_cast<unsigned long long>(stats.retries[1]), static_cast<unsigned long long>(stats.recovered[1]),
+           static_cast<unsigned long long>(stats.requeued), static_cast<unsigned long long>(stats.drainedBytes));
+
+    array<uint64_t, 2> totals = {};
+    for (int type = 0; type < 2; ++type) {
+        for (int status = 0; status < ANALYZER_STATUSES; ++status) totals[type] += stats.statuses[type][status];
+    }
+    printf("%-12s %12s %8s %12s %8s\n", "status", "reads", "%", "writes", "%");
+    for (int status = 0; status < ANALYZER_STATUSES; ++status) {
+        printf("%-12s %12llu %7.3f%% %12llu %7.3f%%\n", statusName(status),
+               static_cast<unsigned long long>(stats.statuses[0][status]), rate(stats.statuses[0][status], totals[0]),
+               static_cast<unsigned long long>(stats.statuses[1][status]), rate(stats.statuses[1][status], totals[1]));
+    }
+    printf("%-12s %12llu %8s %12llu\n\n", "total", static_cast<unsigned long long>(totals[0]), "",
+           static_cast<unsigned long long>(totals[1]));
+
+    printf("Latency from request to complete response (s)\n");
+    printf("%-6s %10s %10s %10s %10s %10s %10s\n", "type", "answered", "mean", "p50", "p90", "p99", "max");
+    for (int type = 0; type < 2; ++type) {
+        const LatencyHistogram &latency = stats.latencies[type];
+        printf("%-6s %10llu %10.6f %10.6f %10.6f %10.6f %10.6f\n", type ? "write" : "read",
+               static_cast<unsigned long long>(latency.count()), latency.mean(), latency.percentile(0.50),
+               latency.percentile(0.90), latency.percentile(0.99), latency.maximum());
+    }
+
+    printf("\nLatency distribution (s)\n");
+    printf("%-10s %12s %12s\n", "le", "reads", "writes");
+    for (int bucket = 0; bucket <= METRICS_LATENCY_BUCKETS; ++bucket) {
+        char bound[16];
+        if (bucket < METRICS_LATENCY_BUCKETS) snprintf(bound, sizeof(bound), "%g", METRICS_LATENCY_BOUNDS[bucket]);
+        else snprintf(bound, sizeof(bound), "+Inf");
+        printf("%-10s %12llu %12llu\n", bound, static_cast<unsigned long long>(stats.latencies[0].bucket(bucket)),
+               static_cast<unsigned long long>(stats.latencies[1].bucket(bucket)));
+    }
+
+    printf("\nRegister accesses\n");
+    printf("%-10s %12s %12s %12s %10s\n", "register", "reads", "writes", "failures", "per s");
+    for (const auto &entry : stats.registers) {
+        const RegisterAccess &access = entry.second;
+        printf("0x%03X      %12llu %12llu %12llu %10.2f\n", entry.first, static_cast<unsigned long long>(access.reads),
+               static_cast<unsigned long long>(access.writes), static_cast<unsigned long long>(access.failures),
+               duration > 0 ? (access.reads + access.writes) / duration : 0.0);
+    }
+}
+
+static void sleepUntil(chrono::steady_clock::time_point start, int64_t offsetNs, double speed) {
+    if (speed <= 0) return;
+    this_thread::sleep_until(start + chrono::nanoseconds(static_cast<int64_t>(offsetNs / speed)));
+}
+
+static void runTimeline(const MappedCapture &capture, double speed) {
+    // Un solo decodificador en orden, con --speed los trozos le llegan al ritmo con el que llegaron al puerto
+    AnalyzerStats stats;
+    int64_t origin = capture.header.startMonotonicNs;
+    CaptureDecoder decoder(stats, [origin](const DecodedTransaction &transaction) {
+        printf("%12.6f  %-5s 0x%03X  0x%08X  %-10s", (transaction.sentNs - origin) / 1e9, transaction.write ? "write" : "read",
+               transaction.address, transaction.value, statusName(transaction.status));
+        if (transaction.answeredNs != 0) printf("  %.6f s", (transaction.answeredNs - transaction.sentNs) / 1e9);
+        if (transaction.retries > 0) printf("  retry %d", transaction.retries);
+        printf("\n");
+    });
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t block = 0; block < capture.blocks; ++block) {
+        forEachRecord(capture, block, [&](const CaptureRecordHeader &record, const uint8_t *data) {
+            sleepUntil(start, record.timestampNs - origin, speed);
+            if (record.direction == CAPTURE_TX) decoder.transmit(data, record.size, record.timestampNs, true);
+            else if (record.direction == CAPTURE_RX) decoder.receive(data, record.size, record.timestampNs, true);
+        });
+    }
+    decoder.finish();
+}
+
+struct ReplayExchange { // Una escritura de la captura y todo lo que se recibió hasta la siguiente
+    size_t requests = 0; // Peticiones que iban en la escritura
+    vector<pair<int64_t, vector<uint8_t>>> chunks; // Trozos recibidos, con su retraso desde la escritura (ns)
+};
+
+static int runReplay(const MappedCapture &capture, double speed, const string &link) {
+    // La app se conecta al pty como a un puerto; a cada petición que manda se le contesta con lo que se recibió en la captura
+    // tras la petición equivalente, con el mismo retraso (dividido por speed) y partido en los mismos trozos
+    vector<ReplayExchange> exchanges;
+    int64_t lastTxNs = 0;
+    for (size_t block = 0; block < capture.blocks; ++block) {
+        forEachRecord(capture, block, [&](const CaptureRecordHeader &record, const uint8_t *data) {
+            if (record.direction == CAPTURE_TX) {
+                vector<PendingRequest> requests;
+                uint64_t badBytes = 0;
+                parseRequests(data, record.size, record.timestampNs, requests, badBytes);
+                if (requests.empty()) return;
+                exchanges.emplace_back();
+                exchanges.back().requests = requests.size();
+                lastTxNs = record.timestampNs;
+            } else if (record.direction == CAPTURE_RX && !exchanges.empty()) {
+                exchanges.back().chunks.emplace_back(record.timestampNs - lastTxNs, vector<uint8_t>(data, data + record.size));
+            }
+        });
+    }
+
+    int masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (masterFd < 0 || grantpt(masterFd) != 0 || unlockpt(masterFd) != 0) {
+        fprintf(stderr, "Could not create pseudo-terminal: %s\n", strerror(errno));
+        return 1;
+    }
+    string slaveName = ptsname(masterFd);
+    termios settings;
+    tcgetattr(masterFd, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(masterFd, TCSANOW, &settings);
+    int slaveFd = open(slaveName.c_str(), O_RDWR | O_NOCTTY); // Igual que el emulador, para que la app pueda reconectar
+
+    if (!link.empty()) {
+        unlink(link.c_str());
+        if (symlink(slaveName.c_str(), link.c_str()) != 0) fprintf(stderr, "Could not create link %s: %s\n", link.c_str(), strerror(errno));
+    }
+    printf("Replaying %zu exchanges on %s%s\n", exchanges.size(), slaveName.c_str(), link.empty() ? "" : (" (" + link + ")").c_str());
+    fflush(stdout);
+
+    vector<uint8_t> input;
+    size_t receivedRequests = 0;
+    size_t next = 0;
+    while (next < exchanges.size()) {
+        pollfd descriptor = {masterFd, POLLIN, 0};
+        if (poll(&descriptor, 1, ANALYZER_POLL_TIME) <= 0) continue;
+
+        uint8_t buffer[RX_BUFFER_SIZE];
+        ssize_t received = read(masterFd, buffer, sizeof(buffer));
+        if (received <= 0) continue;
+        input.insert(input.end(), buffer, buffer + received);
+
+        vector<PendingRequest> requests;
+        uint64_t badBytes = 0;
+        input.erase(input.begin(), input.begin() + parseRequests(input.data(), input.size(), 0, requests, badBytes));
+        receivedRequests += requests.size();
+
+        // Una ráfaga capturada se contesta cuando la app ha mandado tantas peticiones como llevaba
+        while (next < exchanges.size() && receivedRequests >= exchanges[next].requests) {
+            receivedRequests -= exchanges[next].requests;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (const auto &chunk : exchanges[next].chunks) {
+                sleepUntil(start, chunk.first, speed);
+                if (write(masterFd, chunk.second.data(), chunk.second.size()) < 0) break;
+            }
+            next++;
+        }
+    }
+
+    printf("End of capture reached.\n");
+    if (!link.empty()) unlink(link.c_str());
+    if (slaveFd >= 0) close(slaveFd);
+    close(masterFd);
+    return 0;
+}
+
+static void feedResponse(CaptureDecoder &decoder, uint8_t status, uint32_t value, int64_t timestampNs) {
+    array<uint8_t, RESPONSE_SIZE> response = {};
+    response[0] = PACKET_HEADER_BYTE;
+    response[1] = status;
+    storeBigEndian32(response.data() + 2, value);
+    sealPacket(response.data(), response.size());
+    decoder.receive(response.data(), response.size(), timestampNs, true);
+}
+
+static bool checkDecoder() {
+    // Un sensor sano (1 ms) y una lectura que contesta NOTOK: la app la reintenta, así que el reenvío cuenta como reintento
+    // y su respuesta, aunque tarde casi el timeout, no es una muestra de la ida y vuelta (Karn)
+    AnalyzerStats stats;
+    CaptureDecoder decoder(stats);
+    ReadRequest request(INT_TIME_ADDRESS);
+    int64_t now = 0;
+    for (int i = 0; i < 20; ++i) {
+        decoder.transmit(request.data(), request.size(), now, true);
+        feedResponse(decoder, PACKET_STATUS_OK, 100, now + 1000000);
+        now += 5000000;
+    }
+    int trainedTimeout = decoder.responseTimeout();
+
+    decoder.transmit(request.data(), request.size(), now, true);
+    feedResponse(decoder, PACKET_STATUS_NOTOK, 0, now + 1000000);
+    now += 2000000;
+    decoder.transmit(request.data(), request.size(), now, true);
+    feedResponse(decoder, PACKET_STATUS_OK, 100, now + (trainedTimeout - 1) * 1000000LL);
+    decoder.finish();
+
+    bool ok = true;
+    auto expect = [&ok](bool condition, const char *what) {
+        if (!condition) printf("FAIL %s\n", what);
+        ok = ok && condition;
+    };
+    expect(stats.statuses[0][DECODE_NOTOK] == 1, "NOTOK reply counted once");
+    expect(stats.statuses[0][DECODE_OK] == 21, "retry answered OK");
+    expect(stats.statuses[0][ANALYZER_TIMEOUT] == 0, "no timeouts");
+    expect(stats.retries[0] == 1, "resend after NOTOK counted as a retry");
+    expect(stats.recovered[0] == 1, "retry counted as recovered");
+    expect(decoder.responseTimeout() == trainedTimeout, "retry not sampled for the round-trip time");
+    return ok;
+}
+
+static void printUsage() {
+    printf("Usage: eole_analyzer capture%s [options]\n"
+           "  --threads N   threads for the report (default: one per core)\n"
+           "  --timeline    print every decoded transaction instead of the report\n"
+           "  --replay      answer the app on a pseudo-terminal with the captured responses\n"
+           "  --speed X     with --timeline or --replay, replay at X times the original pace (0 = no waiting)\n"
+           "  --link PATH   with --replay, also create a symlink to the slave (for example /tmp/ttyEOLE)\n"
+           "or:    eole_analyzer --self-test\n", CAPTURE_EXTENSION);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || string(argv[1]) == "--help") {
+        printUsage();
+        return argc < 2 ? 1 : 0;
+    }
+    if (string(argv[1]) == "--self-test") {
+        if (!checkDecoder()) return 1;
+        printf("Decoder self-test passed.\n");
+        return 0;
+    }
+
+    string path = argv[1];
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    bool timeline = false;
+    bool replay = false;
+    double speed = -1; // Sin --speed: timeline sin esperas y replay al ritmo original
+    string link;
+
+    for (int i = 2; i < argc; ++i) {
+        string option = argv[i];
+        if (option == "--timeline") timeline = true;
+        else if (option == "--replay") replay = true;
+        else if (option == "--threads" && i + 1 < argc) threads = max(1, atoi(argv[++i]));
+        else if (option == "--speed" && i + 1 < argc) speed = atof(argv[++i]);
+        else if (option == "--link" && i + 1 < argc) link = argv[++i];
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    MappedCapture capture;
+    if (!mapCapture(path, capture)) return 1;
+
+    if (replay) return runReplay(capture, speed < 0 ? 1.0 : speed, link);
+    if (timeline) {
+        runTimeline(capture, speed < 0 ? 0.0 : speed);
+        return 0;
+    }
+
+    // Un rango de bloques seguido por hilo, cada uno con sus propias estadísticas y sin nada compartido mientras decodifican
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    threads = static_cast<unsigned>(min<size_t>(threads, capture.blocks));
+    size_t blocksPerThread = (capture.blocks + threads - 1) / threads;
+    vector<AnalyzerStats> partial(threads);
+    vector<thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        size_t firstBlock = i * blocksPerThread;
+        size_t endBlock = min(capture.blocks, firstBlock + blocksPerThread);
+        workers.emplace_back([&capture, &partial, i, firstBlock, endBlock]() { analyzeRange(capture, firstBlock, endBlock, partial[i]); });
+    }
+    for (thread &worker : workers) worker.join();
+
+    AnalyzerStats stats;
+    for (const AnalyzerStats &part : partial) stats.merge(part);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    printReport(capture, stats, threads, elapsed);
+    return 0;
+}
+
+#endif // EOLE_ANALYZER
@@ -0,0 +1,68 @@
+#ifndef CAPTUREFORMAT_H
+#define CAPTUREFORMAT_H
+
+// Formato de las capturas binarias del tráfico serie (.eolecap), compartido por la app (capturewriter.h) y el analizador offline
+// Sin Qt y solo cabecera, igual que packetcodec.h
+// Fichero = cabecera de 64 bytes + registros. Los registros van en bloques de CAPTURE_BLOCK_SIZE y nunca cruzan un bloque,
+// así el analizador puede empezar a leer en cualquier bloque y repartir el fichero entre varios hilos
+// Todo en el orden de bytes de la máquina que captura (little endian en x86 y ARM)
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+#define CAPTURE_MAGIC "EOLECAP" // Primeros 8 bytes del fichero (con el \0)
+#define CAPTURE_VERSION 1 // Versión del formato
+#define CAPTURE_BLOCK_SIZE 65536 // Tamaño de bloque (en bytes), ningún registro cruza de un bloque a otro
+#define CAPTURE_PORT_NAME_SIZE 32 // Bytes para el nombre del puerto en la cabecera (con el \0)
+#define CAPTURE_EXTENSION ".eolecap" // Extensión de las capturas
+
+enum CAPTUREDIRECTION { // Sentido de un registro de la captura
+    CAPTURE_END = 0, // Sin registro: el resto del bloque está vacío (el fichero se crea a ceros)
+    CAPTURE_TX = 1,  // Bytes escritos en el puerto
+    CAPTURE_RX = 2   // Bytes leídos del puerto
+};
+
+struct CaptureFileHeader { // Al principio del fichero, dentro del primer bloque
+    char magic[8];            // CAPTURE_MAGIC
+    uint32_t version;         // CAPTURE_VERSION
+    uint32_t blockSize;       // CAPTURE_BLOCK_SIZE con el que se escribió
+    int64_t startWallMs;      // Hora del sistema al empezar (ms desde epoch), para situar la captura
+    int64_t startMonotonicNs; // Reloj de traceNow() en ese mismo momento, los registros usan este reloj
+    char portName[CAPTURE_PORT_NAME_SIZE]; // Puerto capturado
+};
+
+struct CaptureRecordHeader { // Delante de cada trozo de datos
+    int64_t timestampNs; // Reloj de traceNow() cuando se escribió o se leyó el trozo
+    uint32_t size;       // Bytes de datos que siguen
+    uint16_t direction;  // CAPTUREDIRECTION
+    uint16_t reserved;   // A 0
+};
+
+static_assert(sizeof(CaptureFileHeader) == 64, "La cabecera de la captura tiene que ocupar 64 bytes");
+static_assert(sizeof(CaptureRecordHeader) == 16, "La cabecera de un registro tiene que ocupar 16 bytes");
+static_assert(CAPTURE_BLOCK_SIZE % 8 == 0, "Los registros van alineados a 8 bytes dentro del bloque");
+
+constexpr size_t captureRecordSpan(size_t size) {
+    // Lo que ocupa un registro con size bytes de datos, alineado a 8 para que la siguiente cabecera también lo esté
+    return (sizeof(CaptureRecordHeader) + size + 7) & ~static_cast<size_t>(7);
+}
+
+constexpr size_t CAPTURE_MAX_CHUNK = CAPTURE_BLOCK_SIZE - sizeof(CaptureRecordHeader); // Datos que caben en un registro
+
+inline const CaptureRecordHeader *captureRecordAt(const uint8_t *block, size_t blockSize, size_t offset) {
+    // Registro que empieza en offset dentro de un bloque, o nullptr si el bloque ya no tiene más (o el registro está roto)
+    if (offset + sizeof(CaptureRecordHeader) > blockSize) return nullptr;
+    const CaptureRecordHeader *record = reinterpret_cast<const CaptureRecordHeader*>(block + offset);
+    if (record->direction == CAPTURE_END || offset + captureRecordSpan(record->size) > blockSize) return nullptr;
+    return record;
+}
+
+inline bool captureHeaderValid(const CaptureFileHeader &header) {
+    return memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) == 0 && header.version == CAPTURE_VERSION &&
+           header.blockSize >= sizeof(CaptureFileHeader) + sizeof(CaptureRecordHeader) && header.blockSize % 8 == 0;
+}
+
+#endif // CAPTUREFORMAT_H
@@ -0,0 +1,111 @@
+#include "capturewriter.h"
+#include "values.h"
+#include "tracing.h"
+#include <QDateTime>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static_assert(CAPTURE_MAP_SIZE % CAPTURE_BLOCK_SIZE == 0, "La ventana tiene que ser un número entero de bloques");
+
+CaptureWriter::CaptureWriter() : window(nullptr), windowStart(0), position(0) {
+}
+
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+bool CaptureWriter::open(const QString &path, const QString &portName) {
+    close();
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        cerr << "Unable to create capture file " << path.toStdString() << ".\n";
+        return false;
+    }
+    if (!mapWindow(0)) {
+        file.close();
+        return false;
+    }
+
+    CaptureFileHeader header = {};
+    memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_VERSION;
+    header.blockSize = CAPTURE_BLOCK_SIZE;
+    header.startWallMs = QDateTime::currentMSecsSinceEpoch();
+    header.startMonotonicNs = traceNow();
+    QByteArray name = portName.toLatin1().left(CAPTURE_PORT_NAME_SIZE - 1);
+    memcpy(header.portName, name.constData(), static_cast<size_t>(name.size()));
+
+    memcpy(window, &header, sizeof(header));
+    position = sizeof(header);
+
+    cout << "Capturing serial traffic to " << path.toStdString() << ".\n";
+    return true;
+}
+
+void CaptureWriter::close() {
+    if (!file.isOpen()) return;
+
+    // Se recorta lo que sobra de la última ventana, que aún estaría a ceros
+    qint64 end = windowStart + position;
+    unmapWindow();
+    file.resize(end);
+    file.close();
+}
+
+bool CaptureWriter::isOpen() const {
+    return window != nullptr;
+}
+
+void CaptureWriter::record(CAPTUREDIRECTION direction, const uint8_t *data, size_t size, int64_t timestampNs) {
+    if (window == nullptr) return;
+
+    while (size > 0) {
+        size_t chunk = size < CAPTURE_MAX_CHUNK ? size : CAPTURE_MAX_CHUNK;
+        size_t span = captureRecordSpan(chunk);
+
+        // Si no cabe en lo que queda de bloque se salta al siguiente (el hueco ya está a ceros, el lector lo entiende como fin de bloque)
+        qint64 blockUsed = position % CAPTURE_BLOCK_SIZE;
+        if (blockUsed + static_cast<qint64>(span) > CAPTURE_BLOCK_SIZE) {
+            position += CAPTURE_BLOCK_SIZE - blockUsed;
+        }
+        if (position >= CAPTURE_MAP_SIZE && !mapWindow(windowStart + CAPTURE_MAP_SIZE)) {
+            cerr << "Capture stopped, the capture file could not be extended.\n";
+            close();
+            return;
+        }
+
+        CaptureRecordHeader header = {};
+        header.timestampNs = timestampNs;
+        header.size = static_cast<uint32_t>(chunk);
+        header.direction = static_cast<uint16_t>(direction);
+        memcpy(window + position + sizeof(header), data, chunk);
+        memcpy(window + position, &header, sizeof(header)); // La cabecera al final, un registro a medias se lee como fin de bloque
+        position += static_cast<qint64>(span);
+
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+bool CaptureWriter::mapWindow(qint64 offset) {
+    unmapWindow();
+
+    // El trozo nuevo del fichero sale a ceros, que es justo lo que el lector toma como bloque sin más registros
+    if (!file.resize(offset + CAPTURE_MAP_SIZE)) return false;
+    window = file.map(offset, CAPTURE_MAP_SIZE);
+    if (window == nullptr) return false;
+
+    windowStart = offset;
+    position = 0;
+    return true;
+}
+
+void CaptureWriter::unmapWindow() {
+    if (window != nullptr) {
+        file.unmap(window);
+        window = nullptr;
+    }
+}
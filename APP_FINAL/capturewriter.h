@@ -0,0 +1,36 @@
+#ifndef CAPTUREWRITER_H
+#define CAPTUREWRITER_H
+
+// Captura binaria del tráfico del puerto (formato en captureformat.h), la escribe el SerialManager si se activa
+// El fichero se va ampliando por ventanas y se escribe a través de un mapeo en memoria: cada trozo es un memcpy,
+// sin llamadas al sistema en el camino de cada transacción, y lo ya copiado no se pierde aunque la app se caiga
+// Solo desde el hilo que tiene el puerto (el hilo serie)
+
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include "captureformat.h"
+
+using namespace std;
+
+class CaptureWriter {
+public:
+    CaptureWriter(); // Constructor
+    ~CaptureWriter(); // Destructor, cierra la captura si sigue abierta
+
+    bool open(const QString &path, const QString &portName); // Crea el fichero y escribe la cabecera
+    void close(); // Deja el fichero con su tamaño real y lo cierra
+    bool isOpen() const; // Si hay una captura en curso
+    void record(CAPTUREDIRECTION direction, const uint8_t *data, size_t size, int64_t timestampNs); // Apunta un trozo TX o RX
+
+private:
+    bool mapWindow(qint64 offset); // Amplía el fichero y mapea la ventana que empieza en offset
+    void unmapWindow(); // Suelta la ventana actual
+
+    QFile file;         // Fichero de la captura
+    uchar *window;      // Ventana mapeada (CAPTURE_MAP_SIZE bytes), nullptr si no hay captura
+    qint64 windowStart; // Posición en el fichero del principio de la ventana
+    qint64 position;    // Siguiente byte libre dentro de la ventana
+};
+
+#endif // CAPTUREWRITER_H
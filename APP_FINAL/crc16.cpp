@@ -0,0 +1,225 @@
+#include "crc16.h"
+#include <cstring>
+#include <chrono>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CRC16_HAS_CLMUL 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+#define CALIBRATION_ROUNDS 4096 // Vueltas por variante al elegir la más rápida
+#define WRITE_SAMPLE_SIZE 10   // Trama de escritura sin CRC
+
+// Valores conocidos de test.cpp: si la tabla generada al compilar estuviera mal no compilaría
+static constexpr uint8_t CRC16_CHECK_TINT_READ[] = {0x40, 0x90, 0x00, 0x00, 0x00, 0x98};
+static constexpr uint8_t CRC16_CHECK_TINT_WRITE[] = {0x40, 0x99, 0x00, 0x00, 0x00, 0x98, 0x00, 0x02, 0xB2, 0xA0};
+static_assert(crc16Table(CRC16_CHECK_TINT_READ, sizeof(CRC16_CHECK_TINT_READ)) == 0x6CCF, "CRC de lectura de TINT incorrecto");
+static_assert(crc16Slicing4(CRC16_CHECK_TINT_READ, sizeof(CRC16_CHECK_TINT_READ)) == 0x6CCF, "CRC de lectura de TINT incorrecto");
+static_assert(crc16Slicing8(CRC16_CHECK_TINT_WRITE, sizeof(CRC16_CHECK_TINT_WRITE)) == 0x4140, "CRC de escritura de TINT incorrecto");
+
+#ifdef CRC16_HAS_CLMUL
+
+constexpr uint64_t crc16BarrettConstant() {
+    // Cociente de x^80 entre el polinomio x^16 + 0x8005 (el bit 64 siempre vale 1 y no se guarda)
+    uint32_t remainder = 0;
+    uint64_t quotient = 0;
+    for (int bit = 80; bit >= 0; --bit) {
+        remainder = (remainder << 1) | (bit == 80 ? 1 : 0);
+        if (remainder & 0x10000) {
+            remainder ^= 0x18005;
+            if (bit < 64) quotient |= uint64_t(1) << bit;
+        }
+    }
+
+    // El CRC es reflejado, así que la constante también
+    uint64_t reflected = 0;
+    for (int i = 0; i < 64; ++i) {
+        if (quotient & (uint64_t(1) << i)) reflected |= uint64_t(1) << (63 - i);
+    }
+    return reflected;
+}
+
+// Las dos constantes van desplazadas un bit para ahorrarse los desplazamientos tras cada multiplicación
+static constexpr uint64_t CRC16_BARRETT_MU = crc16BarrettConstant() << 1;
+static constexpr uint64_t CRC16_BARRETT_POLY = uint64_t(CRC16_POLY) << 1;
+
+__attribute__((target("pclmul,sse4.1")))
+static inline uint16_t crc16ClmulReduce(uint64_t block) {
+    // Reducción de Barrett de un bloque de 8 bytes (con el estado anterior ya mezclado en sus 2 primeros bytes)
+    const __m128i mu = _mm_cvtsi64_si128(static_cast<long long>(CRC16_BARRETT_MU));
+    const __m128i poly = _mm_cvtsi64_si128(static_cast<long long>(CRC16_BARRETT_POLY));
+    __m128i value = _mm_cvtsi64_si128(static_cast<long long>(block));
+    __m128i quotient = _mm_xor_si128(value, _mm_clmulepi64_si128(value, mu, 0x00));
+    __m128i remainder = _mm_clmulepi64_si128(quotient, poly, 0x00);
+    return static_cast<uint16_t>(_mm_extract_epi16(remainder, 4)); // El resto queda justo en los bits 64 a 79
+}
+
+__attribute__((target("pclmul,sse4.1")))
+static uint16_t crc16ClmulKernel(const uint8_t *data, size_t size, uint16_t crc) {
+    while (size >= 8) {
+        uint64_t block;
+        memcpy(&block, data, 8); // Solo x86, la memoria ya está en little endian
+        crc = crc16ClmulReduce(block ^ crc);
+        data += 8;
+        size -= 8;
+    }
+
+    // Un resto de 2 a 7 bytes se rellena con ceros por delante, que no cambian un CRC con valor inicial 0
+    if (size >= 2) {
+        uint64_t block = 0;
+        memcpy(&block, data, size);
+        crc = crc16ClmulReduce((block ^ crc) << (64 - 8 * size));
+        data += size;
+        size = 0;
+    }
+    return crc16Table(data, size, crc);
+}
+
+#endif // CRC16_HAS_CLMUL
+
+bool crc16ClmulSupported() {
+#ifdef CRC16_HAS_CLMUL
+    static const bool supported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+uint16_t crc16Clmul(const uint8_t *data, size_t size, uint16_t crc) {
+#ifdef CRC16_HAS_CLMUL
+    if (crc16ClmulSupported()) {
+        return crc16ClmulKernel(data, size, crc);
+    }
+#endif
+    return crc16Slicing8(data, size, crc);
+}
+
+static CRCVARIANT selectCrc16Variant() {
+    // Con tramas tan cortas (6 y 10 bytes) gana una u otra según la CPU, así que se mide una vez y se queda la más rápida
+    // Son unas decenas de microsegundos la primera vez que se calcula un CRC
+    static const uint8_t sample[WRITE_SAMPLE_SIZE] = {0x40, 0x99, 0x00, 0x00, 0x00, 0x98, 0x00, 0x02, 0xB2, 0xA0};
+    CRCVARIANT candidates[] = {CRC_SLICING4, CRC_SLICING8, CRC_CLMUL};
+    CRCVARIANT best = CRC_SLICING8;
+    auto bestTime = chrono::steady_clock::duration::max();
+
+    for (CRCVARIANT candidate : candidates) {
+        if (candidate == CRC_CLMUL && !crc16ClmulSupported()) continue;
+
+        volatile uint16_t sink = 0;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < CALIBRATION_ROUNDS; ++i) {
+            sink = sink ^ crc16Compute(candidate, sample, 6 + (i & 4)); // Alterna lecturas (6 bytes) y escrituras (10 bytes)
+        }
+        auto elapsed = chrono::steady_clock::now() - start;
+        if (elapsed < bestTime) {
+            bestTime = elapsed;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+CRCVARIANT crc16ActiveVariant() {
+    static const CRCVARIANT variant = selectCrc16Variant();
+    return variant;
+}
+
+uint16_t crc16Compute(const uint8_t *data, size_t size) {
+    return crc16Compute(crc16ActiveVariant(), data, size);
+}
+
+uint16_t crc16Compute(CRCVARIANT variant, const uint8_t *data, size_t size) {
+    switch (variant) {
+    case CRC_BITWISE:
+        return crc16Bitwise(data, size);
+    case CRC_TABLE:
+        return crc16Table(data, size);
+    case CRC_SLICING4:
+        return crc16Slicing4(data, size);
+    case CRC_CLMUL:
+        return crc16Clmul(data, size);
+    case CRC_SLICING8:
+    default:
+        return crc16Slicing8(data, size);
+    }
+}
+
+const char *crc16VariantName(CRCVARIANT variant) {
+    switch (variant) {
+    case CRC_BITWISE: return "bitwise";
+    case CRC_TABLE: return "table";
+    case CRC_SLICING4: return "slicing-by-4";
+    case CRC_SLICING8: return "slicing-by-8";
+    case CRC_CLMUL: return "clmul";
+    default: return "unknown";
+    }
+}
+
+static inline bool crc16FrameMatches(const uint8_t *frame, size_t frameSize, uint16_t crc) {
+    // El EOLE manda el CRC en big endian
+    return frame[frameSize - 2] == static_cast<uint8_t>(crc >> 8) && frame[frameSize - 1] == static_cast<uint8_t>(crc & 0xFF);
+}
+
+static size_t crc16ValidateFramesLanes(const uint8_t *frames, size_t frameSize, size_t count, uint8_t *valid) {
+    // Cuatro tramas a la vez con la tabla: las cuatro cadenas de consultas son independientes y la CPU las solapa
+    const size_t payload = frameSize - 2;
+    const array<uint16_t, 256> &table = CRC16_TABLES[0];
+    size_t validCount = 0;
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        const uint8_t *f0 = frames + i * frameSize;
+        const uint8_t *f1 = f0 + frameSize;
+        const uint8_t *f2 = f1 + frameSize;
+        const uint8_t *f3 = f2 + frameSize;
+        uint16_t c0 = CRC16_INIT, c1 = CRC16_INIT, c2 = CRC16_INIT, c3 = CRC16_INIT;
+
+        for (size_t n = 0; n < payload; ++n) {
+            c0 = static_cast<uint16_t>((c0 >> 8) ^ table[(c0 ^ f0[n]) & 0xFF]);
+            c1 = static_cast<uint16_t>((c1 >> 8) ^ table[(c1 ^ f1[n]) & 0xFF]);
+            c2 = static_cast<uint16_t>((c2 >> 8) ^ table[(c2 ^ f2[n]) & 0xFF]);
+            c3 = static_cast<uint16_t>((c3 >> 8) ^ table[(c3 ^ f3[n]) & 0xFF]);
+        }
+
+        valid[i] = crc16FrameMatches(f0, frameSize, c0);
+        valid[i + 1] = crc16FrameMatches(f1, frameSize, c1);
+        valid[i + 2] = crc16FrameMatches(f2, frameSize, c2);
+        valid[i + 3] = crc16FrameMatches(f3, frameSize, c3);
+        validCount += valid[i] + valid[i + 1] + valid[i + 2] + valid[i + 3];
+    }
+
+    // Las que sobran una a una
+    for (; i < count; ++i) {
+        const uint8_t *frame = frames + i * frameSize;
+        valid[i] = crc16FrameMatches(frame, frameSize, crc16Table(frame, payload));
+        validCount += valid[i];
+    }
+    return validCount;
+}
+
+size_t crc16ValidateFrames(const uint8_t *frames, size_t frameSize, size_t count, uint8_t *valid) {
+    // Con muchas tramas cortas las cuatro cadenas de tabla intercaladas superan a cualquier variante trama a trama
+    return crc16ValidateFrames(CRC_TABLE, frames, frameSize, count, valid);
+}
+
+size_t crc16ValidateFrames(CRCVARIANT variant, const uint8_t *frames, size_t frameSize, size_t count, uint8_t *valid) {
+    if (frameSize < 3) { // Sin sitio para CRC y al menos un byte de datos no hay trama
+        memset(valid, 0, count);
+        return 0;
+    }
+
+    if (variant == CRC_TABLE) {
+        return crc16ValidateFramesLanes(frames, frameSize, count, valid);
+    }
+
+    size_t validCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t *frame = frames + i * frameSize;
+        valid[i] = crc16FrameMatches(frame, frameSize, crc16Compute(variant, frame, frameSize - 2));
+        validCount += valid[i];
+    }
+    return validCount;
+}
@@ -0,0 +1,106 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+// Motor único de CRC16-Modbus (polinomio 0xA001 reflejado, valor inicial 0xFFFF) compartido por la app y la librería eole_cmd
+// Devuelve el CRC como número, el orden de los bytes lo pone quien monta el paquete (el EOLE lo manda en big endian)
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+#define CRC16_INIT 0xFFFF // Valor inicial del registro CRC en Modbus
+#define CRC16_POLY 0xA001 // Polinomio 0x8005 en su forma reflejada
+
+enum CRCVARIANT { // Implementaciones disponibles, todas dan el mismo resultado
+    CRC_BITWISE = 0,  // Bit a bit, la de referencia (la que había en SerialManager y eole_cmd)
+    CRC_TABLE = 1,    // Un byte por consulta a tabla
+    CRC_SLICING4 = 2, // 4 bytes por vuelta con 4 tablas
+    CRC_SLICING8 = 3, // 8 bytes por vuelta con 8 tablas
+    CRC_CLMUL = 4     // Multiplicación sin acarreo (PCLMULQDQ) con reducción de Barrett, solo si la CPU la tiene
+};
+
+typedef array<array<uint16_t, 256>, 8> Crc16Tables; // Tabla para cada uno de los 8 bytes de una vuelta de slicing-by-8
+
+constexpr Crc16Tables makeCrc16Tables() {
+    Crc16Tables tables = {};
+
+    // La primera tabla es el CRC de cada byte posible, igual que el bucle bit a bit
+    for (int byte = 0; byte < 256; ++byte) {
+        uint16_t crc = static_cast<uint16_t>(byte);
+        for (int i = 0; i < 8; ++i) {
+            crc = (crc & 0x0001) ? static_cast<uint16_t>((crc >> 1) ^ CRC16_POLY) : static_cast<uint16_t>(crc >> 1);
+        }
+        tables[0][byte] = crc;
+    }
+
+    // Cada tabla siguiente adelanta un byte más de ceros
+    for (int k = 1; k < 8; ++k) {
+        for (int byte = 0; byte < 256; ++byte) {
+            uint16_t previous = tables[k - 1][byte];
+            tables[k][byte] = static_cast<uint16_t>((previous >> 8) ^ tables[0][previous & 0xFF]);
+        }
+    }
+    return tables;
+}
+
+inline constexpr Crc16Tables CRC16_TABLES = makeCrc16Tables(); // Se genera al compilar, no hay inicialización en tiempo de ejecución
+
+constexpr uint16_t crc16Bitwise(const uint8_t *data, size_t size, uint16_t crc = CRC16_INIT) {
+    // Algoritmo original bit a bit, se queda como referencia
+    for (size_t n = 0; n < size; ++n) {
+        crc ^= data[n];
+        for (int i = 0; i < 8; ++i) {
+            crc = (crc & 0x0001) ? static_cast<uint16_t>((crc >> 1) ^ CRC16_POLY) : static_cast<uint16_t>(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+constexpr uint16_t crc16Table(const uint8_t *data, size_t size, uint16_t crc = CRC16_INIT) {
+    for (size_t n = 0; n < size; ++n) {
+        crc = static_cast<uint16_t>((crc >> 8) ^ CRC16_TABLES[0][(crc ^ data[n]) & 0xFF]);
+    }
+    return crc;
+}
+
+constexpr uint16_t crc16Slicing4(const uint8_t *data, size_t size, uint16_t crc = CRC16_INIT) {
+    // Los 2 primeros bytes se mezclan con el registro y los otros 2 van directos a su tabla, 4 consultas independientes por vuelta
+    while (size >= 4) {
+        crc ^= static_cast<uint16_t>(data[0] | (data[1] << 8));
+        crc = CRC16_TABLES[3][crc & 0xFF] ^ CRC16_TABLES[2][crc >> 8] ^
+              CRC16_TABLES[1][data[2]] ^ CRC16_TABLES[0][data[3]];
+        data += 4;
+        size -= 4;
+    }
+    return crc16Table(data, size, crc);
+}
+
+constexpr uint16_t crc16Slicing8(const uint8_t *data, size_t size, uint16_t crc = CRC16_INIT) {
+    while (size >= 8) {
+        crc ^= static_cast<uint16_t>(data[0] | (data[1] << 8));
+        crc = CRC16_TABLES[7][crc & 0xFF] ^ CRC16_TABLES[6][crc >> 8] ^
+              CRC16_TABLES[5][data[2]] ^ CRC16_TABLES[4][data[3]] ^
+              CRC16_TABLES[3][data[4]] ^ CRC16_TABLES[2][data[5]] ^
+              CRC16_TABLES[1][data[6]] ^ CRC16_TABLES[0][data[7]];
+        data += 8;
+        size -= 8;
+    }
+    return crc16Slicing4(data, size, crc);
+}
+
+bool crc16ClmulSupported(); // La CPU tiene PCLMULQDQ y SSE4.1 (se comprueba una vez)
+uint16_t crc16Clmul(const uint8_t *data, size_t size, uint16_t crc = CRC16_INIT); // Si la CPU no lo soporta cae a slicing-by-8
+
+uint16_t crc16Compute(const uint8_t *data, size_t size); // La variante más rápida disponible, elegida en tiempo de ejecución
+uint16_t crc16Compute(CRCVARIANT variant, const uint8_t *data, size_t size); // Una variante concreta (benchmarks y pruebas)
+CRCVARIANT crc16ActiveVariant(); // Variante que usa crc16Compute en esta máquina
+const char *crc16VariantName(CRCVARIANT variant); // Nombre para logs y benchmarks
+
+// Valida de golpe count tramas de frameSize bytes seguidas en memoria (capturas, volcados masivos)
+// Cada trama lleva su CRC en big endian en los 2 últimos bytes, valid[i] queda a 1 si cuadra; devuelve cuántas son válidas
+size_t crc16ValidateFrames(const uint8_t *frames, size_t frameSize, size_t count, uint8_t *valid);
+size_t crc16ValidateFrames(CRCVARIANT variant, const uint8_t *frames, size_t frameSize, size_t count, uint8_t *valid);
+
+#endif // CRC16_H
@@ -0,0 +1,325 @@
+#include "emulator.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+using namespace std;
+
+EoleEmulator::EoleEmulator(const EmulatorConfig &config)
+    : config(config), random(config.seed), masterFd(-1), slaveFd(-1), running(false) {
+
+    // Valores realistas para que la app pueda hacer la secuencia de conexión completa
+    registers[INT_TIME_ADDRESS] = EMULATOR_DEFAULT_TINT;
+    registers[INT_PERIOD_ADDRESS] = EMULATOR_DEFAULT_TFRAME;
+    registers[GPOL_ADDRESS] = EMULATOR_DEFAULT_GPOL;
+    registers[MCK_ADDRESS] = EMULATOR_DEFAULT_MCK;
+    registers[OUTPUT_ADDRESS] = EMULATOR_DEFAULT_OUTPUT;
+}
+
+EoleEmulator::~EoleEmulator() {
+    stop();
+}
+
+bool EoleEmulator::start() {
+    if (running) return true;
+
+    masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (masterFd < 0 || grantpt(masterFd) != 0 || unlockpt(masterFd) != 0) {
+        cerr << "Emulator: could not create pseudo-terminal: " << strerror(errno) << "\n";
+        stop();
+        return false;
+    }
+    slaveName = ptsname(masterFd);
+
+    // Modo raw: ni eco, ni traducción de saltos de línea, los bytes pasan tal cual
+    termios settings;
+    tcgetattr(masterFd, &settings);
+    cfmakeraw(&settings);
+    cfsetispeed(&settings, B115200);
+    cfsetospeed(&settings, B115200);
+    tcsetattr(masterFd, TCSANOW, &settings);
+
+    // Con el esclavo abierto también por nuestro lado el maestro no da EIO entre conexiones de la app
+    slaveFd = open(slaveName.c_str(), O_RDWR | O_NOCTTY);
+    if (slaveFd < 0) {
+        cerr << "Emulator: could not open " << slaveName << ": " << strerror(errno) << "\n";
+        stop();
+        return false;
+    }
+
+    input.clear();
+    running = true;
+    worker = thread([this]() { run(); });
+    return true;
+}
+
+void EoleEmulator::stop() {
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (slaveFd >= 0) {
+        close(slaveFd);
+        slaveFd = -1;
+    }
+    if (masterFd >= 0) {
+        close(masterFd);
+        masterFd = -1;
+    }
+}
+
+string EoleEmulator::portName() const {
+    return slaveName;
+}
+
+void EoleEmulator::setConfig(const EmulatorConfig &newConfig) {
+    lock_guard<mutex> locker(stateMutex);
+    config = newConfig;
+}
+
+void EoleEmulator::setRegister(uint32_t address, uint32_t value) {
+    lock_guard<mutex> locker(stateMutex);
+    registers[address] = value;
+}
+
+uint32_t EoleEmulator::registerValue(uint32_t address) const {
+    lock_guard<mutex> locker(stateMutex);
+    auto it = registers.find(address);
+    return it == registers.end() ? 0 : it->second;
+}
+
+EmulatorStats EoleEmulator::stats() const {
+    lock_guard<mutex> locker(stateMutex);
+    return statistics;
+}
+
+void EoleEmulator::run() {
+    uint8_t chunk[RX_BUFFER_SIZE];
+
+    while (running) {
+        pollfd descriptor = {masterFd, POLLIN, 0};
+        int ready = poll(&descriptor, 1, EMULATOR_POLL_TIME);
+        if (ready <= 0 || !(descriptor.revents & POLLIN)) continue;
+
+        ssize_t received = read(masterFd, chunk, sizeof(chunk));
+        if (received <= 0) continue;
+
+        input.insert(input.end(), chunk, chunk + received);
+        processInput();
+    }
+}
+
+void EoleEmulator::processInput() {
+    // Como el sensor, atiende las peticiones en orden de llegada (varias seguidas si la app las manda en ráfaga)
+    while (input.size() >= READ_REQUEST_SIZE) {
+        if (input[0] != PACKET_HEADER_BYTE || (input[1] != PACKET_READ_COMMAND && input[1] != PACKET_WRITE_COMMAND)) {
+            input.erase(input.begin()); // Basura o resto de una petición anterior, se busca la siguiente cabecera
+            lock_guard<mutex> locker(stateMutex);
+            statistics.discardedBytes++;
+            continue;
+        }
+
+        size_t size = (input[1] == PACKET_WRITE_COMMAND) ? WRITE_REQUEST_SIZE : READ_REQUEST_SIZE;
+        if (input.size() < size) return; // Falta el resto de la escritura
+
+        handleRequest(input.data(), size);
+        input.erase(input.begin(), input.begin() + size);
+    }
+}
+
+void EoleEmulator::handleRequest(const uint8_t *request, size_t size) {
+    EmulatorConfig current;
+    {
+        lock_guard<mutex> locker(stateMutex);
+        current = config;
+    }
+
+    // Tiempo de respuesta del sensor, con su variación
+    int delayUs = current.latencyUs;
+    if (current.jitterUs > 0) {
+        delayUs += uniform_int_distribution<int>(-current.jitterUs, current.jitterUs)(random);
+    }
+    if (delayUs > 0) {
+        this_thread::sleep_for(chrono::microseconds(delayUs));
+    }
+
+    uint32_t address = loadBigEndian32(request + 2);
+    if (!packetCrcMatches(request, size)) {
+        {
+            lock_guard<mutex> locker(stateMutex);
+            statistics.badRequests++;
+        }
+        sendResponse(PACKET_STATUS_NOTOK, 0);
+        return;
+    }
+
+    if (chance(current.notOkProbability)) {
+        sendResponse(PACKET_STATUS_NOTOK, 0);
+        return;
+    }
+
+    uint32_t value;
+    {
+        lock_guard<mutex> locker(stateMutex);
+        if (request[1] == PACKET_WRITE_COMMAND) {
+            value = loadBigEndian32(request + 6);
+            registers[address] = value; // La respuesta a una escritura confirma el valor escrito
+            statistics.writes++;
+        } else {
+            auto it = registers.find(address);
+            value = (it == registers.end()) ? 0 : it->second;
+            statistics.reads++;
+        }
+    }
+    sendResponse(PACKET_STATUS_OK, value);
+}
+
+void EoleEmulator::sendResponse(uint8_t status, uint32_t value) {
+    EmulatorConfig current;
+    {
+        lock_guard<mutex> locker(stateMutex);
+        current = config;
+        if (status == PACKET_STATUS_NOTOK) statistics.notOkResponses++;
+    }
+
+    uint8_t response[RESPONSE_SIZE];
+    response[0] = PACKET_HEADER_BYTE;
+    response[1] = status;
+    storeBigEndian32(response + 2, value);
+    sealPacket(response, RESPONSE_SIZE);
+
+    if (chance(current.corruptCrcProbability)) {
+        response[RESPONSE_SIZE - 1] ^= 0xFF;
+        lock_guard<mutex> locker(stateMutex);
+        statistics.corruptedCrcs++;
+    }
+
+    // Bytes perdidos por el camino
+    uint8_t wire[RESPONSE_SIZE];
+    size_t wireSize = 0;
+    for (size_t i = 0; i < RESPONSE_SIZE; ++i) {
+        if (chance(current.dropProbability)) {
+            lock_guard<mutex> locker(stateMutex);
+            statistics.droppedBytes++;
+            continue;
+        }
+        wire[wireSize++] = response[i];
+    }
+
+    // Respuesta partida en dos lecturas, como cuando el adaptador USB entrega la trama a trozos
+    if (wireSize > 1 && chance(current.splitProbability)) {
+        size_t first = uniform_int_distribution<size_t>(1, wireSize - 1)(random);
+        writeAll(wire, first);
+        this_thread::sleep_for(chrono::microseconds(current.splitGapUs));
+        writeAll(wire + first, wireSize - first);
+        lock_guard<mutex> locker(stateMutex);
+        statistics.splitResponses++;
+        return;
+    }
+    writeAll(wire, wireSize);
+}
+
+void EoleEmulator::writeAll(const uint8_t *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(masterFd, data, size);
+        if (written < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            cerr << "Emulator: write error: " << strerror(errno) << "\n";
+            return;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+bool EoleEmulator::chance(double probability) {
+    if (probability <= 0.0) return false;
+    if (probability >= 1.0) return true;
+    return uniform_real_distribution<double>(0.0, 1.0)(random) < probability;
+}
+
+#ifdef EOLE_EMULATOR
+
+#include <csignal>
+#include <cstdlib>
+
+static atomic<bool> keepRunning(true);
+
+static void stopEmulator(int) {
+    keepRunning = false;
+}
+
+static void printUsage() {
+    cout << "Usage: eole_emulator [options]\n"
+         << "  --latency-us N     response latency (default " << EMULATOR_DEFAULT_LATENCY_US << ")\n"
+         << "  --jitter-us N      +- random variation over the latency\n"
+         << "  --split P          probability of sending a response in two chunks\n"
+         << "  --split-gap-us N   pause between chunks (default " << EMULATOR_SPLIT_GAP_US << ")\n"
+         << "  --drop P           probability of dropping each response byte\n"
+         << "  --corrupt P        probability of sending a wrong CRC\n"
+         << "  --notok P          probability of answering NOTOK\n"
+         << "  --seed N           random seed\n"
+         << "  --link PATH        also create a symlink to the slave (for example /tmp/ttyEOLE)\n";
+}
+
+int main(int argc, char *argv[]) {
+    EmulatorConfig config;
+    string link;
+
+    for (int i = 1; i < argc; ++i) {
+        string option = argv[i];
+        if (option == "--help" || i + 1 >= argc) {
+            printUsage();
+            return option == "--help" ? 0 : 1;
+        }
+        const char *value = argv[++i];
+        if (option == "--latency-us") config.latencyUs = atoi(value);
+        else if (option == "--jitter-us") config.jitterUs = atoi(value);
+        else if (option == "--split") config.splitProbability = atof(value);
+        else if (option == "--split-gap-us") config.splitGapUs = atoi(value);
+        else if (option == "--drop") config.dropProbability = atof(value);
+        else if (option == "--corrupt") config.corruptCrcProbability = atof(value);
+        else if (option == "--notok") config.notOkProbability = atof(value);
+        else if (option == "--seed") config.seed = static_cast<unsigned>(strtoul(value, nullptr, 10));
+        else if (option == "--link") link = value;
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    EoleEmulator emulator(config);
+    if (!emulator.start()) return 1;
+
+    if (!link.empty()) {
+        unlink(link.c_str());
+        if (symlink(emulator.portName().c_str(), link.c_str()) != 0) {
+            cerr << "Could not create link " << link << ": " << strerror(errno) << "\n";
+        }
+    }
+
+    cout << "EOLE emulator listening on " << emulator.portName() << (link.empty() ? "" : " (" + link + ")") << endl;
+
+    signal(SIGINT, stopEmulator);
+    signal(SIGTERM, stopEmulator);
+    while (keepRunning) {
+        this_thread::sleep_for(chrono::milliseconds(200));
+    }
+
+    emulator.stop();
+    if (!link.empty()) unlink(link.c_str());
+
+    EmulatorStats stats = emulator.stats();
+    cout << "\nreads " << stats.reads << ", writes " << stats.writes << ", bad requests " << stats.badRequests
+         << ", discarded bytes " << stats.discardedBytes << ", split " << stats.splitResponses
+         << ", dropped bytes " << stats.droppedBytes << ", corrupted CRCs " << stats.corruptedCrcs
+         << ", NOTOK " << stats.notOkResponses << endl;
+    return 0;
+}
+
+#endif // EOLE_EMULATOR
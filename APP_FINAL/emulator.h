@@ -0,0 +1,90 @@
+#ifndef EMULATOR_H
+#define EMULATOR_H
+
+// Emulador del EOLE sobre un pseudo-terminal de Linux, para medir y probar sin el sensor conectado
+// Habla el protocolo real (HEADER 0x40, lectura 0x90, escritura 0x99, status 0x80/0x88 y CRC16-Modbus) y la app se conecta
+// al lado esclavo (/dev/pts/N) como a cualquier puerto serie
+// Programa suelto: g++ -O2 -std=c++17 -pthread -DEOLE_EMULATOR emulator.cpp -o eole_emulator
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "packetcodec.h"
+#include "values.h"
+
+using namespace std;
+
+#define EMULATOR_DEFAULT_LATENCY_US 2000 // Lo que tarda el sensor real en contestar, más o menos (en us)
+#define EMULATOR_POLL_TIME 50 // Cada cuánto (ms) mira el hilo si tiene que parar cuando no llega nada
+#define EMULATOR_SPLIT_GAP_US 500 // Pausa entre los dos trozos de una respuesta partida (en us)
+
+// Valores por defecto del banco de registros, los mismos que devolvía readTestData
+#define EMULATOR_DEFAULT_TINT 0x000160AE
+#define EMULATOR_DEFAULT_TFRAME 0x0002E80C
+#define EMULATOR_DEFAULT_GPOL 0x000009F6
+#define EMULATOR_DEFAULT_MCK 0x00090010
+#define EMULATOR_DEFAULT_OUTPUT 0x0000000C
+
+struct EmulatorConfig { // Comportamiento del emulador, por defecto un sensor perfecto
+    int latencyUs = EMULATOR_DEFAULT_LATENCY_US; // Tiempo desde que llega la petición completa hasta que se empieza a responder
+    int jitterUs = 0;                   // Variación aleatoria (uniforme, +-) sobre la latencia
+    double splitProbability = 0.0;      // Probabilidad de mandar la respuesta en dos trozos con una pausa en medio
+    int splitGapUs = EMULATOR_SPLIT_GAP_US; // Pausa entre trozos
+    double dropProbability = 0.0;       // Probabilidad de perder cada byte de la respuesta
+    double corruptCrcProbability = 0.0; // Probabilidad de mandar la respuesta con el CRC mal
+    double notOkProbability = 0.0;      // Probabilidad de contestar NOTOK a una petición correcta
+    unsigned seed = 1;                  // Semilla, para poder repetir exactamente una prueba
+};
+
+struct EmulatorStats { // Lo que ha pasado desde que se arrancó
+    uint64_t reads = 0;          // Peticiones de lectura atendidas
+    uint64_t writes = 0;         // Peticiones de escritura atendidas
+    uint64_t badRequests = 0;    // Peticiones con CRC incorrecto (se contestan NOTOK)
+    uint64_t discardedBytes = 0; // Bytes que no formaban parte de ninguna petición
+    uint64_t splitResponses = 0; // Respuestas mandadas en dos trozos
+    uint64_t droppedBytes = 0;   // Bytes de respuesta perdidos a propósito
+    uint64_t corruptedCrcs = 0;  // Respuestas mandadas con el CRC mal a propósito
+    uint64_t notOkResponses = 0; // Respuestas NOTOK (forzadas o por petición incorrecta)
+};
+
+class EoleEmulator {
+public:
+    explicit EoleEmulator(const EmulatorConfig &config = EmulatorConfig()); // Constructor
+    ~EoleEmulator(); // Destructor, para el hilo y cierra el pty
+
+    bool start(); // Abre el pty y arranca el hilo que atiende las peticiones
+    void stop(); // Para el hilo y cierra el pty
+    string portName() const; // Ruta del lado esclavo, la que se le pasa a SerialManager::openPort
+
+    void setConfig(const EmulatorConfig &config); // Cambiar el comportamiento en caliente
+    void setRegister(uint32_t address, uint32_t value); // Poner un valor en el banco de registros
+    uint32_t registerValue(uint32_t address) const; // Valor actual de un registro (0 si nunca se escribió)
+    EmulatorStats stats() const; // Contadores desde el arranque
+
+private:
+    void run(); // Bucle del hilo: lee del pty, separa peticiones y contesta
+    void processInput(); // Busca peticiones completas en el buffer de entrada
+    void handleRequest(const uint8_t *request, size_t size); // Atiende una petición completa y correcta de formato
+    void sendResponse(uint8_t status, uint32_t value); // Aplica los fallos configurados y escribe la respuesta
+    void writeAll(const uint8_t *data, size_t size); // Escribe en el pty aunque sea en varias veces
+    bool chance(double probability); // true con la probabilidad dada
+
+    EmulatorConfig config;              // Comportamiento actual
+    mutable mutex stateMutex;           // Protege config, registers y statistics
+    map<uint32_t, uint32_t> registers;  // Banco de registros del sensor
+    EmulatorStats statistics;           // Contadores
+    mt19937 random;                     // Generador de los fallos (solo desde el hilo del emulador)
+    vector<uint8_t> input;              // Bytes recibidos que aún no forman una petición completa
+    int masterFd;                       // Lado maestro del pty, el del emulador
+    int slaveFd;                        // Lado esclavo abierto por nosotros para que el pty no se cierre cuando la app desconecta
+    string slaveName;                   // Ruta del lado esclavo
+    thread worker;                      // Hilo que atiende las peticiones
+    atomic<bool> running;               // El hilo sigue vivo
+};
+
+#endif // EMULATOR_H
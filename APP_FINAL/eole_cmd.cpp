@@ -1,54 +1,29 @@
 #include "eole_cmd.h" // Incluir el archivo header
+#include "packetcodec.h" // Formato de los paquetes y CRC compartidos con la app
 
 // Aqui se implementa la funcionalidad de la libreria
-// Cambiar extensión a .c y ya está adaptada para funcionar perfectamente en C
+// Los paquetes se codifican con packetcodec.h (C++ solo cabecera), así que se compila como .cpp
+// Las estructuras son bytes sueltos sin relleno, el codec escribe y lee directamente sobre ellas sin copias
 
-void buildReadPacket(READ_REQUEST_PACKET *readPacket, uint32_t address) { // Pasamos el puntero del paquete por referencia
-
-    readPacket->read_header = HEADER; // Asignamos la cabecera
-    readPacket->read_command_id = READ_COMMAND_ID; // Asignamos el ID del comando de lectura
+static_assert(sizeof(READ_REQUEST_PACKET) == READ_REQUEST_SIZE, "READ_REQUEST_PACKET no coincide con el codec");
+static_assert(sizeof(WRITE_REQUEST_PACKET) == WRITE_REQUEST_SIZE, "WRITE_REQUEST_PACKET no coincide con el codec");
+static_assert(sizeof(RESPONSE_PACKET) == RESPONSE_SIZE, "RESPONSE_PACKET no coincide con el codec");
 
-    address = TO_BIG_ENDIAN_32(address); // Ajustamos a BIG ENDIAN la direccion del registro
-    memcpy(&readPacket->read_address_byte1, &address, sizeof(address)); // Copiamos en memoria la direccion del registro
+void buildReadPacket(READ_REQUEST_PACKET *readPacket, uint32_t address) { // Pasamos el puntero del paquete por referencia
 
-    crc16Modbus(&readPacket->read_header, READ_AND_RESPONSE_PACKET_SIZE); // Calculamos el CRC del paquete
+    encodeReadRequest(&readPacket->read_header, address); // Cabecera, comando de lectura, direccion en BIG ENDIAN y CRC
 }
 
 void buildWritePacket(WRITE_REQUEST_PACKET *writePacket, uint32_t address, uint32_t data) { // Pasamos el puntero del paquete por referencia y los datos a enviar
 
-    writePacket->write_header = HEADER; // Asignamos la cabecera
-    writePacket->write_command_id = WRITE_COMMAND_ID; // Asignamos el ID del comando de escritura
-
-    address = TO_BIG_ENDIAN_32(address); // Ajustamos a BIG ENDIAN la direccion del registro
-    memcpy(&writePacket->write_address_byte1, &address, sizeof(address)); // Copiamos en memoria la direccion del registro
-
-    data = TO_BIG_ENDIAN_32(data); // Ajustamos a BIG ENDIAN los datos a escribir
-    memcpy(&writePacket->write_data_byte1, &data, sizeof(data)); // Copiamos en memoria los datos a enviar
-
-    crc16Modbus(&writePacket->write_header, WRITE_PACKET_SIZE); // Calculamos el CRC del paquete
+    encodeWriteRequest(&writePacket->write_header, address, data); // Cabecera, comando de escritura, direccion y datos en BIG ENDIAN y CRC
 }
 
 void readResponsePacket(RESPONSE_PACKET *responsePacket, uint32_t *data) { // Pasamos el puntero del paquete por referencia y la variable donde guardar los datos recibidos
 
-    uint8_t status = EMPTY; // Creamos una variable de status para confirmar el estado de la respuesta
-    memcpy(&status, &responsePacket->response_status, sizeof(status)); // Copiamos en memoria el status recibido
-
-    uint16_t crcReceived = EMPTY; // Creamos una variable para guardar el CRC recibido del paquete de respuesta
-    memcpy(&crcReceived, &responsePacket->response_crc_byte1, sizeof(crcReceived)); // Copiamos en memoria el CRC recibido
+    uint32_t tempData = EMPTY; // Variable temporal para los datos recibidos
 
-    READ_REQUEST_PACKET aux; // Creamos un paquete auxiliar
-    memcpy(&aux, responsePacket, READ_AND_RESPONSE_PACKET_SIZE); // Copiamos en memoria todos los bytes del paquete de respuesta
-
-    uint16_t crcCalculated = EMPTY; // Creamos una nueva variable para un CRC ideal
-    crc16Modbus(&aux.read_header, READ_AND_RESPONSE_PACKET_SIZE); // Creamos el CRC que deberia tener un paquete de respuesta correcto
-    memcpy(&crcCalculated, &aux.read_crc_byte1, sizeof(crcCalculated)); // Copiamos en memoria el CRC que se ha calculado
-
-    if ((status == PACKET_RESPONSE_OK) && (crcReceived == crcCalculated)) { // Comparamos tanto el status como el CRC calculado con el obtenido para verificar la respuesta
-
-        uint32_t tempData = EMPTY; // Si es correcta, guardamos una variable de datos vacia
-        memcpy(&tempData, &responsePacket->response_data_byte1, sizeof(tempData)); // Copiamos en memoria de esta variable los datos recibidos
-
-        tempData = TO_BIG_ENDIAN_32(tempData); // Pasamos a BIG ENDIAN los datos recibidos en la variable temporal
+    if (decodeResponse(&responsePacket->response_header, tempData) == DECODE_OK) { // Comprueba cabecera, status OK y CRC, y pasa los datos de BIG ENDIAN
         *data = tempData; // Asignamos por referencia los datos recibidos ya procesados
     }
 
@@ -56,24 +31,5 @@ void readResponsePacket(RESPONSE_PACKET *responsePacket, uint32_t *data) { // Pa
 
 void crc16Modbus(uint8_t *pointer, uint8_t size) { // Pasamos por referencia el puntero, que comienza en el byte header del paquete, y el tamaño del paquete
 
-    uint8_t *p = pointer; // Puntero auxiliar para no mover de posicion el original
-    uint8_t aux = 0; // Auxiliar para iterar sobre sus valores y no los del puntero
-    uint16_t crc = FULL_16; // Creamos los 2 bytes que tendran el CRC
-
-    for (int i = 0; i < size - 2; i++) { // Aplicamos el algoritmo sobre todo el paquete quitando los 2 ultimos bytes, que seran el CRC
-        aux = *p; // Iteramos sobre el aux
-        crc ^= aux; // El valor donde comienza el puntero
-        for (int j = 0; j < BYTE_SIZE; j++) {
-            if (crc & 0x0001) {
-                crc >>= 1;
-                crc ^= 0xA001;
-            } else {
-                crc >>= 1;
-            }
-        }
-        p++; // Avanzamos a la siguiente direccion el puntero
-    }
-
-    crc = TO_BIG_ENDIAN_16(crc); // Hay que ponerlo en big endian
-    memcpy(pointer + size - 2, &crc, sizeof(crc)); // Como ya hemos movido el puntero en el bucle, ya apunta a donde quedaria el byte 1 del CRC
+    sealPacket(pointer, size); // Calcula el CRC sobre todo el paquete quitando los 2 ultimos bytes y lo escribe en ellos en BIG ENDIAN
 }
@@ -0,0 +1,201 @@
+#include "fleet.h"
+#include "manager.h"
+#include "registerrules.h"
+#include "values.h"
+
+using namespace std;
+
+FleetManager::FleetManager(QObject *parent) : QObject(parent) {
+}
+
+FleetManager::~FleetManager() {
+    // Cada manejador cierra su puerto y para su hilo al destruirse
+    closeAll();
+}
+
+void FleetManager::setPorts(const QStringList &ports) {
+    closeAll();
+    fleet.clear();
+
+    for (const QString &port : ports) {
+        Device device;
+        device.portName = port;
+        device.engine.reset(new manager());
+        fleet.push_back(move(device));
+    }
+}
+
+int FleetManager::size() const {
+    return static_cast<int>(fleet.size());
+}
+
+QString FleetManager::portName(int device) const {
+    return fleet[device].portName;
+}
+
+bool FleetManager::isOpen(int device) const {
+    return fleet[device].open;
+}
+
+void FleetManager::openAll(function<void(int, bool)> callback) {
+    // Cada apertura va a su propio hilo serie, las N se hacen a la vez
+    for (int device = 0; device < size(); ++device) {
+        if (fleet[device].open || fleet[device].opening) continue;
+        manager *engine = fleet[device].engine.get();
+        fleet[device].opening = true;
+        int request = ++fleet[device].openRequest;
+        engine->openPort(fleet[device].portName, [this, engine, device, request, callback](bool opened) {
+            // Si mientras tanto cambió la flota, este manejador ya no existe y la respuesta no sirve
+            if (device >= size() || fleet[device].engine.get() != engine) return;
+
+            Device &entry = fleet[device];
+            if (entry.openRequest != request) {
+                // Se cerró mientras se abría: si nadie ha vuelto a pedir abrirlo, se cierra ahora que ya está abierto
+                if (opened && !entry.opening && !entry.open) engine->closePort();
+                return;
+            }
+            entry.opening = false;
+            entry.open = opened;
+            if (callback) callback(device, opened);
+        });
+    }
+}
+
+void FleetManager::closeAll() {
+    for (Device &device : fleet) {
+        if (device.open) device.engine->closePort();
+        device.open = false;
+        device.opening = false;
+        device.openRequest++;
+    }
+}
+
+void FleetManager::broadcastRead(const vector<int> &devices, int address, FleetProgressCallback progress, FleetCallback callback) {
+    broadcast(devices, [address](manager *engine, FleetStepCallback done) {
+        engine->readRegister(address, [done](const TransactionResult &result) {
+            FleetResult entry;
+            entry.result = result;
+            done(entry);
+        });
+    }, progress, callback);
+}
+
+void FleetManager::broadcastWrite(const vector<int> &devices, int address, uint32_t value, FleetProgressCallback progress, FleetCallback callback) {
+    broadcast(devices, [address, value](manager *engine, FleetStepCallback done) { writeDevice(engine, address, value, done); },
+              progress, callback);
+}
+
+void FleetManager::writeDevice(manager *engine, int address, uint32_t value, FleetStepCallback done) {
+    // Los callbacks solo llegan mientras el manejador existe, así que engine sigue valiendo en cada paso
+    if (address != INT_PERIOD_ADDRESS) {
+        engine->writeRegister(address, value, [engine, address, value, done](const TransactionResult &result) {
+            FleetResult entry;
+            entry.result = result;
+            if (address == INT_TIME_ADDRESS && result.status == TRANSACTION_OK) {
+                writeMinimumPeriod(engine, value, entry, done);
+            } else {
+                done(entry);
+            }
+        });
+        return;
+    }
+
+    // Que nunca supere el TFrame al TInt, con el TInt que tenga cada sensor
+    engine->readCachedRegister(INT_TIME_ADDRESS, [engine, address, value, done](const TransactionResult &intTime) {
+        FleetResult entry;
+        entry.result = intTime;
+        if (intTime.status != TRANSACTION_OK) {
+            entry.result.type = WRITE_TRANSACTION;
+            entry.rejected = "TInt could not be read";
+            done(entry);
+            return;
+        }
+
+        REGISTERCHECK check = checkPeriod(value, intTime.value);
+        if (check != REGISTER_VALID) {
+            entry.result.type = WRITE_TRANSACTION;
+            entry.result.status = TRANSACTION_CANCELLED;
+            entry.rejected = registerCheckMessage(check);
+            done(entry);
+            return;
+        }
+
+        engine->writeRegister(address, value, [done](const TransactionResult &result) {
+            FleetResult written;
+            written.result = result;
+            done(written);
+        });
+    });
+}
+
+void FleetManager::writeMinimumPeriod(manager *engine, uint32_t intTime, FleetResult entry, FleetStepCallback done) {
+    // Lo mismo que writeOnInit en la ventana principal: con el OUTPUT y el MCK de este sensor (casi siempre de la caché),
+    // el TFRAME mínimo para el TINT nuevo
+    entry.hasPeriod = true;
+    engine->readCachedRegister(OUTPUT_ADDRESS, [engine, intTime, entry, done](const TransactionResult &output) mutable {
+        if (output.status != TRANSACTION_OK) {
+            entry.period = output;
+            done(entry);
+            return;
+        }
+
+        engine->readCachedRegister(MCK_ADDRESS, [engine, intTime, entry, done, output](const TransactionResult &mck) mutable {
+            if (mck.status != TRANSACTION_OK) {
+                entry.period = mck;
+                done(entry);
+                return;
+            }
+
+            SensorClock clock;
+            decodeOutputRegister(output.value, clock);
+            decodeMckRegister(mck.value, clock);
+            uint32_t period = minimumPeriodValue(minimumFrameTime(intTime, clock), clock);
+            engine->writeRegister(INT_PERIOD_ADDRESS, period, [entry, done](const TransactionResult &result) mutable {
+                entry.period = result;
+                done(entry);
+            });
+        });
+    });
+}
+
+void FleetManager::broadcast(const vector<int> &devices, function<void(manager*, FleetStepCallback)> operation,
+                             FleetProgressCallback progress, FleetCallback callback) {
+    struct Broadcast { // Lo que comparten los callbacks de todos los dispositivos de una misma operación
+        vector<FleetResult> results;
+        size_t remaining;
+        chrono::steady_clock::time_point start;
+    };
+
+    shared_ptr<Broadcast> state = make_shared<Broadcast>();
+    state->results.resize(devices.size());
+    state->remaining = devices.size();
+    state->start = chrono::steady_clock::now();
+
+    if (devices.empty()) {
+        if (callback) callback(state->results, 0);
+        return;
+    }
+
+    // Se encola en todos antes de esperar a ninguno: cada manejador la manda desde su hilo en cuanto la recibe
+    for (size_t slot = 0; slot < devices.size(); ++slot) {
+        int device = devices[slot];
+        state->results[slot].device = device;
+        state->results[slot].portName = fleet[device].portName;
+
+        FleetStepCallback done = [state, slot, progress, callback](const FleetResult &step) {
+            FleetResult &entry = state->results[slot];
+            entry.result = step.result;
+            entry.rejected = step.rejected;
+            entry.hasPeriod = step.hasPeriod;
+            entry.period = step.period;
+            entry.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - state->start).count();
+            if (progress) progress(entry);
+
+            if (--state->remaining > 0) return;
+            double totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - state->start).count();
+            if (callback) callback(state->results, totalMs);
+        };
+
+        operation(fleet[device].engine.get(), done);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include "transaction.h"
+
+// Modo flota: varios sensores a la vez, cada uno con su propio manejador (y por tanto su propio hilo serie y su propia cola)
+// Una lectura o escritura se reparte a todos los dispositivos de golpe y se recogen los resultados de cada uno,
+// así configurar N sensores tarda lo que tarde el más lento y no la suma de todos
+
+using namespace std;
+
+class manager;
+
+struct FleetResult { // Resultado de una operación en un dispositivo de la flota
+    int device = 0;           // Índice del dispositivo en la flota
+    QString portName;         // Puerto del dispositivo
+    TransactionResult result; // Lo que devolvió su manejador
+    QString rejected;         // Si no se llegó a escribir por las reglas de los registros, por qué (vacío si se mandó)
+    bool hasPeriod = false;   // Tras escribir TINT se ajustó el TFRAME de este dispositivo
+    TransactionResult period; // Resultado de ese ajuste (el primer paso que falló, o la escritura del TFRAME)
+    double elapsedMs = 0;     // Desde que se repartió la operación hasta su resultado
+
+    bool succeeded() const { return result.status == TRANSACTION_OK && (!hasPeriod || period.status == TRANSACTION_OK); }
+};
+
+typedef function<void(const FleetResult&)> FleetProgressCallback; // Cada dispositivo según termina, en el hilo de la UI
+typedef function<void(const FleetResult&)> FleetStepCallback; // Fin de la operación en un dispositivo (sin device, portName ni tiempo)
+typedef function<void(const vector<FleetResult>&, double)> FleetCallback; // Todos terminados, por dispositivo y con el tiempo total (ms)
+
+class FleetManager : public QObject {
+    Q_OBJECT
+
+public:
+    explicit FleetManager(QObject *parent = nullptr); // Constructor
+    ~FleetManager(); // Destructor, cierra todos los puertos
+
+    void setPorts(const QStringList &ports); // Un dispositivo (y un manejador) por puerto, los anteriores se cierran
+    int size() const; // Dispositivos en la flota
+    QString portName(int device) const; // Puerto de un dispositivo
+    bool isOpen(int device) const; // El puerto del dispositivo está abierto
+
+    void openAll(function<void(int, bool)> callback); // Abre a la vez todos los que no estén abiertos, avisa de cada uno (dispositivo y si se abrió)
+    void closeAll(); // Cierra todos (cancela lo pendiente, también las aperturas que aún no han contestado)
+    void broadcastRead(const vector<int> &devices, int address, FleetProgressCallback progress, FleetCallback callback); // Lee address en todos
+    // Escribe en todos; el valor ya viene comprobado (registerrules), aquí va lo que depende de cada sensor:
+    // un TFRAME no se escribe si queda por debajo del TINT de ese sensor, y tras un TINT se ajusta su TFRAME al mínimo
+    void broadcastWrite(const vector<int> &devices, int address, uint32_t value, FleetProgressCallback progress, FleetCallback callback);
+
+private:
+    struct Device { // Un sensor de la flota
+        QString portName;
+        unique_ptr<manager> engine; // Su propio manejador, con su hilo serie
+        bool open = false;
+        bool opening = false;   // Hay una apertura pedida que aún no ha contestado
+        int openRequest = 0;    // Sube con cada apertura y cada cierre, una respuesta de una apertura anterior ya no vale
+    };
+
+    void broadcast(const vector<int> &devices, function<void(manager*, FleetStepCallback)> operation,
+                   FleetProgressCallback progress, FleetCallback callback); // Reparte la operación y junta los resultados
+    static void writeDevice(manager *engine, int address, uint32_t value, FleetStepCallback done); // Escritura en un sensor con sus reglas
+    static void writeMinimumPeriod(manager *engine, uint32_t intTime, FleetResult entry, FleetStepCallback done); // TFRAME tras un TINT
+
+    vector<Device> fleet; // Dispositivos, en el orden de setPorts
+};
+
+#endif // FLEET_H
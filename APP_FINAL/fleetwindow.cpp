@@ -0,0 +1,259 @@
+#include "fleetwindow.h"
+#include "registerrules.h"
+#include "values.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QTableWidgetItem>
+#include <QMessageBox>
+#include <QBrush>
+#include <QColor>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+FleetWindow::FleetWindow(const QStringList &ports, QWidget *parent) : QWidget(parent, Qt::Window) {
+    setWindowTitle(QString(TITLE) + " - Fleet mode");
+    resize(700, 450);
+    setMinimumSize(500, 300);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setSpacing(8);
+
+    // Abrir y cerrar todos los puertos de la flota
+    QHBoxLayout *portLayout = new QHBoxLayout();
+    connectButton = new QPushButton("Connect all");
+    disconnectButton = new QPushButton("Disconnect all");
+    disconnectButton->setEnabled(false);
+    connect(connectButton, &QPushButton::clicked, this, &FleetWindow::connectAll);
+    connect(disconnectButton, &QPushButton::clicked, this, &FleetWindow::disconnectAll);
+    portLayout->addWidget(connectButton, 1);
+    portLayout->addWidget(disconnectButton, 1);
+    mainLayout->addLayout(portLayout);
+
+    // Una fila por puerto, solo los marcados entran en las lecturas y escrituras
+    table = new QTableWidget(ports.size(), 5);
+    table->setHorizontalHeaderLabels({"Port", "Link", "Status", "Value", "Time (ms)"});
+    table->setEditTriggers(QTableWidget::NoEditTriggers);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    for (int row = 0; row < ports.size(); ++row) {
+        QTableWidgetItem *portItem = new QTableWidgetItem(ports[row]);
+        portItem->setFlags(Qt::ItemIsEnabled | Qt::ItemIsUserCheckable);
+        portItem->setCheckState(Qt::Checked);
+        table->setItem(row, FLEET_PORT, portItem);
+        setCell(row, FLEET_LINK, "Closed");
+    }
+    mainLayout->addWidget(table);
+
+    // Registro, valor y operación
+    QHBoxLayout *operationLayout = new QHBoxLayout();
+    registerSelector = new QComboBox();
+    registerSelector->addItem("TInt (0x098)", INT_TIME_ADDRESS);
+    registerSelector->addItem("TFrame (0x094)", INT_PERIOD_ADDRESS);
+    registerSelector->addItem("GPOL (0x090)", GPOL_ADDRESS);
+    registerSelector->addItem("MCK (0x028)", MCK_ADDRESS);
+    registerSelector->addItem("Output (0x0B0)", OUTPUT_ADDRESS);
+    registerSelector->addItem("Custom register", -1);
+    addressBox = new QLineEdit();
+    addressBox->setPlaceholderText("Address (e.g., 0x098)");
+    addressBox->setEnabled(false);
+    connect(registerSelector, &QComboBox::currentIndexChanged, this, [this]() {
+        addressBox->setEnabled(registerSelector->currentData().toInt() < 0); // Solo el custom necesita dirección
+    });
+    valueBox = new QLineEdit();
+    valueBox->setPlaceholderText("Value (decimal or 0x hex)");
+    readButton = new QPushButton("Read all");
+    writeButton = new QPushButton("Write all");
+    connect(readButton, &QPushButton::clicked, this, &FleetWindow::readAll);
+    connect(writeButton, &QPushButton::clicked, this, &FleetWindow::writeAll);
+    operationLayout->addWidget(registerSelector, 2);
+    operationLayout->addWidget(addressBox, 2);
+    operationLayout->addWidget(valueBox, 2);
+    operationLayout->addWidget(readButton, 1);
+    operationLayout->addWidget(writeButton, 1);
+    mainLayout->addLayout(operationLayout);
+
+    summaryLabel = new QLabel("Connect the ports to start.");
+    mainLayout->addWidget(summaryLabel);
+
+    fleet.setPorts(ports);
+    readButton->setEnabled(false);
+    writeButton->setEnabled(false);
+}
+
+void FleetWindow::connectAll() {
+    connectButton->setEnabled(false);
+    summaryLabel->setText("Opening ports...");
+
+    // Se abren todos a la vez (menos los que ya estén abiertos), cada fila se actualiza cuando responde su hilo
+    int closed = 0;
+    for (int device = 0; device < fleet.size(); ++device) {
+        if (!fleet.isOpen(device)) closed++;
+    }
+    shared_ptr<int> pending = make_shared<int>(closed);
+    shared_ptr<int> opened = make_shared<int>(fleet.size() - closed);
+    fleet.openAll([this, pending, opened](int device, bool success) {
+        setCell(device, FLEET_LINK, success ? "Open" : "Failed", !success);
+        if (success) ++*opened;
+        if (--*pending > 0) return;
+
+        cout << "Fleet: " << *opened << " of " << fleet.size() << " port/s opened.\n";
+        summaryLabel->setText(QString("%1 of %2 port/s opened.").arg(*opened).arg(fleet.size()));
+        disconnectButton->setEnabled(true);
+        connectButton->setEnabled(*opened < fleet.size()); // Se puede reintentar si alguno falló
+        setBusy(false);
+    });
+}
+
+void FleetWindow::disconnectAll() {
+    fleet.closeAll();
+    for (int row = 0; row < fleet.size(); ++row) {
+        setCell(row, FLEET_LINK, "Closed");
+    }
+    connectButton->setEnabled(true);
+    disconnectButton->setEnabled(false);
+    readButton->setEnabled(false);
+    writeButton->setEnabled(false);
+    summaryLabel->setText("All ports closed.");
+}
+
+bool FleetWindow::selectedAddress(int &address) {
+    address = registerSelector->currentData().toInt();
+    if (address >= 0) return true;
+
+    bool ok = false;
+    address = static_cast<int>(addressBox->text().toUInt(&ok, 16)); // El "16" especifica que es hexadecimal
+    if (!ok) {
+        QMessageBox::warning(this, "Invalid Input", "Please enter a valid hexadecimal number (e.g., 0x098).");
+    }
+    return ok;
+}
+
+vector<int> FleetWindow::selectedDevices() const {
+    vector<int> devices;
+    for (int row = 0; row < fleet.size(); ++row) {
+        if (fleet.isOpen(row) && table->item(row, FLEET_PORT)->checkState() == Qt::Checked) devices.push_back(row);
+    }
+    return devices;
+}
+
+void FleetWindow::readAll() {
+    int address = 0;
+    vector<int> devices = selectedDevices();
+    if (!selectedAddress(address)) return;
+    if (devices.empty()) {
+        QMessageBox::warning(this, "Error", "No open port is selected.");
+        return;
+    }
+
+    setBusy(true);
+    clearResults(devices);
+    fleet.broadcastRead(devices, address,
+                        [this](const FleetResult &result) { showResult(result); },
+                        [this](const vector<FleetResult> &results, double totalMs) { showSummary(results, totalMs); });
+}
+
+void FleetWindow::writeAll() {
+    int address = 0;
+    vector<int> devices = selectedDevices();
+    if (!selectedAddress(address)) return;
+    if (devices.empty()) {
+        QMessageBox::warning(this, "Error", "No open port is selected.");
+        return;
+    }
+
+    bool ok = false;
+    uint32_t value = valueBox->text().toUInt(&ok, 0); // Base 0: decimal, o hexadecimal con 0x
+    if (!ok) {
+        QMessageBox::warning(this, "Invalid Input", "Please enter a valid value.");
+        return;
+    }
+
+    // Las mismas reglas que en la ventana principal; TFRAME frente a TINT depende de cada sensor y lo mira la flota
+    // Aquí además MCK y OUTPUT no se escriben nunca (la ventana principal sí deja por el registro custom): un error en todos
+    // los sensores a la vez los deja sin calibrar
+    REGISTERCHECK check = isFactoryRegister(address) ? REGISTER_FACTORY : checkRegisterValue(address, value);
+    if (check != REGISTER_VALID) {
+        QMessageBox::warning(this, "Invalid Input", registerCheckMessage(check));
+        return;
+    }
+
+    setBusy(true);
+    clearResults(devices);
+    fleet.broadcastWrite(devices, address, value,
+                         [this](const FleetResult &result) { showResult(result); },
+                         [this](const vector<FleetResult> &results, double totalMs) { showSummary(results, totalMs); });
+}
+
+void FleetWindow::clearResults(const vector<int> &devices) {
+    for (int device : devices) {
+        setCell(device, FLEET_STATUS, "Pending");
+        setCell(device, FLEET_VALUE, "");
+        setCell(device, FLEET_TIME, "");
+    }
+}
+
+void FleetWindow::showResult(const FleetResult &result) {
+    bool failed = result.result.status != TRANSACTION_OK;
+    QString status = result.rejected.isEmpty() ? statusText(result.result.status) : result.rejected;
+    QString value = failed ? "" : QString("%1 (0x%2)").arg(result.result.value).arg(QString::number(result.result.value, 16).toUpper());
+
+    // Tras un TINT, el TFRAME que se ajustó (o en qué paso se quedó)
+    if (!failed && result.hasPeriod) {
+        if (result.period.status == TRANSACTION_OK) value += QString(", TFrame %1").arg(result.period.value);
+        else status += QString(", TFrame: %1").arg(statusText(result.period.status));
+    }
+
+    setCell(result.device, FLEET_STATUS, status, !result.succeeded());
+    setCell(result.device, FLEET_VALUE, value);
+    setCell(result.device, FLEET_TIME, QString::number(result.elapsedMs, 'f', 1));
+}
+
+void FleetWindow::showSummary(const vector<FleetResult> &results, double totalMs) {
+    // Lo que se ahorra la flota: el total tiene que parecerse al más lento, no a la suma
+    double sumMs = 0;
+    int failures = 0;
+    for (const FleetResult &result : results) {
+        sumMs += result.elapsedMs;
+        if (!result.succeeded()) failures++;
+    }
+
+    QString summary = QString("%1 device/s in %2 ms (%3 ms one after another), %4 failed.")
+                          .arg(results.size()).arg(totalMs, 0, 'f', 1).arg(sumMs, 0, 'f', 1).arg(failures);
+    cout << "Fleet: " << summary.toStdString() << "\n";
+    summaryLabel->setText(summary);
+    setBusy(false);
+}
+
+void FleetWindow::setCell(int row, int column, const QString &text, bool failed) {
+    QTableWidgetItem *item = table->item(row, column);
+    if (!item) {
+        item = new QTableWidgetItem();
+        table->setItem(row, column, item);
+    }
+    item->setText(text);
+    item->setForeground(QBrush(failed ? QColor(Qt::red) : QColor(Qt::black)));
+}
+
+void FleetWindow::setBusy(bool busy) {
+    bool anyOpen = false;
+    for (int device = 0; device < fleet.size(); ++device) {
+        anyOpen = anyOpen || fleet.isOpen(device);
+    }
+    readButton->setEnabled(!busy && anyOpen);
+    writeButton->setEnabled(!busy && anyOpen);
+}
+
+QString FleetWindow::statusText(TRANSACTIONSTATUS status) {
+    switch (status) {
+    case TRANSACTION_OK:         return "OK";
+    case TRANSACTION_SEND_ERROR: return "Send error";
+    case TRANSACTION_TIMEOUT:    return "No response";
+    case TRANSACTION_BAD_FORMAT: return "Bad format";
+    case TRANSACTION_BAD_CRC:    return "Bad CRC";
+    case TRANSACTION_NOTOK:      return "NOTOK";
+    case TRANSACTION_CANCELLED:  return "Cancelled";
+    default:                     return "";
+    }
+}
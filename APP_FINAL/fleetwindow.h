@@ -0,0 +1,59 @@
+#ifndef FLEETWINDOW_H
+#define FLEETWINDOW_H
+
+#include <QWidget>
+#include <QTableWidget>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QLabel>
+#include <QStringList>
+#include <vector>
+#include "fleet.h"
+
+// Ventana del modo flota: una fila por puerto con su estado, y lectura o escritura de un registro en todos los marcados a la vez
+// Los puertos se abren con su propio manejador (FleetManager), independientes del puerto de la ventana principal
+
+using namespace std;
+
+enum FLEETCOLUMNS { // Columnas de la tabla de la flota
+    FLEET_PORT = 0,   // Puerto (marcable, solo los marcados entran en la operación)
+    FLEET_LINK = 1,   // Abierto o no
+    FLEET_STATUS = 2, // Resultado de la última operación
+    FLEET_VALUE = 3,  // Valor leído o confirmado
+    FLEET_TIME = 4    // Tiempo hasta el resultado (ms)
+};
+
+class FleetWindow : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit FleetWindow(const QStringList &ports, QWidget *parent = nullptr); // Constructor, con los puertos que se pueden usar
+
+private:
+    void connectAll();    // Abre todos los puertos de la tabla
+    void disconnectAll(); // Cierra todos
+    void readAll();       // Lee el registro elegido en los marcados
+    void writeAll();      // Escribe el valor en el registro elegido en los marcados
+    bool selectedAddress(int &address); // Dirección del registro elegido (la custom en hexadecimal, como en la ventana principal)
+    vector<int> selectedDevices() const; // Marcados y con el puerto abierto
+    void clearResults(const vector<int> &devices); // Vacía las columnas de resultado de esas filas
+    void showResult(const FleetResult &result); // Rellena la fila de un dispositivo según va terminando
+    void showSummary(const vector<FleetResult> &results, double totalMs); // Total de la flota frente a la suma de los dispositivos
+    void setCell(int row, int column, const QString &text, bool failed = false); // Texto de una celda (en rojo si falló)
+    void setBusy(bool busy); // Deshabilita los botones mientras hay una operación en curso
+    static QString statusText(TRANSACTIONSTATUS status); // Texto corto del resultado para la tabla
+
+    FleetManager fleet;           // Un manejador por puerto
+    QTableWidget *table;          // Una fila por dispositivo
+    QComboBox *registerSelector;  // Registro a leer o escribir
+    QLineEdit *addressBox;        // Dirección del registro custom
+    QLineEdit *valueBox;          // Valor a escribir
+    QPushButton *connectButton;   // Abrir todos
+    QPushButton *disconnectButton;// Cerrar todos
+    QPushButton *readButton;      // Leer en todos
+    QPushButton *writeButton;     // Escribir en todos
+    QLabel *summaryLabel;         // Resumen de la última operación
+};
+
+#endif // FLEETWINDOW_H
@@ -0,0 +1,143 @@
+#include "hotplugmonitor.h"
+#include "values.h"
+#include <QCoreApplication>
+#include <QSocketNotifier>
+#include <cstring>
+#include <iostream>
+
+#ifdef Q_OS_LINUX
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <dbt.h>
+#endif
+
+using namespace std;
+
+HotplugMonitor::HotplugMonitor(QObject *parent) : QObject(parent), socketFd(-1), notifier(nullptr), filtering(false) {
+}
+
+HotplugMonitor::~HotplugMonitor() {
+    stop();
+}
+
+bool HotplugMonitor::start() {
+#ifdef Q_OS_LINUX
+    if (socketFd >= 0) return true;
+
+    // Grupo 1: eventos del kernel (llegan aunque no haya udev, por ejemplo en un contenedor)
+    // Grupo 2: los mismos eventos cuando udev ya ha creado el /dev y aplicado permisos. Se escuchan los dos, los avisos repetidos no molestan
+    socketFd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (socketFd < 0) {
+        cerr << "Hotplug notifications not available, falling back to polling.\n";
+        return false;
+    }
+
+    sockaddr_nl address;
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = 1 | 2;
+    if (bind(socketFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(socketFd);
+        socketFd = -1;
+        cerr << "Hotplug notifications not available, falling back to polling.\n";
+        return false;
+    }
+
+    notifier = new QSocketNotifier(socketFd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &HotplugMonitor::readEvents);
+    return true;
+#elif defined(Q_OS_WIN)
+    if (!filtering) {
+        QCoreApplication::instance()->installNativeEventFilter(this);
+        filtering = true;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void HotplugMonitor::stop() {
+    delete notifier;
+    notifier = nullptr;
+#ifdef Q_OS_LINUX
+    if (socketFd >= 0) {
+        close(socketFd);
+        socketFd = -1;
+    }
+#endif
+    if (filtering && QCoreApplication::instance()) {
+        QCoreApplication::instance()->removeNativeEventFilter(this);
+    }
+    filtering = false;
+}
+
+void HotplugMonitor::readEvents() {
+#ifdef Q_OS_LINUX
+    char buffer[HOTPLUG_EVENT_SIZE];
+    while (true) {
+        ssize_t received = recv(socketFd, buffer, sizeof(buffer), 0);
+        if (received <= 0) return; // EAGAIN, ya no queda nada
+        parseEvent(buffer, static_cast<int>(received));
+    }
+#endif
+}
+
+void HotplugMonitor::parseEvent(const char *data, int size) {
+    // Kernel: "accion@ruta\0CLAVE=valor\0...". udev: cabecera binaria que empieza por "libudev\0" y dice dónde van las propiedades
+    int offset = 0;
+    if (size >= 8 && memcmp(data, "libudev", 8) == 0) {
+        if (size < 24) return;
+        uint32_t propertiesOffset;
+        memcpy(&propertiesOffset, data + 16, sizeof(propertiesOffset)); // prefijo (8), magic (4), tamaño de cabecera (4), offset
+        offset = static_cast<int>(propertiesOffset);
+    } else {
+        offset = static_cast<int>(strnlen(data, static_cast<size_t>(size))) + 1;
+    }
+
+    QByteArray action;
+    QByteArray subsystem;
+    QByteArray deviceName;
+    while (offset < size) {
+        const char *property = data + offset;
+        int length = static_cast<int>(strnlen(property, static_cast<size_t>(size - offset)));
+        if (strncmp(property, "ACTION=", 7) == 0) action = QByteArray(property + 7, length - 7);
+        else if (strncmp(property, "SUBSYSTEM=", 10) == 0) subsystem = QByteArray(property + 10, length - 10);
+        else if (strncmp(property, "DEVNAME=", 8) == 0) deviceName = QByteArray(property + 8, length - 8);
+        offset += length + 1;
+    }
+
+    if (subsystem != "tty" || deviceName.isEmpty()) return;
+
+    // El kernel da "ttyUSB0" y udev "/dev/ttyUSB0", QSerialPortInfo usa el primero
+    int slash = deviceName.lastIndexOf('/');
+    QString portName = QString::fromLatin1(slash >= 0 ? deviceName.mid(slash + 1) : deviceName);
+    if (action == "add") emit portAdded(portName);
+    else if (action == "remove") emit portRemoved(portName);
+}
+
+bool HotplugMonitor::nativeEventFilter(const QByteArray &eventType, void *message, qintptr *result) {
+    Q_UNUSED(result);
+#ifdef Q_OS_WIN
+    if (eventType != "windows_generic_MSG") return false;
+
+    const MSG *msg = static_cast<const MSG*>(message);
+    if (msg->message != WM_DEVICECHANGE || (msg->wParam != DBT_DEVICEARRIVAL && msg->wParam != DBT_DEVICEREMOVECOMPLETE)) return false;
+
+    const DEV_BROADCAST_HDR *header = reinterpret_cast<const DEV_BROADCAST_HDR*>(msg->lParam);
+    if (header == nullptr || header->dbch_devicetype != DBT_DEVTYP_PORT) return false;
+
+    QString portName = QString::fromWCharArray(reinterpret_cast<const DEV_BROADCAST_PORT_W*>(header)->dbcp_name);
+    if (msg->wParam == DBT_DEVICEARRIVAL) emit portAdded(portName);
+    else emit portRemoved(portName);
+#else
+    Q_UNUSED(eventType);
+    Q_UNUSED(message);
+#endif
+    return false; // Que Qt lo siga procesando como siempre
+}
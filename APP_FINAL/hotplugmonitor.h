@@ -0,0 +1,41 @@
+#ifndef HOTPLUGMONITOR_H
+#define HOTPLUGMONITOR_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QAbstractNativeEventFilter>
+
+// Avisos del sistema cuando aparece o desaparece un puerto serie, para no tener que enumerar los puertos periódicamente
+// Linux: eventos uevent del kernel y de udev por un socket netlink, atendido con un QSocketNotifier en el hilo de la UI
+// Windows: WM_DEVICECHANGE con DBT_DEVTYP_PORT, que el sistema manda a todas las ventanas principales
+// Los nombres que se emiten son los de QSerialPortInfo::portName() (ttyUSB0, COM3, ...)
+
+class QSocketNotifier;
+
+class HotplugMonitor : public QObject, public QAbstractNativeEventFilter {
+    Q_OBJECT
+
+public:
+    explicit HotplugMonitor(QObject *parent = nullptr); // Constructor
+    ~HotplugMonitor(); // Destructor, cierra el socket
+
+    bool start(); // Empieza a escuchar, false si en esta plataforma no hay avisos (entonces hay que seguir enumerando)
+    void stop(); // Deja de escuchar
+
+    bool nativeEventFilter(const QByteArray &eventType, void *message, qintptr *result) override; // WM_DEVICECHANGE en Windows
+
+signals:
+    void portAdded(const QString &portName); // Ha aparecido un puerto
+    void portRemoved(const QString &portName); // Ha desaparecido un puerto
+
+private:
+    void readEvents(); // Lee todos los eventos pendientes del socket netlink
+    void parseEvent(const char *data, int size); // Saca ACTION, SUBSYSTEM y DEVNAME de un evento y avisa si es de un tty
+
+    int socketFd;              // Socket netlink (-1 si no hay)
+    QSocketNotifier *notifier; // Avisa cuando hay eventos en el socket
+    bool filtering;            // El filtro de eventos nativos está instalado
+};
+
+#endif // HOTPLUGMONITOR_H
@@ -0,0 +1,132 @@
+#include "logging.h"
+#include "logqueue.h"
+#include <cstring>
+
+using namespace std;
+
+atomic<int> logCategoryLevels[LOG_CATEGORIES] = {
+    {LEVEL_DEBUG}, {LEVEL_DEBUG}, {LEVEL_DEBUG}, {LEVEL_DEBUG} // Como hasta ahora: los paquetes se ven en los logs
+};
+
+struct HexTable { // Los dos dígitos de cada byte ya escritos, un solo acceso a memoria por byte
+    char pairs[512];
+
+    constexpr HexTable() : pairs() {
+        const char digits[] = "0123456789ABCDEF";
+        for (int value = 0; value < 256; ++value) {
+            pairs[2 * value] = digits[value >> 4];
+            pairs[2 * value + 1] = digits[value & 0x0F];
+        }
+    }
+};
+
+static constexpr HexTable HEX_TABLE;
+
+LogMessage::LogMessage(LOGCATEGORY category, LOGLEVEL level) : category(category), level(level) {
+}
+
+LogMessage::~LogMessage() {
+    LOGSEVERITY severity;
+    switch (level) {
+    case LEVEL_TRACE:
+    case LEVEL_DEBUG: severity = LOG_DEBUG; break;
+    case LEVEL_INFO: severity = LOG_INFO; break;
+    case LEVEL_WARNING: severity = LOG_WARNING; break;
+    default: severity = LOG_CRITICAL; break;
+    }
+    logLine(severity, string("[") + logCategoryName(category) + "] " + out.str());
+}
+
+void setLogLevel(LOGCATEGORY category, LOGLEVEL level) {
+    logCategoryLevels[category].store(level, memory_order_relaxed);
+}
+
+void setLogLevel(LOGLEVEL level) {
+    for (int category = 0; category < LOG_CATEGORIES; ++category) {
+        setLogLevel(static_cast<LOGCATEGORY>(category), level);
+    }
+}
+
+static bool parseLevel(const string &name, LOGLEVEL &level) {
+    const char *names[] = {"trace", "debug", "info", "warning", "error", "off"};
+    for (int i = LEVEL_TRACE; i <= LEVEL_OFF; ++i) {
+        if (name == names[i]) {
+            level = static_cast<LOGLEVEL>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool configureLogLevels(const string &spec) {
+    bool valid = true;
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == string::npos) end = spec.size();
+        string item = spec.substr(start, end - start);
+        start = end + 1;
+        if (item.empty()) continue;
+
+        // Sin "=" es el nivel de todas las categorías
+        LOGLEVEL level;
+        size_t equals = item.find('=');
+        if (equals == string::npos) {
+            if (parseLevel(item, level)) setLogLevel(level);
+            else valid = false;
+            continue;
+        }
+
+        string categoryName = item.substr(0, equals);
+        bool found = false;
+        for (int category = 0; category < LOG_CATEGORIES; ++category) {
+            if (categoryName == logCategoryName(static_cast<LOGCATEGORY>(category)) && parseLevel(item.substr(equals + 1), level)) {
+                setLogLevel(static_cast<LOGCATEGORY>(category), level);
+                found = true;
+            }
+        }
+        valid = valid && found;
+    }
+    return valid;
+}
+
+const char *logCategoryName(LOGCATEGORY category) {
+    switch (category) {
+    case LOGCAT_SERIAL: return "serial";
+    case LOGCAT_PROTOCOL: return "protocol";
+    case LOGCAT_TRANSACTION: return "transaction";
+    case LOGCAT_UI: return "ui";
+    default: return "log";
+    }
+}
+
+size_t hexDump(const uint8_t *data, size_t size, char *out) {
+    if (size == 0) return 0;
+
+    char *position = out;
+    for (size_t i = 0; i < size; ++i) {
+        position[0] = '0';
+        position[1] = 'x';
+        memcpy(position + 2, HEX_TABLE.pairs + 2 * data[i], 2);
+        position[4] = ' ';
+        position += 5;
+    }
+    return static_cast<size_t>(position - out) - 1; // Sin el último espacio
+}
+
+string hexDump(const uint8_t *data, size_t size) {
+    string text(size * 5, '\0');
+    text.resize(hexDump(data, size, &text[0]));
+    return text;
+}
+
+ostream &operator<<(ostream &stream, const HexBytes &bytes) {
+    // Por trozos en un buffer de pila, sin memoria dinámica aunque el paquete sea largo
+    char buffer[64 * 5];
+    for (size_t offset = 0; offset < bytes.size; offset += 64) {
+        size_t count = bytes.size - offset < 64 ? bytes.size - offset : 64;
+        if (offset > 0) stream << ' ';
+        stream.write(buffer, static_cast<streamsize>(hexDump(bytes.data + offset, count, buffer)));
+    }
+    return stream;
+}
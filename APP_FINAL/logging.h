@@ -0,0 +1,85 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+// Logs por nivel y categoría: los argumentos solo se evalúan (y se formatean) si ese nivel está activo para esa categoría
+// Uso: DEBUG_LOG(LOGCAT_SERIAL) << "Sending data: " << HexBytes(data, size);
+// En release (QT_NO_DEBUG o NDEBUG) los TRACE_LOG ni se compilan, la condición es constante y el compilador quita la rama
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+#define LOG_CATEGORIES 4 // Número de valores de LOGCATEGORY
+
+#ifndef EOLE_LOG_COMPILED_LEVEL
+#if defined(QT_NO_DEBUG) || defined(NDEBUG)
+#define EOLE_LOG_COMPILED_LEVEL 1 // Nivel mínimo que se compila (1 = LEVEL_DEBUG, sin trazas)
+#else
+#define EOLE_LOG_COMPILED_LEVEL 0 // En debug se compila todo
+#endif
+#endif
+
+enum LOGLEVEL { // Niveles, de más a menos detalle
+    LEVEL_TRACE = 0,   // Detalle de cada trama (CRC calculado y recibido...), solo en debug
+    LEVEL_DEBUG = 1,   // Paquetes enviados y recibidos
+    LEVEL_INFO = 2,    // Eventos normales (puerto abierto, cerrado...)
+    LEVEL_WARNING = 3, // Algo ha ido mal pero se sigue
+    LEVEL_ERROR = 4,   // Fallos
+    LEVEL_OFF = 5      // Nada
+};
+
+enum LOGCATEGORY { // De qué parte viene el mensaje, cada una con su nivel
+    LOGCAT_SERIAL = 0,      // Puerto serie (abrir, cerrar, bytes enviados)
+    LOGCAT_PROTOCOL = 1,    // Tramas, CRC y resincronización
+    LOGCAT_TRANSACTION = 2, // Resultados de las transacciones en la UI
+    LOGCAT_UI = 3           // Resto de la UI
+};
+
+extern atomic<int> logCategoryLevels[LOG_CATEGORIES]; // Nivel mínimo activo de cada categoría
+
+inline bool logEnabled(LOGCATEGORY category, LOGLEVEL level) {
+    return level >= EOLE_LOG_COMPILED_LEVEL && level >= logCategoryLevels[category].load(memory_order_relaxed);
+}
+
+class LogMessage { // Acumula un mensaje y lo manda a la cola de logs al destruirse (al final de la sentencia)
+public:
+    LogMessage(LOGCATEGORY category, LOGLEVEL level); // Constructor
+    ~LogMessage(); // Destructor, encola el mensaje
+    ostream &stream() { return out; }
+
+private:
+    LOGCATEGORY category;
+    LOGLEVEL level;
+    ostringstream out;
+};
+
+// if/else para que los << de detrás no se evalúen si el nivel está desactivado (y sin problemas con un else del que llama)
+#define EOLE_LOG(category, level) \
+    if (!logEnabled(category, level)) {} else LogMessage(category, level).stream()
+
+#define TRACE_LOG(category) EOLE_LOG(category, LEVEL_TRACE)
+#define DEBUG_LOG(category) EOLE_LOG(category, LEVEL_DEBUG)
+#define INFO_LOG(category) EOLE_LOG(category, LEVEL_INFO)
+#define WARNING_LOG(category) EOLE_LOG(category, LEVEL_WARNING)
+#define ERROR_LOG(category) EOLE_LOG(category, LEVEL_ERROR)
+
+void setLogLevel(LOGCATEGORY category, LOGLEVEL level); // Cambiar el nivel de una categoría
+void setLogLevel(LOGLEVEL level); // Cambiar el nivel de todas
+bool configureLogLevels(const string &spec); // "debug" o "serial=trace,protocol=debug", false si algo no se entiende
+const char *logCategoryName(LOGCATEGORY category); // serial, protocol, ...
+
+struct HexBytes { // Para volcar paquetes en un log sin copiarlos: log << HexBytes(data, size)
+    HexBytes(const uint8_t *bytes, size_t count) : data(bytes), size(count) {}
+    const uint8_t *data;
+    size_t size;
+};
+
+size_t hexDump(const uint8_t *data, size_t size, char *out); // "0x40 0x90 ...", 5 caracteres por byte menos el último espacio; devuelve la longitud (sin terminar en \0)
+string hexDump(const uint8_t *data, size_t size); // Lo mismo en un string
+ostream &operator<<(ostream &stream, const HexBytes &bytes);
+
+#endif // LOGGING_H
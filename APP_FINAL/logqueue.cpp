@@ -0,0 +1,118 @@
+#include "logqueue.h"
+#include "values.h"
+#include <chrono>
+
+using namespace std;
+
+LogQueue::LogQueue() : head(&stub), tail(&stub), pending(0), dropped(0) {
+}
+
+LogQueue::~LogQueue() {
+    // Aquí ya no quedan productores
+    while (Node *node = popNode()) {
+        delete node;
+    }
+}
+
+void LogQueue::pushNode(Node *node) {
+    node->next.store(nullptr, memory_order_relaxed);
+    Node *previous = head.exchange(node, memory_order_acq_rel);
+    previous->next.store(node, memory_order_release); // Hasta aquí el consumidor ve la cola cortada en previous
+}
+
+void LogQueue::push(LOGSEVERITY severity, string text) {
+    if (pending.fetch_add(1, memory_order_relaxed) >= LOG_QUEUE_CAPACITY) {
+        pending.fetch_sub(1, memory_order_relaxed);
+        dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    Node *node = new Node;
+    node->entry.severity = severity;
+    node->entry.timestampMs = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    node->entry.text = move(text);
+    pushNode(node);
+}
+
+LogQueue::Node *LogQueue::popNode() {
+    Node *first = tail;
+    Node *next = first->next.load(memory_order_acquire);
+
+    // El stub no lleva datos, se salta
+    if (first == &stub) {
+        if (next == nullptr) return nullptr;
+        tail = next;
+        first = next;
+        next = next->next.load(memory_order_acquire);
+    }
+
+    if (next != nullptr) {
+        tail = next;
+        return first;
+    }
+
+    // first es el último: si hay un productor a medias lo dejamos para la siguiente vuelta
+    if (first != head.load(memory_order_acquire)) return nullptr;
+
+    // Volvemos a meter el stub detrás para poder soltar first
+    pushNode(&stub);
+    next = first->next.load(memory_order_acquire);
+    if (next != nullptr) {
+        tail = next;
+        return first;
+    }
+    return nullptr;
+}
+
+size_t LogQueue::drain(vector<LogEntry> &entries, size_t maxEntries) {
+    size_t count = 0;
+    while (count < maxEntries) {
+        Node *node = popNode();
+        if (node == nullptr) break;
+        entries.push_back(move(node->entry));
+        delete node;
+        ++count;
+    }
+    pending.fetch_sub(count, memory_order_relaxed);
+    return count;
+}
+
+uint64_t LogQueue::takeDropped() {
+    return dropped.exchange(0, memory_order_relaxed);
+}
+
+const char *logSeverityPrefix(LOGSEVERITY severity) {
+    switch (severity) {
+    case LOG_DEBUG: return "[DEBUG] ";
+    case LOG_INFO: return "[INFO] ";
+    case LOG_WARNING: return "[WARNING] ";
+    case LOG_CRITICAL: return "[CRITICAL] ";
+    case LOG_FATAL: return "[FATAL] ";
+    case LOG_STDOUT: return "[STDOUT] ";
+    case LOG_STDERR: return "[STDERR] ";
+    default: return "[LOG] ";
+    }
+}
+
+LogQueue &logQueue() {
+    static LogQueue queue;
+    return queue;
+}
+
+LogQueue &logFileQueue() {
+    static LogQueue queue;
+    return queue;
+}
+
+static atomic<bool> fileEnabled(false);
+
+void setLogFileEnabled(bool enabled) {
+    fileEnabled.store(enabled, memory_order_relaxed);
+}
+
+void logLine(LOGSEVERITY severity, string text) {
+    if (fileEnabled.load(memory_order_relaxed)) {
+        logFileQueue().push(severity, text); // Copia para el fichero, la original se la queda la UI
+    }
+    logQueue().push(severity, move(text));
+}
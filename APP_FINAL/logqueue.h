@@ -0,0 +1,64 @@
+#ifndef LOGQUEUE_H
+#define LOGQUEUE_H
+
+// Cola de logs multi-productor y un solo consumidor sin locks (cola enlazada de Vyukov)
+// Cualquier hilo (cout, cerr, qDebug desde el hilo serie o la UI) deja la línea con un exchange atómico y sigue
+// La UI la vacía por lotes con un timer, así escribir un log nunca espera a que se pinte
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define LOG_SEVERITIES 7 // Número de valores de LOGSEVERITY
+
+enum LOGSEVERITY { // De dónde viene cada línea, decide el prefijo y el color
+    LOG_DEBUG = 0,    // qDebug
+    LOG_INFO = 1,     // qInfo
+    LOG_WARNING = 2,  // qWarning
+    LOG_CRITICAL = 3, // qCritical
+    LOG_FATAL = 4,    // qFatal
+    LOG_STDOUT = 5,   // cout
+    LOG_STDERR = 6    // cerr
+};
+
+struct LogEntry { // Una línea de log, sin el salto de línea
+    LOGSEVERITY severity = LOG_STDOUT;
+    int64_t timestampMs = 0; // Cuándo se escribió (ms desde epoch, reloj del sistema), para el fichero de logs
+    string text;
+};
+
+class LogQueue {
+public:
+    LogQueue(); // Constructor
+    ~LogQueue(); // Destructor, libera lo que no se llegara a vaciar
+
+    void push(LOGSEVERITY severity, string text); // Desde cualquier hilo, nunca bloquea (si la cola está llena la línea se descarta)
+    size_t drain(vector<LogEntry> &entries, size_t maxEntries); // Solo desde el consumidor: añade hasta maxEntries líneas en orden
+    uint64_t takeDropped(); // Líneas descartadas por cola llena desde la última llamada
+
+private:
+    struct Node {
+        atomic<Node*> next{nullptr};
+        LogEntry entry;
+    };
+
+    void pushNode(Node *node); // Enlaza un nodo al final (exchange sobre head)
+    Node *popNode(); // Desenlaza el primero, nullptr si no hay o un productor está a medias
+
+    atomic<Node*> head;      // Último nodo encolado (lado productores)
+    Node *tail;              // Primer nodo pendiente (lado consumidor)
+    Node stub;               // Nodo vacío que separa los dos lados cuando la cola se queda vacía
+    atomic<size_t> pending;  // Líneas en cola (aproximado), para poner un tope si la UI no vacía
+    atomic<uint64_t> dropped; // Líneas descartadas
+};
+
+const char *logSeverityPrefix(LOGSEVERITY severity); // "[DEBUG] ", "[STDOUT] ", ...
+LogQueue &logQueue(); // Cola global del proceso, la vacía la UI
+LogQueue &logFileQueue(); // Copia de todas las líneas para el escritor de ficheros (logwriter.h), solo se llena si está activada
+void setLogFileEnabled(bool enabled); // Empezar o dejar de copiar las líneas a logFileQueue
+void logLine(LOGSEVERITY severity, string text); // Punto de entrada de todas las líneas: a la cola de la UI y, si está activada, a la del fichero
+
+#endif // LOGQUEUE_H
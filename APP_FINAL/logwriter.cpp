@@ -0,0 +1,255 @@
+#include "logwriter.h"
+#include "values.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+struct Crc32Table { // CRC32 de gzip (polinomio reflejado 0xEDB88320), el deflate lo hace el zlib que ya trae Qt
+    uint32_t entries[256];
+
+    constexpr Crc32Table() : entries() {
+        for (uint32_t value = 0; value < 256; ++value) {
+            uint32_t crc = value;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            entries[value] = crc;
+        }
+    }
+};
+
+static constexpr Crc32Table CRC32_TABLE;
+
+static uint32_t crc32(const QByteArray &data) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (char byte : data) {
+        crc = CRC32_TABLE.entries[(crc ^ static_cast<uint8_t>(byte)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static void appendLittleEndian32(QByteArray &out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static const QStringList SEGMENT_FILTERS = {QString(LOG_SEGMENT_PREFIX) + "*.log", QString(LOG_SEGMENT_PREFIX) + "*.log.gz"};
+
+LogFileWriter::LogFileWriter(const QString &directory)
+    : directory(directory), segmentSize(0), segmentOpenedMs(0), cachedSecond(-1), running(false), compressorStop(false) {
+    buffer.reserve(LOG_FILE_BUFFER_SIZE + LOG_LINE_MAX_SIZE); // Se vacía al pasar de LOG_FILE_BUFFER_SIZE, después de añadir la línea
+}
+
+LogFileWriter::~LogFileWriter() {
+    stop();
+}
+
+bool LogFileWriter::start() {
+    if (running) return true;
+
+    QDir dir;
+    if (!dir.exists(directory)) dir.mkpath(directory);
+
+    // Segmentos de sesiones anteriores (por ejemplo tras un cierre inesperado) que se quedaron sin comprimir
+    const QFileInfoList leftovers = QDir(directory).entryInfoList(QStringList{QString(LOG_SEGMENT_PREFIX) + "*.log"}, QDir::Files, QDir::Name);
+    {
+        lock_guard<mutex> locker(compressMutex);
+        for (const QFileInfo &info : leftovers) pendingCompression.push_back(info.absoluteFilePath());
+        compressorStop = false;
+    }
+
+    if (!openSegment()) return false;
+
+    running = true;
+    setLogFileEnabled(true);
+    writer = thread([this]() { run(); });
+    compressor = thread([this]() { compressLoop(); });
+    return true;
+}
+
+void LogFileWriter::stop() {
+    if (!running) return;
+
+    // Dejamos de copiar líneas y el hilo de escritura vacía lo que quede antes de salir
+    setLogFileEnabled(false);
+    running = false;
+    if (writer.joinable()) writer.join();
+
+    {
+        lock_guard<mutex> locker(compressMutex);
+        compressorStop = true;
+    }
+    compressWake.notify_all();
+    if (compressor.joinable()) compressor.join();
+}
+
+void LogFileWriter::run() {
+    vector<LogEntry> entries;
+    entries.reserve(LOG_DRAIN_BATCH);
+
+    while (true) {
+        bool stopping = !running;
+        entries.clear();
+        logFileQueue().drain(entries, LOG_DRAIN_BATCH);
+        appendEntries(entries);
+
+        if (entries.size() < LOG_DRAIN_BATCH) {
+            // Cola vacía: lo formateado va ya al fichero, así un cierre inesperado solo pierde lo que aún no se había sacado de la cola
+            flushBuffer();
+            if (stopping) break;
+            this_thread::sleep_for(chrono::milliseconds(LOG_WRITER_POLL_TIME));
+        }
+    }
+
+    uint64_t dropped = logFileQueue().takeDropped();
+    if (dropped > 0) {
+        buffer.append(QByteArray::number(static_cast<qulonglong>(dropped)) + " log lines were dropped (log queue full).\n");
+    }
+    flushBuffer();
+    segment.close();
+}
+
+void LogFileWriter::appendEntries(const vector<LogEntry> &entries) {
+    for (const LogEntry &entry : entries) {
+        // La fecha solo se formatea cuando cambia el segundo, los milisegundos se añaden a mano
+        qint64 second = entry.timestampMs / 1000;
+        if (second != cachedSecond) {
+            cachedSecond = second;
+            cachedTimestamp = QDateTime::fromMSecsSinceEpoch(second * 1000).toString("yyyy-MM-dd HH:mm:ss").toLatin1();
+        }
+        int milliseconds = static_cast<int>(entry.timestampMs % 1000);
+        char fraction[5] = {'.', static_cast<char>('0' + milliseconds / 100), static_cast<char>('0' + milliseconds / 10 % 10),
+                            static_cast<char>('0' + milliseconds % 10), ' '};
+
+        buffer.append(cachedTimestamp);
+        buffer.append(fraction, sizeof(fraction));
+        buffer.append(logSeverityPrefix(entry.severity));
+        buffer.append(entry.text.data(), static_cast<int>(entry.text.size()));
+        buffer.append('\n');
+
+        if (buffer.size() >= LOG_FILE_BUFFER_SIZE) flushBuffer();
+    }
+}
+
+void LogFileWriter::flushBuffer() {
+    if (!buffer.isEmpty() && segment.isOpen()) {
+        qint64 written = segment.write(buffer);
+        segment.flush(); // Al sistema operativo, el proceso ya puede caerse sin perderlo
+        if (written > 0) segmentSize += written;
+    }
+    buffer.clear();
+    rotateIfNeeded();
+}
+
+bool LogFileWriter::openSegment() {
+    // Con milisegundos en el nombre, una rotación por tamaño nunca repite nombre y el orden alfabético es el cronológico
+    QString name = QString(LOG_SEGMENT_PREFIX) + QDateTime::currentDateTime().toString("yyyy-MM-dd_HH-mm-ss-zzz") + ".log";
+    QString path = QDir(directory).filePath(name);
+
+    segment.setFileName(path);
+    if (!segment.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        cerr << "Unable to open log file " << path.toStdString() << ".\n";
+        return false;
+    }
+
+    segmentSize = 0;
+    segmentOpenedMs = QDateTime::currentMSecsSinceEpoch();
+    lock_guard<mutex> locker(compressMutex);
+    activeSegment = path;
+    return true;
+}
+
+void LogFileWriter::rotateIfNeeded() {
+    if (!segment.isOpen()) return;
+
+    bool tooBig = segmentSize >= LOG_FILE_MAX_SIZE;
+    bool tooOld = segmentSize > 0 && QDateTime::currentMSecsSinceEpoch() - segmentOpenedMs >= static_cast<qint64>(LOG_FILE_MAX_AGE) * 1000;
+    if (!tooBig && !tooOld) return;
+
+    QString closed = segment.fileName();
+    segment.close();
+    openSegment();
+
+    {
+        lock_guard<mutex> locker(compressMutex);
+        pendingCompression.push_back(closed);
+    }
+    compressWake.notify_one();
+}
+
+void LogFileWriter::compressLoop() {
+    while (true) {
+        QString path;
+        {
+            unique_lock<mutex> locker(compressMutex);
+            compressWake.wait(locker, [this]() { return compressorStop || !pendingCompression.empty(); });
+            if (pendingCompression.empty()) return; // Parado y sin nada pendiente (lo que quede se comprime en la siguiente sesión)
+            path = pendingCompression.front();
+            pendingCompression.pop_front();
+        }
+
+        compressSegment(path);
+        enforceDiskBudget();
+    }
+}
+
+bool LogFileWriter::compressSegment(const QString &path) {
+    QFile source(path);
+    if (!source.open(QIODevice::ReadOnly)) return false;
+    QByteArray data = source.readAll();
+    source.close();
+
+    // qCompress da [tamaño (4 bytes)][cabecera zlib (2)][deflate][adler32 (4)]: nos quedamos con el deflate y lo envolvemos como gzip
+    QByteArray zlib = qCompress(data, LOG_COMPRESSION_LEVEL);
+    if (zlib.size() < 10) return false;
+
+    QByteArray gzip;
+    gzip.reserve(zlib.size() + 18);
+    const char header[10] = {'\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff'}; // Deflate, sin nombre ni fecha, sistema desconocido
+    gzip.append(header, sizeof(header));
+    gzip.append(zlib.constData() + 6, zlib.size() - 10);
+    appendLittleEndian32(gzip, crc32(data));
+    appendLittleEndian32(gzip, static_cast<uint32_t>(data.size()));
+
+    // Primero a un temporal y luego se renombra, así nunca queda un .gz a medias
+    QString temporary = path + ".gz.tmp";
+    QFile target(temporary);
+    if (!target.open(QIODevice::WriteOnly) || target.write(gzip) != gzip.size()) {
+        target.close();
+        QFile::remove(temporary);
+        return false;
+    }
+    target.close();
+
+    QFile::remove(path + ".gz");
+    if (!QFile::rename(temporary, path + ".gz")) {
+        QFile::remove(temporary);
+        return false;
+    }
+    QFile::remove(path);
+    return true;
+}
+
+void LogFileWriter::enforceDiskBudget() {
+    QString active;
+    {
+        lock_guard<mutex> locker(compressMutex);
+        active = activeSegment;
+    }
+
+    // Del más nuevo al más antiguo (el nombre lleva la fecha), se conservan mientras quepan en el presupuesto
+    const QFileInfoList segments = QDir(directory).entryInfoList(SEGMENT_FILTERS, QDir::Files, QDir::Name | QDir::Reversed);
+    qint64 used = 0;
+    for (const QFileInfo &info : segments) {
+        if (info.absoluteFilePath() == active) continue;
+        used += info.size();
+        if (used > LOG_DISK_BUDGET) {
+            QFile::remove(info.absoluteFilePath());
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+// Escritor continuo de logs a disco: todas las líneas (logFileQueue) van a ficheros en EOLE_logs que rotan por tamaño y por tiempo
+// Los segmentos cerrados se comprimen a .gz en otro hilo y se borran los más antiguos si se pasa del presupuesto de disco
+// La UI nunca toca los ficheros; el buffer se escribe cada vez que la cola se vacía, así un cierre inesperado pierde como mucho un buffer
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "logqueue.h"
+
+using namespace std;
+
+class LogFileWriter {
+public:
+    explicit LogFileWriter(const QString &directory); // Constructor, directory es la carpeta EOLE_logs
+    ~LogFileWriter(); // Destructor, para y escribe lo pendiente
+
+    bool start(); // Abre el primer segmento y arranca los hilos de escritura y compresión
+    void stop(); // Escribe lo que quede en la cola, cierra el segmento y para los hilos
+
+private:
+    void run(); // Hilo de escritura: vacía la cola, formatea y escribe
+    void appendEntries(const vector<LogEntry> &entries); // Formatea las líneas en el buffer (y escribe si se llena)
+    void flushBuffer(); // Escribe el buffer en el segmento actual y rota si toca
+    bool openSegment(); // Crea un segmento nuevo con la hora actual en el nombre
+    void rotateIfNeeded(); // Cierra el segmento si se pasa de tamaño o de edad y abre otro
+
+    void compressLoop(); // Hilo de compresión: comprime los segmentos cerrados y aplica el presupuesto de disco
+    bool compressSegment(const QString &path); // path.log -> path.log.gz (gzip estándar)
+    void enforceDiskBudget(); // Borra los segmentos más antiguos hasta quedar por debajo de LOG_DISK_BUDGET
+
+    QString directory;            // Carpeta de los segmentos
+    QFile segment;                // Segmento abierto (solo desde el hilo de escritura)
+    QByteArray buffer;            // Líneas formateadas pendientes de escribir
+    qint64 segmentSize;           // Bytes escritos en el segmento actual
+    qint64 segmentOpenedMs;       // Cuándo se abrió el segmento actual
+    qint64 cachedSecond;          // Segundo de la última marca de tiempo formateada
+    QByteArray cachedTimestamp;   // "yyyy-MM-dd HH:mm:ss" de ese segundo
+    thread writer;                // Hilo de escritura
+    thread compressor;            // Hilo de compresión
+    atomic<bool> running;         // Los hilos siguen vivos
+
+    mutex compressMutex;              // Protege pendingCompression, activeSegment y compressorStop
+    condition_variable compressWake;  // Avisa al compresor de que hay trabajo
+    deque<QString> pendingCompression; // Segmentos cerrados pendientes de comprimir
+    QString activeSegment;            // Segmento abierto, el presupuesto nunca lo borra
+    bool compressorStop;              // Pedir al compresor que termine
+};
+
+#endif // LOGWRITER_H
@@ -0,0 +1,120 @@
+#include "lowlatency.h"
+
+#ifdef __linux__
+
+#include "values.h"
+#include <climits>
+#include <cstdio>
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+using namespace std;
+
+static bool readNumber(const string &path, int &value) {
+    FILE *file = fopen(path.c_str(), "r");
+    if (!file) return false;
+    bool read = fscanf(file, "%d", &value) == 1;
+    fclose(file);
+    return read;
+}
+
+static bool writeNumber(const string &path, int value) {
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) return false; // Sin permisos (hace falta una regla de udev) o el driver no lo tiene
+    bool written = fprintf(file, "%d\n", value) > 0;
+    return fclose(file) == 0 && written;
+}
+
+static string deviceName(int fd) {
+    // /proc/self/fd/N apunta al dispositivo (/dev/ttyUSB0), en sysfs se busca por el nombre sin /dev
+    char target[PATH_MAX];
+    ssize_t length = readlink(("/proc/self/fd/" + to_string(fd)).c_str(), target, sizeof(target) - 1);
+    if (length <= 0) return string();
+    string path(target, static_cast<size_t>(length));
+    size_t slash = path.rfind('/');
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+LowLatencySerial::LowLatencySerial()
+    : fd(-1), serialFlagsChanged(false), originalFlags(0), termiosChanged(false), originalTermios(), appliedVmin(0),
+      originalLatencyTimer(0) {
+}
+
+LowLatencySerial::~LowLatencySerial() {
+    restore();
+}
+
+bool LowLatencySerial::apply(int portFd, int frameSize) {
+    restore();
+    if (portFd < 0 || !isatty(portFd)) return false;
+    fd = portFd;
+
+    serial_struct serial;
+    if (ioctl(fd, TIOCGSERIAL, &serial) == 0 && !(serial.flags & ASYNC_LOW_LATENCY)) {
+        originalFlags = serial.flags;
+        serial.flags |= ASYNC_LOW_LATENCY;
+        serialFlagsChanged = ioctl(fd, TIOCSSERIAL, &serial) == 0;
+    }
+
+    // Solo los adaptadores USB-serie tienen latency_timer (FTDI sobre todo), en el resto el fichero no existe
+    string path = string("/sys/bus/usb-serial/devices/") + deviceName(fd) + "/latency_timer";
+    int current = 0;
+    if (readNumber(path, current) && current > LOW_LATENCY_TIMER && writeNumber(path, LOW_LATENCY_TIMER)) {
+        latencyTimerPath = path;
+        originalLatencyTimer = current;
+    }
+
+    // Con VTIME a 0, poll considera que hay datos cuando hay VMIN bytes: una respuesta entera, un solo despertar
+    termios settings;
+    if (tcgetattr(fd, &settings) == 0) {
+        originalTermios = settings;
+        appliedVmin = frameSize;
+        settings.c_cc[VMIN] = static_cast<cc_t>(frameSize);
+        settings.c_cc[VTIME] = 0;
+        termiosChanged = tcsetattr(fd, TCSANOW, &settings) == 0;
+    }
+
+    if (!serialFlagsChanged && latencyTimerPath.empty() && !termiosChanged) {
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void LowLatencySerial::restore() {
+    if (fd < 0) return;
+
+    if (termiosChanged) tcsetattr(fd, TCSANOW, &originalTermios);
+    if (!latencyTimerPath.empty()) writeNumber(latencyTimerPath, originalLatencyTimer);
+    if (serialFlagsChanged) {
+        serial_struct serial;
+        if (ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+            serial.flags = originalFlags;
+            ioctl(fd, TIOCSSERIAL, &serial);
+        }
+    }
+
+    fd = -1;
+    serialFlagsChanged = false;
+    termiosChanged = false;
+    latencyTimerPath.clear();
+}
+
+string LowLatencySerial::summary() const {
+    if (fd < 0) return "nothing applied";
+
+    string text;
+    if (serialFlagsChanged) text += "ASYNC_LOW_LATENCY";
+    if (!latencyTimerPath.empty()) {
+        text += string(text.empty() ? "" : ", ") + "latency_timer " + to_string(originalLatencyTimer) + " -> " +
+                to_string(LOW_LATENCY_TIMER) + " ms";
+    }
+    if (termiosChanged) {
+        text += string(text.empty() ? "" : ", ") + "VMIN " + to_string(static_cast<int>(originalTermios.c_cc[VMIN])) + " -> " +
+                to_string(appliedVmin);
+    }
+    return text;
+}
+
+#endif // __linux__
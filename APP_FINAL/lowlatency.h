@@ -0,0 +1,43 @@
+#ifndef LOWLATENCY_H
+#define LOWLATENCY_H
+
+// Modo de baja latencia para adaptadores USB-serie en Linux (opcional, LOW_LATENCY_VARIABLE)
+// Los adaptadores juntan los bytes recibidos antes de mandarlos por USB (el latency_timer de FTDI es de 16 ms por defecto),
+// así que una respuesta de 8 bytes puede tardar más en llegar a la app que en salir del sensor:
+//  - ASYNC_LOW_LATENCY en el driver (TIOCSSERIAL), para que pase los bytes al tty sin esperar
+//  - el latency_timer del adaptador en sysfs a LOW_LATENCY_TIMER, si se puede escribir
+//  - VMIN al tamaño de la respuesta, así poll/select solo despiertan con la trama entera y no con cada trozo
+// Con VMIN una respuesta a la que le falten bytes ya no despierta a nadie y acaba en timeout en vez de en trama incompleta
+// Todo lo que se cambia se guarda y se restaura al cerrar. Sin Qt, sobre el descriptor del transporte
+
+#include <string>
+
+using namespace std;
+
+#ifdef __linux__
+
+#include <termios.h>
+
+class LowLatencySerial {
+public:
+    LowLatencySerial(); // Constructor
+    ~LowLatencySerial(); // Destructor, restaura lo que quede aplicado
+
+    bool apply(int fd, int frameSize); // Aplica lo que el dispositivo permita, false si no pudo cambiar nada (un socket o un pty sin driver serie)
+    void restore(); // Deja el puerto como estaba, antes de cerrarlo
+    string summary() const; // Qué se ha cambiado, para el log
+
+private:
+    int fd;                   // Puerto al que se aplicó, -1 si no hay nada aplicado
+    bool serialFlagsChanged;  // Se activó ASYNC_LOW_LATENCY (no estaba ya)
+    int originalFlags;        // Flags del driver antes de cambiarlos
+    bool termiosChanged;      // Se cambió VMIN
+    termios originalTermios;  // Configuración antes de cambiar VMIN
+    int appliedVmin;          // VMIN puesto (el tamaño de la respuesta)
+    string latencyTimerPath;  // Fichero latency_timer de sysfs que se cambió (vacío si no)
+    int originalLatencyTimer; // Valor anterior del latency_timer (en ms)
+};
+
+#endif // __linux__
+
+#endif // LOWLATENCY_H
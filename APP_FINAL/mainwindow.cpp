@@ -1,6 +1,10 @@
 #include "mainwindow.h"
 #include "manager.h"
 #include "values.h"
+#include "tracing.h"
+#include "logqueue.h"
+#include "logging.h"
+#include <cstring>
 
 // Tanto la UI, como la clase auxiliar para los logs, como la lógica principal deben estar aquí, la lógica del serial port a parte
 // Todo en una única ventana
@@ -15,62 +19,59 @@ using namespace std;
 
 class LogStream : public streambuf { // Hereda de streambuf
 public:
-    LogStream(QtMsgType type) : msgType(type) {} // Recibimos el tipo de mensaje en el constructor (un objeto tendra el cout y otro el cerr)
+    LogStream(LOGSEVERITY type) : severity(type) {} // Recibimos el tipo de mensaje en el constructor (un objeto tendra el cout y otro el cerr)
 
 protected:
-    virtual int overflow(int ch) override { // Cada vez que recibe algo el buffer interno y esta lleno, si es un salto de linea manda lo que tenga, si no lo añade al buffer
-        if (ch == '\n') {
-            flushBuffer();
-        } else {
-            buffer += static_cast<char>(ch);
+    virtual streamsize xsputn(const char *data, streamsize size) override { // Lo normal con <<, llega el texto entero de una vez
+        append(data, size);
+        return size;
+    }
+
+    virtual int overflow(int ch) override { // Caracteres sueltos (endl, << de un char)
+        if (ch != traits_type::eof()) {
+            char character = static_cast<char>(ch);
+            append(&character, 1);
         }
         return ch;
     }
 
     virtual int sync() override { // Cuando se vaya a limpiar el buffer lo fuerza que se vacie
-        flushBuffer();
+        flushLine();
         return 0;
     }
 
 private:
-    void flushBuffer() {
-        if (!buffer.isEmpty() && MainWindow::globalLogBox) { // Para el text log y cuando el buffer no este vacio, imprime
-            QString prefix;
-            QString color;
-
-            switch (msgType) { // Segun si es un cout o un cerr, escoge el color
-            case QtInfoMsg:  // stdout
-                prefix = "[STDOUT]";
-                color = "#1E90FF";  // Azul claro
-                break;
-            case QtCriticalMsg:  // stderr
-                prefix = "[STDERR]";
-                color = "#FF4500";  // Rojo anaranjado
-                break;
-            default:
-                prefix = "[LOG]";
-                color = "#000000";
-                break;
-            }
-
-            // Con html, para que los caracteres especiales no rompan el mensaje
-            QString htmlMessage = QString("<span style='color:%1;'>%2 %3</span>").arg(color).arg(prefix).arg(buffer.toHtmlEscaped());
-
-            QMetaObject::invokeMethod(MainWindow::globalLogBox, [htmlMessage]() { // Lo añade al texto y manda la ultima linea
-                MainWindow::globalLogBox->append(htmlMessage);
-                MainWindow::globalLogBox->moveCursor(QTextCursor::End);
-            }, Qt::QueuedConnection);
-
-            buffer.clear(); // Limpia buffer y preparamos la siguiente linea
+    string &line() { // Línea a medias de este hilo, cout y cerr se usan a la vez desde la UI y el hilo serie
+        static thread_local array<string, LOG_SEVERITIES> lines;
+        return lines[severity];
+    }
 
+    void append(const char *data, streamsize size) { // Corta por saltos de línea y encola cada línea completa
+        string &pending = line();
+        const char *end = data + size;
+        while (data < end) {
+            const char *newline = static_cast<const char*>(memchr(data, '\n', end - data));
+            if (newline == nullptr) {
+                pending.append(data, end - data);
+                return;
+            }
+            pending.append(data, newline - data);
+            flushLine();
+            data = newline + 1;
         }
     }
 
-    QString buffer;
-    QtMsgType msgType;
+    void flushLine() {
+        string &pending = line();
+        if (pending.empty()) return;
+        logLine(severity, move(pending)); // Sin locks ni invokeMethod, la UI lo recoge en drainLogs
+        pending.clear();
+    }
+
+    LOGSEVERITY severity;
 };
 
-QTextEdit* MainWindow::globalLogBox = nullptr;  // Aquí hacemos que la variable sea usable
+QPlainTextEdit* MainWindow::globalLogBox = nullptr;  // Aquí hacemos que la variable sea usable
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) { // Constructor completo
     // Doble check del icono
@@ -83,6 +84,10 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) { // Constructor c
         dir.mkpath(logsDirPath);  // Crear solo si no existe
     }
 
+    // Escritor continuo de logs en esa carpeta (en su propio hilo, la UI nunca toca el fichero)
+    logWriter = new LogFileWriter(logsDirPath);
+    logWriter->start();
+
     // Instanciamos la clase manejador que será la intermediaria con el backend
     serialManager = new manager;
     customVariable.clear(); // Limpiamos la variable custom
@@ -125,7 +130,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) { // Constructor c
     // Botón de actualización de puertos
     updatePortsButton = new QPushButton("Update ports");
     // Conectarlo con la función que refresca puertos
-    connect(updatePortsButton, &QPushButton::clicked, this, &MainWindow::updateAvailablePorts);
+    connect(updatePortsButton, &QPushButton::clicked, this, [this]() { updateAvailablePorts(); });
 
     // Conectar el dropdown para abrir el puerto elegido
     connect(portSelector, &QComboBox::currentTextChanged, this, &MainWindow::openSerialPort);
@@ -278,12 +283,17 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) { // Constructor c
     // Botón de actualización
     updateButton = new QPushButton("Update values");
 
-    updateLayout->addStretch(4);         // 40%
+    // Botón del modo flota (varios sensores a la vez en otra ventana), no depende del puerto de esta
+    fleetButton = new QPushButton("Fleet mode");
+
+    updateLayout->addStretch(3);         // 30%
     updateLayout->addWidget(updateButton, 2); // 20%
-    updateLayout->addStretch(4);         // 40%
+    updateLayout->addWidget(fleetButton, 2);  // 20%
+    updateLayout->addStretch(3);         // 30%
 
     mainLayout->addLayout(updateLayout);
     connect(updateButton, &QPushButton::clicked, this, &MainWindow::updateValues);
+    connect(fleetButton, &QPushButton::clicked, this, &MainWindow::openFleetWindow);
 
     // Deshabilitar controles inicialmente y poner el widget central
     setControlsEnabled(false);
@@ -301,6 +311,9 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) { // Constructor c
     saveLogs = new QPushButton("Save logs");
     connect(saveLogs, &QPushButton::clicked, this, &MainWindow::saveLogToFile);
 
+    saveTrace = new QPushButton("Save trace");
+    connect(saveTrace, &QPushButton::clicked, this, &MainWindow::saveTraceToFile);
+
     clearLogs = new QPushButton("Clear logs");
     connect(clearLogs, &QPushButton::clicked, this, &MainWindow::clearAllLogs);
 
@@ -310,13 +323,23 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) { // Constructor c
     botonLogsLayout->addStretch(1);
     botonLogsLayout->addWidget(saveLogs, 1);
     botonLogsLayout->addStretch(1);
+    botonLogsLayout->addWidget(saveTrace, 1);
+    botonLogsLayout->addStretch(1);
     botonLogsLayout->addWidget(clearLogs, 1);
     botonLogsLayout->addStretch(3);
 
     // Creamos caja de texto para los logs, no se puede interactuar con ella
-    logs = new QTextEdit();
+    // Texto plano con un máximo de líneas, los colores van por formato de carácter y no con html en cada línea
+    logs = new QPlainTextEdit();
     logs->setReadOnly(true);
+    logs->setMaximumBlockCount(LOG_MAX_LINES);
     globalLogBox = logs;    // Unir el puntero
+
+    // Un formato por tipo de mensaje, los mismos colores de siempre
+    const char *colors[LOG_SEVERITIES] = {"gray", "blue", "orange", "red", "darkred", "#1E90FF", "#FF4500"};
+    for (int severity = 0; severity < LOG_SEVERITIES; ++severity) {
+        logFormats[severity].setForeground(QColor(colors[severity]));
+    }
     qInstallMessageHandler(simpleMessageHandler);
     logsShown = true; // Inicialmente mostrados
 
@@ -324,8 +347,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) { // Constructor c
     logsLayout->addWidget(logs);
 
     // Usamos la clase de arriba para logstream, una para salida estándar y otra para errores, que redirigen estas salidas al log
-    static LogStream logStreamOut(QtInfoMsg);
-    static LogStream logStreamErr(QtCriticalMsg);
+    static LogStream logStreamOut(LOG_STDOUT);
+    static LogStream logStreamErr(LOG_STDERR);
 
     // Unimos el buffer de salida estándar y de salida de errores a las clases logstream
     cout.rdbuf(&logStreamOut);
@@ -333,19 +356,60 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) { // Constructor c
 
     mainLayout->addLayout(logsLayout);
 
-    // Detectar puertos disponibles solo al iniciar la aplicación
-    updateAvailablePorts();
+    // Lo que se escribe en los logs desde cualquier hilo se pinta por lotes
+    QTimer *logTimer = new QTimer(this);
+    connect(logTimer, &QTimer::timeout, this, &MainWindow::drainLogs);
+    logTimer->start(LOG_DRAIN_INTERVAL);
+
+    // Nivel de los logs por categoría, por ejemplo EOLE_LOG_LEVEL=info o EOLE_LOG_LEVEL=serial=trace,protocol=debug
+    QByteArray logLevels = qgetenv(LOG_LEVEL_VARIABLE);
+    if (!logLevels.isEmpty() && !configureLogLevels(logLevels.toStdString())) {
+        cerr << "Invalid " << LOG_LEVEL_VARIABLE << " value: " << logLevels.toStdString() << "\n";
+    }
+
+    // Endpoint de métricas para el scraper de la estación, opcional
+    metricsServer = new MetricsServer(this);
+    int metricsPort = qEnvironmentVariableIntValue(METRICS_PORT_VARIABLE);
+    if (metricsPort > 0 && metricsPort <= 65535) {
+        metricsServer->start(static_cast<quint16>(metricsPort));
+    }
+
+    // Captura binaria del tráfico serie para analizarla después (captureanalyzer.cpp), opcional
+    if (qEnvironmentVariableIntValue(CAPTURE_VARIABLE) > 0) {
+        serialManager->setCaptureDirectory(logsDirPath);
+    }
+
+    // Detectar puertos disponibles solo al iniciar la aplicación, con lo que se sabe de la última vez solo se sondean los puertos nuevos
+    portDiscovery = new PortDiscovery(this);
+    refreshBatch = -1;
+    connect(portDiscovery, &PortDiscovery::portProbed, this, &MainWindow::handlePortProbed);
+    connect(portDiscovery, &PortDiscovery::finished, this, &MainWindow::handleDiscoveryFinished);
+    updateAvailablePorts(true);
+
+    // Desconexiones por eventos: el sistema avisa cuando aparece o desaparece un puerto y el manejador cuando el puerto falla
+    connect(serialManager, &manager::portLost, this, &MainWindow::handlePortLost);
+    hotplugMonitor = new HotplugMonitor(this);
+    connect(hotplugMonitor, &HotplugMonitor::portAdded, this, &MainWindow::handlePortAdded);
+    connect(hotplugMonitor, &HotplugMonitor::portRemoved, this, &MainWindow::handlePortRemoved);
+    if (!hotplugMonitor->start()) {
+        // Sin avisos del sistema seguimos enumerando los puertos, como antes
+        QTimer *disconnectTimer = new QTimer(this);
+        connect(disconnectTimer, &QTimer::timeout, this, &MainWindow::monitorForcedDisconnects);
+        disconnectTimer->start(HOTPLUG_FALLBACK_INTERVAL);
+    }
 
-    // Crear e iniciar el timer para la función de monitoreo
-    QTimer *disconnectTimer = new QTimer(this);
-    connect(disconnectTimer, &QTimer::timeout, this, &MainWindow::monitorForcedDisconnects);
-    disconnectTimer->start(200); // 200 ms, no hace falta un Thread porque consume muy muy poco y no interfiere con la app
+    // Lectura de comprobación con el enlace en reposo, para sensores que dejan de contestar sin que el puerto dé error
+    int heartbeatInterval = qEnvironmentVariableIntValue(HEARTBEAT_VARIABLE);
+    if (heartbeatInterval > 0) {
+        serialManager->setHeartbeat(heartbeatInterval);
+    }
 }
 
 MainWindow::~MainWindow() {
     // Destructor para borrar las instancias que creamos (la del manejador)
     disconnectSerialPort(); // Desconectar de forma segura antes de cerrar
     delete serialManager;
+    delete logWriter; // Escribe lo que quede en la cola antes de cerrar el fichero
 }
 
 // Guardar los logs en un archivo
@@ -389,44 +453,81 @@ void MainWindow::saveLogToFile() {
     }
 }
 
-void MainWindow::simpleMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
-    if (!globalLogBox) return;
+// Guardar las trazas de latencia de las últimas transacciones, para abrirlas en chrome://tracing o ui.perfetto.dev
+void MainWindow::saveTraceToFile() {
+    QString logsDirPath = QCoreApplication::applicationDirPath() + "/EOLE_logs"; // Misma carpeta que los logs
+    QDir dir;
+    if (!dir.exists(logsDirPath)) {
+        dir.mkpath(logsDirPath);
+    }
 
-    // Todos los tipos de notificaciones que hace el Qt
-    QString prefix;
-    switch (type) {
-    case QtDebugMsg:    prefix = "[DEBUG] "; break;
-    case QtWarningMsg:  prefix = "[WARNING] "; break;
-    case QtCriticalMsg: prefix = "[CRITICAL] "; break;
-    case QtFatalMsg:    prefix = "[FATAL] "; break;
-    case QtInfoMsg:     prefix = "[INFO] "; break;
+    QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd_HH-mm-ss");
+    QString filePath = logsDirPath + "/" + QString("EOLE_trace_%1.json").arg(timestamp);
+
+    if (!exportChromeTrace(filePath.toStdString())) {
+        QMessageBox::warning(this, "Error", "Unable to save trace to file.");
+        return;
     }
 
-    // Diferente formato y color para cada uno de los distintos tipos
-    QString finalMessage;
+    // El desglose por registro también va a los logs, para verlo sin abrir la traza
+    cout << "Latency breakdown by register:\n" << formatTraceBreakdown() << flush;
+    QMessageBox::information(this, "Notification", "Trace saved to:\n" + filePath);
+}
+
+void MainWindow::simpleMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
+    // Todos los tipos de notificaciones que hace el Qt, el prefijo y el color se ponen al pintarlos
+    LOGSEVERITY severity = LOG_DEBUG;
     switch (type) {
-    case QtDebugMsg:    finalMessage = "<font color='gray'>[DEBUG] " + msg + "</font>"; break;
-    case QtInfoMsg:     finalMessage = "<font color='blue'>[INFO] " + msg + "</font>"; break;
-    case QtWarningMsg:  finalMessage = "<font color='orange'>[WARNING] " + msg + "</font>"; break;
-    case QtCriticalMsg: finalMessage = "<font color='red'>[CRITICAL] " + msg + "</font>"; break;
-    case QtFatalMsg:    finalMessage = "<font color='darkred'>[FATAL] " + msg + "</font>"; break;
+    case QtDebugMsg:    severity = LOG_DEBUG; break;
+    case QtInfoMsg:     severity = LOG_INFO; break;
+    case QtWarningMsg:  severity = LOG_WARNING; break;
+    case QtCriticalMsg: severity = LOG_CRITICAL; break;
+    case QtFatalMsg:    severity = LOG_FATAL; break;
     }
 
-    // Scroll automatico al final
-    QMetaObject::invokeMethod(globalLogBox, [finalMessage]() {
+    // Solo se encola, puede llamarse desde cualquier hilo
+    logLine(severity, msg.toStdString());
+}
 
-    // Si nos pasamos de 1000 lineas automaticamente borra las mas antiguas
-    if (globalLogBox->document()->blockCount() > 1000) {
-        QTextCursor cursor(globalLogBox->document());
-        cursor.movePosition(QTextCursor::Start);
-        cursor.select(QTextCursor::BlockUnderCursor);
-        cursor.removeSelectedText();
-        cursor.deleteChar();  // Eliminar salto de línea
+void MainWindow::drainLogs() {
+    vector<LogEntry> batch;
+    batch.reserve(LOG_DRAIN_BATCH);
+    logQueue().drain(batch, LOG_DRAIN_BATCH);
+
+    uint64_t dropped = logQueue().takeDropped();
+    if (dropped > 0) {
+        LogEntry notice;
+        notice.severity = LOG_WARNING;
+        notice.text = to_string(dropped) + " log lines were dropped (log queue full).";
+        batch.push_back(notice);
+    }
+    if (batch.empty()) return;
+
+    // Solo bajamos el scroll si el usuario ya estaba abajo del todo
+    QScrollBar *scrollBar = logs->verticalScrollBar();
+    bool atBottom = scrollBar->value() == scrollBar->maximum();
+
+    // Un único bloque de edición para todo el lote, y un insertText por tramo de líneas seguidas con la misma severidad
+    // El documento ya recorta las líneas antiguas él solo (setMaximumBlockCount)
+    QTextCursor cursor(logs->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+    bool firstLine = logs->document()->isEmpty();
+    size_t i = 0;
+    while (i < batch.size()) {
+        LOGSEVERITY severity = batch[i].severity;
+        string text;
+        for (; i < batch.size() && batch[i].severity == severity; ++i) {
+            if (!firstLine) text += '\n';
+            firstLine = false;
+            text += logSeverityPrefix(severity);
+            text += batch[i].text;
+        }
+        cursor.insertText(QString::fromStdString(text), logFormats[severity]);
     }
+    cursor.endEditBlock();
 
-        globalLogBox->append(finalMessage);
-        globalLogBox->moveCursor(QTextCursor::End);
-    }, Qt::QueuedConnection);
+    if (atBottom) scrollBar->setValue(scrollBar->maximum());
 }
 
 // Gestionar el mostrar u ocultar los logs
@@ -473,42 +574,113 @@ void MainWindow::storeCustomVariable() {
     }
 }
 
-void MainWindow::updateAvailablePorts() {
-    // Reiniciamos el puerto al que estamos conectado, por si no aparece
-    QString currentPort = selectedPort;
-    portSelector->clear();
-    availablePorts.clear();  // Limpiar la lista global de puertos antes de actualizarla
+void MainWindow::updateAvailablePorts(bool useCache) {
+    const QList<QSerialPortInfo> ports = QSerialPortInfo::availablePorts();
+
+    // Los puentes tcp: y unix: no aparecen como puertos serie ni se sondean, se listan tal cual se configuraron
+    QStringList endpoints = QString::fromLocal8Bit(qgetenv(TRANSPORT_ENDPOINTS_VARIABLE)).split(',', Qt::SkipEmptyParts);
+    for (QString &endpoint : endpoints) endpoint = endpoint.trimmed();
+
+    // Si el puerto seleccionado ya no está disponible, desconectamos
+    bool currentFound = endpoints.contains(selectedPort);
+    for (const QSerialPortInfo &portInfo : ports) {
+        currentFound = currentFound || portInfo.portName() == selectedPort;
+    }
+    if (!currentFound) {
+        disconnectSerialPort();
+    }
 
-    // Añadir a la lista los puertos que encuentre
-    for (const QSerialPortInfo &portInfo : QSerialPortInfo::availablePorts()) {
-        availablePorts.append(portInfo.portName());
+    // Rehacemos la lista sin que el dropdown abra ni cierre nada, el puerto al que estamos conectados se queda (ya sabemos que es un EOLE)
+    {
+        QSignalBlocker blocker(portSelector);
+        portSelector->clear();
+        availablePorts.clear();  // Limpiar la lista global de puertos antes de actualizarla
+        if (!selectedPort.isEmpty()) {
+            availablePorts.append(selectedPort);
+            portSelector->addItem(selectedPort);
+            portSelector->setCurrentIndex(0);
+        }
+    }
+    for (const QString &endpoint : endpoints) {
+        if (!endpoint.isEmpty()) addPortToSelector(endpoint);
     }
-    portSelector->addItems(availablePorts);
 
+    // Al arrancar, los puertos que ya se sondearon con el mismo adaptador salen directamente de la caché, el resto se sondea a la vez
+    QList<QSerialPortInfo> toProbe;
+    for (const QSerialPortInfo &portInfo : ports) {
+        if (portInfo.portName() == selectedPort || !portDiscovery->isCandidate(portInfo)) continue;
+
+        DiscoveryResult cached;
+        if (useCache && portDiscovery->cachedResult(portInfo, cached)) {
+            if (cached.answered) addPortToSelector(portInfo.portName());
+            continue;
+        }
+        toProbe.append(portInfo);
+    }
+    refreshBatch = portDiscovery->discover(toProbe);
+}
+
+void MainWindow::addPortToSelector(const QString &portName) {
+    if (availablePorts.contains(portName)) return;
+
+    // Se añade sin tocar la selección, que el puerto nuevo no se abra solo
+    availablePorts.append(portName);
+    QSignalBlocker blocker(portSelector);
+    int current = portSelector->currentIndex();
+    portSelector->addItem(portName);
+    portSelector->setCurrentIndex(current);
+}
+
+void MainWindow::handlePortProbed(const DiscoveryResult &result) {
+    if (!result.answered) {
+        cout << "No EOLE sensor on port " << result.portName.toStdString() << " (" << result.elapsedMs << " ms).\n";
+        return;
+    }
+
+    cout << "EOLE sensor found on port " << result.portName.toStdString() << ", MCK 0x"
+         << QString::number(result.mck, 16).toUpper().toStdString() << " (" << result.elapsedMs << " ms).\n";
+    addPortToSelector(result.portName);
+}
+
+void MainWindow::handleDiscoveryFinished(int batch, const QList<DiscoveryResult> &results) {
+    if (batch != refreshBatch) return; // Sondeo de un puerto recién conectado, ya se añadió en handlePortProbed si contestó
+    refreshBatch = -1;
+
+    int slowest = 0;
+    for (const DiscoveryResult &result : results) {
+        slowest = max(slowest, result.elapsedMs);
+    }
+    if (!results.isEmpty()) {
+        cout << results.size() << " port/s probed in " << slowest << " ms.\n";
+    }
+
+    // Si nadie contestó (sensor apagado, adaptador fuera del filtro de VID/PID) mostramos todos los puertos, como antes
+    int sensores = availablePorts.length();
+    if (sensores == 0) {
+        for (const QSerialPortInfo &portInfo : QSerialPortInfo::availablePorts()) {
+            addPortToSelector(portInfo.portName());
+        }
+    }
     int puertos = availablePorts.length();
 
     // Le damos tiempo para que no bloquee la aparición de la ventana principal, ya que se invoca según se inicializa y si no solapa
-    QTimer::singleShot(100, this, [this, puertos]() {
-        // Crear y mostrar el popup de notificación con el número de puertos encontrados
-        if (puertos > 0) {
+    QTimer::singleShot(100, this, [this, sensores, puertos]() {
+        // Crear y mostrar el popup de notificación con el número de sensores encontrados
+        if (sensores > 0) {
             QMessageBox::information(this, "Ports Updated",
-                                     QString("%1 port/s found.").arg(puertos),
+                                     QString("%1 EOLE sensor/s found.").arg(sensores),
+                                     QMessageBox::Ok);
+        } else if (puertos > 0) {
+            QMessageBox::information(this, "Ports Updated",
+                                     QString("No EOLE sensor answered, showing all %1 port/s.").arg(puertos),
                                      QMessageBox::Ok);
         } else {
             QMessageBox::information(this, "Ports Updated",
                                      "No ports found.",
                                      QMessageBox::Ok);
         }
-        clearFields();
+        if (selectedPort.isEmpty()) clearFields();
     });
-
-    // Si el puerto seleccionado ya no está disponible, limpiar la selección
-    if (portSelector->currentIndex() != -1) {
-        if (!availablePorts.contains(currentPort)) {
-            selectedPort.clear();
-            disconnectSerialPort();
-        }
-    }
 }
 
 void MainWindow::openSerialPort() {
@@ -519,18 +691,26 @@ void MainWindow::openSerialPort() {
         return;
     }
 
-    // Si no podemos conectarnos (puerto no disponible) mostrar el error
-    if (!serialManager->openPort(selectedPort)) {
-        QMessageBox::warning(this, "Error", "Serial port could not be opened.");
-        setControlsEnabled(false);
-        clearFields();
-        disconnectSerialPort();
-        return;
-    }
+    // El puerto se abre en el hilo serie, mientras tanto los controles siguen deshabilitados
+    setControlsEnabled(false);
+    QString requestedPort = selectedPort;
+    serialManager->openPort(requestedPort, [this, requestedPort](bool opened) {
+        // Si mientras se abría el usuario cambió o desconectó el puerto, la respuesta ya no sirve
+        if (requestedPort != selectedPort) return;
+
+        // Si no podemos conectarnos (puerto no disponible) mostrar el error
+        if (!opened) {
+            QMessageBox::warning(this, "Error", "Serial port could not be opened.");
+            setControlsEnabled(false);
+            clearFields();
+            disconnectSerialPort();
+            return;
+        }
 
-    setControlsEnabled(true);
-    clearFields(); // Limpiamos los campos
-    updateValues(); // Actualiza valores al cambiar de puerto
+        setControlsEnabled(true);
+        clearFields(); // Limpiamos los campos
+        updateValues(); // Actualiza valores al cambiar de puerto
+    });
 }
 
 void MainWindow::setControlsEnabled(bool enabled) {
@@ -562,65 +742,62 @@ void MainWindow::onRadioIWRToggled() {
     }
 }
 
-vector<uint8_t> MainWindow::uint32ToBytes(uint32_t value) {
-    // Adapta un valor de 4 bytes a un vector de 4 bytes en big endian
-    return {
-        static_cast<uint8_t>((value >> 24) & 0xFF),
-        static_cast<uint8_t>((value >> 16) & 0xFF),
-        static_cast<uint8_t>((value >> 8) & 0xFF),
-        static_cast<uint8_t>(value & 0xFF)
-    };
-}
-
-bool MainWindow::sendWriteAndCheck(uint32_t address, const vector<uint8_t>& data) {
-    // Mandamos datos
-    if (!serialManager->sendWritePacket(address, data)) {
-        QMessageBox::warning(this, "Error", "Data could not be sent.");
-        return false;
-    }
+bool MainWindow::checkTransaction(const TransactionResult& result) {
+    // Las canceladas vienen de una desconexión, que ya avisa por su cuenta
+    if (result.status == TRANSACTION_CANCELLED) return false;
 
-    // Recibimos datos
-    vector<uint8_t> response = serialManager->receiveData();
-    if (response.empty()) {
-        QMessageBox::warning(this, "Error", "No response received from the device.");
-        return false;
+    // Feedback de la respuesta formateada
+    if (result.responseSize > 0) {
+        DEBUG_LOG(LOGCAT_TRANSACTION) << (result.type == WRITE_TRANSACTION ? "Response received after writing: " : "Response received: ")
+                                      << HexBytes(result.response.data(), result.responseSize);
     }
+    traceEvent(result.id, result.address, TRACE_UI_APPLIED);
 
-    // Feedback de la respuesta formateada
-    qDebug() << "Response received after writing: "
-             << QByteArray(reinterpret_cast<const char*>(response.data()), response.size()).toHex(' ');
+    if (result.status == TRANSACTION_OK) return true;
 
-    // Comprobamos el CRC
-    if (!validateCRC(response)) {
-        QMessageBox::warning(this, "Error", "Response does not have a valid CRC.");
-        return false;
-    }
+    if (result.status == TRANSACTION_BAD_CRC) qDebug() << "CRC not valid.";
+    QMessageBox::warning(this, "Error", transactionErrorMessage(result));
+    return false;
+}
 
-    // Comprobamos que sea respuesta correcta (header 0x40 y status 0x80 OK)
-    if (response[0] != HEADER || response[1] != PACKET_RESPONSE_OK) {
-        QMessageBox::warning(this, "Error", "Device did not confirm writing value.");
-        return false;
+QString MainWindow::transactionErrorMessage(const TransactionResult& result) {
+    bool isWrite = (result.type == WRITE_TRANSACTION);
+
+    // Mismos mensajes que cuando cada comprobación se hacía a mano
+    switch (result.status) {
+    case TRANSACTION_SEND_ERROR: return isWrite ? "Data could not be sent." : "No writing petition could be sent.";
+    case TRANSACTION_TIMEOUT:    return isWrite ? "No response received from the device." : "No response was received.";
+    case TRANSACTION_BAD_FORMAT: return "Incorrect response format.";
+    case TRANSACTION_BAD_CRC:    return isWrite ? "Response does not have a valid CRC." : "Response was not validated successfully.";
+    case TRANSACTION_NOTOK:      return isWrite ? "Device did not confirm writing value." : "Response was not validated successfully.";
+    case TRANSACTION_CANCELLED:  return "Request was cancelled.";
+    default:                     return "";
     }
-
-    return true;
 }
 
-void MainWindow::writeOnInit() {
+void MainWindow::writeOnInit(function<void()> next) {
     // Primero leer el registro del reloj interno (masterclock), necesitamos los valores de sus bits
-    readMCKRegister();
+    readMCKRegister([this, next]() { writeMinimumPeriod(next); });
+}
 
+void MainWindow::writeMinimumPeriod(function<void()> next) {
     // Obtenemos el texto del campo de INT_TIME y lo convertimos
     QString value = readOnlyFields[INTTIME]->text();
-    if (value.isEmpty()) return;
+    if (value.isEmpty()) {
+        if (next) next();
+        return;
+    }
 
     // Calculamos el nuevo valor del periodo en funcion del tiempo de integración
-    int newPeriodValue = (MinTFrame * MCK) + ONE;
-    vector<uint8_t> data = uint32ToBytes(newPeriodValue);
+    uint32_t newPeriodValue = minimumPeriodValue(MinTFrame, sensorClock);
 
-    // Enviamos el paquete
-    if (!sendWriteAndCheck(INT_PERIOD_ADDRESS, data)) return;
-
-    readOnlyFields[INTPERIOD]->setText(QString::number(newPeriodValue));
+    // Enviamos el paquete y seguimos con la secuencia tanto si sale bien como si no
+    serialManager->writeRegister(INT_PERIOD_ADDRESS, newPeriodValue, [this, newPeriodValue, next](const TransactionResult &result) {
+        if (checkTransaction(result)) {
+            readOnlyFields[INTPERIOD]->setText(QString::number(newPeriodValue));
+        }
+        if (next) next();
+    });
 }
 
 void MainWindow::writeVariable(int index) {
@@ -665,9 +842,9 @@ void MainWindow::writeVariable(int index) {
 
     // Que nunca supere el TFrame al TInt, se descalibra
     if (index == INTPERIOD) {
-        int intTime = readOnlyFields[INTTIME]->text().toInt();
-        if (decimalValue < intTime) {
-            QMessageBox::warning(this, "Error", "INT_PERIOD can't be less than INT_TIME.");
+        REGISTERCHECK check = checkPeriod(decimalValue, readOnlyFields[INTTIME]->text().toUInt());
+        if (check != REGISTER_VALID) {
+            QMessageBox::warning(this, "Error", registerCheckMessage(check));
             return;
         }
     }
@@ -690,124 +867,100 @@ void MainWindow::writeVariable(int index) {
         }
     }
 
-    auto data = uint32ToBytes(decimalValue);
-    if (!sendWriteAndCheck(address, data)) return;
-
-    // Pero lo tiene que meter en otro porque hay 1 mas, el de FPS
-    // Lógica especial para escritura en campo de lectura
-    if (index != INTTIME && index != INTPERIOD) {
-        // Hay que compensar el índice porque el campo de tframe descuadra la alineación a partir del period
-        if (index == VARIABLES_QUANTITY) {
-            QString hexString = QString("0x%1").arg(decimalValue, 8, 16, QLatin1Char('0')).toUpper().replace("X", "x");
-            readOnlyFields[++index]->setText(hexString);
-
-            // Si el registro custom es Tint o Tframe hay que actualizar los campos y todos los valores que dependen de ambos
-            if (customVariable.toInt() == INT_TIME_ADDRESS || customVariable.toInt() == INT_PERIOD_ADDRESS) { updateValues(); }
-            // Si el registro custom es el GPOL, actualizar tambien el campo del GPOL
-            if (customVariable.toInt() == GPOL_ADDRESS) { readOnlyFields[GPOL]->setText(QString::number(hexString.toInt())); }
+    serialManager->writeRegister(address, decimalValue, [this, index, decimalValue](const TransactionResult &result) {
+        if (!checkTransaction(result)) return;
+
+        // Pero lo tiene que meter en otro porque hay 1 mas, el de FPS
+        // Lógica especial para escritura en campo de lectura
+        int field = index;
+        if (field != INTTIME && field != INTPERIOD) {
+            // Hay que compensar el índice porque el campo de tframe descuadra la alineación a partir del period
+            if (field == VARIABLES_QUANTITY) {
+                QString hexString = QString("0x%1").arg(decimalValue, 8, 16, QLatin1Char('0')).toUpper().replace("X", "x");
+                readOnlyFields[++field]->setText(hexString);
+
+                // Si el registro custom es Tint o Tframe hay que actualizar su campo, y con Tint también el periodo que depende de él
+                // Ya sabemos lo que se ha escrito y el MCK/OUTPUT están en caché, no hace falta releer todo
+                if (customVariable.toInt() == INT_TIME_ADDRESS) {
+                    readOnlyFields[INTTIME]->setText(QString::number(decimalValue));
+                    writeOnInit();
+                }
+                if (customVariable.toInt() == INT_PERIOD_ADDRESS) { readOnlyFields[INTPERIOD]->setText(QString::number(decimalValue)); }
+                // Si el registro custom es el GPOL, actualizar tambien el campo del GPOL
+                if (customVariable.toInt() == GPOL_ADDRESS) { readOnlyFields[GPOL + 1]->setText(QString::number(decimalValue)); }
+
+            } else {
+                readOnlyFields[++field]->setText(QString::number(decimalValue));
+            }
 
         } else {
-            readOnlyFields[++index]->setText(QString::number(decimalValue));
+            readOnlyFields[field]->setText(QString::number(decimalValue));
         }
 
-    } else {
-        readOnlyFields[index]->setText(QString::number(decimalValue));
-    }
-
-    // Lógica especial para INT_TIME
-    if (index == INTTIME) {
-        writeOnInit();
-    }
-}
-
-bool MainWindow::sendReadRequest(int address, vector<uint8_t>& response) {
-    vector<uint8_t> packet = serialManager->createReadPacket(address);
-
-    // Mandamos el paquete
-    if (!serialManager->sendData(packet)) {
-        QMessageBox::warning(this, "Error", "No writing petition could be sent.");
-        return false;
-    }
-
-    qDebug() << "Petition sent, awaiting answer...";
-
-    // Leemos la respuesta
-    response = serialManager->receiveData();
-    if (response.empty()) {
-        QMessageBox::warning(this, "Error", "No response was received.");
-        return false;
-    }
-
-    qDebug() << "Response received:" << formatResponseForDebug(response);
-    return true;
-}
-
-QString MainWindow::formatResponseForDebug(const vector<uint8_t>& response) {
-    // Para ver en hexadecimal que todo el paquete sea correcto
-    QString str;
-    for (auto byte : response) {
-        str += QString("0x%1 ").arg(byte, 2, 16, QLatin1Char('0')).toUpper();
-    }
-    return str.trimmed();
-}
-
-bool MainWindow::sanitizeResponse(vector<uint8_t>& response) {
-    // Ajustar el paquete de respuesta inicial y los posibles paquetes con bytes extra por la comunicación serial
-    if (response.size() > 8) {
-        auto it = std::find(response.begin(), response.end(), HEADER);
-        if (it != response.end() && distance(it, response.end()) >= 8) {
-            response = vector<uint8_t>(it, it + 8);
-        } else {
-            QMessageBox::warning(this, "Error", "Invalid or incomplete response.");
-            return false;
+        // Lógica especial para INT_TIME
+        if (index == INTTIME) {
+            writeOnInit();
         }
-    }
+    });
+}
 
-    // Si despues de ajustar el paquete para evitar los paquetes "saturados" del serial, sigue sin ser correcto, salimos
-    if (response.size() != 8 || response[0] != HEADER ||
-        (response[1] != PACKET_RESPONSE_OK && response[1] != PACKET_RESPONSE_NOTOK)) {
-        QMessageBox::warning(this, "Error", "Incorrect response format.");
-        return false;
+void MainWindow::updateValues() {
+    // Todo lo que necesita la conexión en una sola lectura por lotes: TINT, los auxiliares para los cálculos (OUTPUT y MCK), TFRAME, GPOL
+    // y el registro custom solo si hay un registro escogido
+    vector<int> addresses = { INT_TIME_ADDRESS, stoi(OUTPUTREGISTER, nullptr, 16), stoi(MCKREGISTER, nullptr, 16),
+                              INT_PERIOD_ADDRESS, GPOL_ADDRESS };
+    if (!customVariable.isEmpty()) {
+        addresses.push_back(customVariable.toInt());
     }
 
-    return true;
+    serialManager->readRegisters(addresses, [this](const RegisterResults &results) { applyValues(results); });
 }
 
-bool MainWindow::validateAndExtractValue(const vector<uint8_t>& response, uint32_t& value) {
-    // Comprobar que la respuesta sea correcta y extraerla
-    if (response[1] == PACKET_RESPONSE_OK && validateCRC(response)) {
-        value = (response[5] | (response[4] << 8) | (response[3] << 16) | (response[2] << 24));
-        return true;
-    }
+void MainWindow::applyValues(const RegisterResults& results) {
+    // Si se desconectó mientras tanto, todo viene cancelado y no hay nada que mostrar
+    if (results.empty() || results.begin()->second.status == TRANSACTION_CANCELLED) return;
 
-    QMessageBox::warning(this, "Error", "Response was not validated successfully.");
-    return false;
-}
+    QStringList failures; // Registros que no se han podido leer, se avisan todos juntos al final
 
+    auto resultFor = [&results](int address) -> const TransactionResult& { return results.at(address); };
+    auto addFailure = [this, &failures](const TransactionResult &result) {
+        failures.append(QString("0x%1: %2").arg(result.address, 3, 16, QLatin1Char('0')).toUpper().replace("X", "x")
+                        .arg(transactionErrorMessage(result)));
+    };
 
-void MainWindow::updateValues() {
-    // Actualizar todos los valores (el registro custom solo si hay un registro escogido)
+    // Mismo orden que la secuencia original: campos de la UI y, tras el TINT, los auxiliares para los cálculos
     int limit = customVariable.isEmpty() ? VARIABLES_QUANTITY - 1 : VARIABLES_QUANTITY;
-
-    // Misma secuencia de operaciones para cada registro
+    bool intTimeRead = false;
     for (int i = 0; i <= limit; ++i) {
-        int address = getAddressFromIndex(i);
+        const TransactionResult &result = resultFor(getAddressFromIndex(i));
+        if (result.status != TRANSACTION_OK) {
+            addFailure(result);
+            continue;
+        }
+        if (!validateValueByType(i, result.value)) continue;
 
-        vector<uint8_t> response;
-        if (!sendReadRequest(address, response)) return;
-        if (!sanitizeResponse(response)) return;
+        updateReadOnlyField(i, result.value);
+        if (i == INTTIME) intTimeRead = true;
+    }
 
-        uint32_t value = 0;
-        if (!validateAndExtractValue(response, value)) return;
+    const TransactionResult &output = resultFor(stoi(OUTPUTREGISTER, nullptr, 16));
+    const TransactionResult &mck = resultFor(stoi(MCKREGISTER, nullptr, 16));
+    if (output.status != TRANSACTION_OK) addFailure(output);
+    if (mck.status != TRANSACTION_OK) addFailure(mck);
 
-        if (!validateValueByType(i, value)) return;
+    for (const auto &entry : results) {
+        traceEvent(entry.second.id, entry.first, TRACE_UI_APPLIED);
+    }
 
-        updateReadOnlyField(i, value);
+    if (!failures.isEmpty()) {
+        QMessageBox::warning(this, "Error", "Some registers could not be read:\n" + failures.join("\n"));
+    }
 
-        // Cuando leamos el primer valor, también sacamos los datos auxiliares para los cálculos antes de seguir leyendo valores
-        if (i == INTTIME) {
-            writeOnInit();
-        }
+    // Con TINT, OUTPUT y MCK leídos ya podemos calcular y ajustar el periodo al máximo rendimiento (fps)
+    if (intTimeRead && output.status == TRANSACTION_OK && mck.status == TRANSACTION_OK) {
+        applyOutputRegister(output.value);
+        applyMCKRegister(mck.value);
+        writeMinimumPeriod(nullptr);
     }
 }
 
@@ -822,14 +975,12 @@ int MainWindow::getAddressFromIndex(int index) {
 }
 
 bool MainWindow::validateValueByType(int index, uint32_t value) {
-    // Comprobar los valores
-    if ((index == INTTIME || index == INTPERIOD) && value < ONE) {
-        QMessageBox::warning(this, "Error", "Value must be equal or greater than 1.");
-        return false;
-    }
+    // Comprobar los valores con las mismas reglas que el modo flota, el registro custom va tal cual
+    if (index >= VARIABLES_QUANTITY) return true;
 
-    if (index == GPOL && (value < 1500 || value > 3600)) {
-        QMessageBox::warning(this, "Error", "GPOL value must be between 1500 mV and 3600 mV.");
+    REGISTERCHECK check = checkRegisterValue(getAddressFromIndex(index), value);
+    if (check != REGISTER_VALID) {
+        QMessageBox::warning(this, "Error", registerCheckMessage(check));
         return false;
     }
 
@@ -848,61 +999,34 @@ void MainWindow::updateReadOnlyField(int index, uint32_t value) {
     }
 }
 
-void MainWindow::readMCKRegister() {
+void MainWindow::readMCKRegister(function<void()> next) {
     // Primero leemos el registro de los outputs, para tener los valores de los cálculos posteriores
-    readOutputRegister();
-
-    int reg = stoi(MCKREGISTER, nullptr, 16);
-    vector<uint8_t> response;
-
-    if (!sendReadRequest(reg, response)) return;
-    if (!sanitizeResponse(response)) return;
+    readOutputRegister([this, next]() {
+        int reg = stoi(MCKREGISTER, nullptr, 16);
 
-    uint32_t value = 0;
-    if (!validateAndExtractValue(response, value)) return;
-
-    // Necesitamos los 2 primeros bytes
-    value = value & 0xFFFF;
-
-    uint8_t clkSRCbits = value & 0x01; // Primer bit
-    uint8_t mckDIVbits = (value >> 4) & 0x03; // Bits 4 y 5
-    uint8_t xclkDIV = (value >> 8) & 0xFF; // Segundo byte entero
-
-    int clkSRC = decodeClkSource(clkSRCbits); // Calcular el clkSRC
-    int mckDIV = decodeMckDiv(mckDIVbits); // Calcular el mckDIV
-
-    calculateMCKValues(clkSRC, xclkDIV, mckDIV); // Calcular los valores del MCK con todos los datos anteriores
+        // El MCK casi nunca cambia, normalmente sale de la caché sin tocar el cable
+        serialManager->readCachedRegister(reg, [this, next](const TransactionResult &result) {
+            if (checkTransaction(result)) {
+                applyMCKRegister(result.value);
+            }
+            next();
+        });
+    });
 }
 
-int MainWindow::decodeClkSource(uint8_t clkSRCbits) {
-    // Decodificamos los bits del CLK
-    switch (clkSRCbits) {
-    case ZERO: return CLK;
-    case ONE:
+void MainWindow::applyMCKRegister(uint32_t value) {
+    decodeMckRegister(value, sensorClock);
+    if (sensorClock.externalClock) {
         QMessageBox::warning(this, "Warning", "External clock source selected");
-        return CLK; // Placeholder, no vendrá así configurado pero hay que contemplarlo
-    default: return CLK;
     }
-}
 
-int MainWindow::decodeMckDiv(uint8_t mckDIVbits) {
-    // Decodificamos los bits del MCK
-    switch (mckDIVbits) {
-    case ZERO: return FIRST; // 00
-    case ONE: return SECOND; // 01
-    case TWO: return THIRD; // 10
-    default: return FIRST;
-    }
+    calculateMinimumFrame(); // Calcular el TFrame mínimo y las FPS con el MCK nuevo
 }
 
-void MainWindow::calculateMCKValues(int clkSRC, int xclkDIV, int mckDIV) {
-    // Hacemos los cálculos del MCK una vez tenemos el resto de datos de los bits
-    float XClk = (clkSRC * E6) * OPERATION / xclkDIV;
-    MCK = XClk / mckDIV;
-
+void MainWindow::calculateMinimumFrame() {
     try {
-        // Operaciones sacadas del manual, hay que hacer cambios de unidades en alguna
-        MinTFrame = (readOnlyFields[INTTIME]->text().toUInt() / MCK) + (pixels / (MCK * outputs));
+        // Mismas operaciones que el modo flota (registerrules)
+        MinTFrame = minimumFrameTime(readOnlyFields[INTTIME]->text().toUInt(), sensorClock);
         FPS = ONE / MinTFrame;
 
         fpsBox->setText(QString::number(FPS));
@@ -918,55 +1042,20 @@ void MainWindow::calculateMCKValues(int clkSRC, int xclkDIV, int mckDIV) {
     }
 }
 
-void MainWindow::readOutputRegister() {
+void MainWindow::readOutputRegister(function<void()> next) {
     int reg = stoi(OUTPUTREGISTER, nullptr, 16);
 
-    vector<uint8_t> response;
-    if (!sendReadRequest(reg, response)) return;
-    if (!sanitizeResponse(response)) return;
-
-    uint32_t value = 0;
-    if (!validateAndExtractValue(response, value)) return;
-
-    value = value & 0xFFFF; // 2 primeros bytes
-
-    pixels = decodeResolution((value >> 6) & 0x03); // Bytes 6 y 7
-    outputs = ((value >> 5) & 0x01) ? FOUR_VIDEO_OUTPUTS : TWO_VIDEO_OUTPUTS; // Bit 5
-
-    // Forzar a que sean 4 a modo de placeholder para evitar fallos
-    // Debería tener 4 en el registro sin embargo salen 2, a pesar que la imagen se muestra para 4 con datos de 4...
-    outputs = FOUR_VIDEO_OUTPUTS;
-}
-
-int MainWindow::decodeResolution(uint8_t resBits) {
-    // Calculamos resolución máxima
-    switch (resBits) {
-    case ZERO: return FIRSTRES; // 00
-    case ONE: return SECONDRES; // 01
-    case TWO: return THIRDRES; // 10
-    default: {
-            // Random, no debería ocurrir nunca este caso si está correctamente configurada de fábrica
-            int options[] = { FIRSTRES, SECONDRES, THIRDRES };
-            return options[QRandomGenerator::global()->bounded(3)];
+    // Igual que el MCK, normalmente sale de la caché sin tocar el cable
+    serialManager->readCachedRegister(reg, [this, next](const TransactionResult &result) {
+        if (checkTransaction(result)) {
+            applyOutputRegister(result.value);
         }
-    }
+        next();
+    });
 }
 
-bool MainWindow::validateCRC(const vector<uint8_t>& response) {
-    // Solo pasar la respuesta completa al manejador, que se encargará de la validación.
-    bool isValid = serialManager->validateCRC(response);  // El manejador calcula y valida el CRC.
-
-    // Si el CRC es válido, imprimimos el CRC calculado y el recibido.
-    if (isValid) {
-        // Extraemos el CRC recibido (últimos dos bytes de la respuesta).
-        uint16_t receivedCRC = (response[response.size() - 2] << 8) | response[response.size() - 1];  // Big-endian CRC
-
-        qDebug() << "CRC Calculated and received are both valid: 0x" << QString::number(receivedCRC, 16).toUpper();
-    } else {
-        qDebug() << "CRC not valid.";
-    }
-
-    return isValid;  // Devuelve si el CRC es válido (true o false)
+void MainWindow::applyOutputRegister(uint32_t value) {
+    decodeOutputRegister(value, sensorClock);
 }
 
 void MainWindow::bitDecode(uint32_t data) {
@@ -1033,7 +1122,61 @@ void MainWindow::clearFields() {
 
 }
 
+void MainWindow::handlePortAdded(const QString &portName) {
+    if (availablePorts.contains(portName)) return; // Ya en la lista
+
+    // Solo se añade si contesta un EOLE (handlePortProbed), kernel y udev avisan los dos pero solo se sondea una vez
+    QSerialPortInfo portInfo(portName);
+    if (portInfo.isNull() || !portDiscovery->isCandidate(portInfo)) return;
+    portDiscovery->discover(QList<QSerialPortInfo>{portInfo});
+}
+
+void MainWindow::handlePortRemoved(const QString &portName) {
+    if (!availablePorts.contains(portName)) return;
+
+    if (portName == selectedPort) {
+        handlePortLost("the device was unplugged.");
+    }
+
+    availablePorts.removeAll(portName);
+    int index = portSelector->findText(portName);
+    if (index >= 0) {
+        QSignalBlocker blocker(portSelector);
+        portSelector->removeItem(index);
+    }
+    cout << "Port " << portName.toStdString() << " unplugged.\n";
+}
+
+void MainWindow::openFleetWindow() {
+    // Solo una ventana de flota a la vez
+    if (fleetWindow) {
+        fleetWindow->raise();
+        fleetWindow->activateWindow();
+        return;
+    }
+
+    // El puerto de esta ventana no entra en la flota, ya lo tiene abierto nuestro manejador
+    QStringList ports = availablePorts;
+    ports.removeAll(selectedPort);
+    if (ports.isEmpty()) {
+        QMessageBox::information(this, "Fleet mode", "No other ports available for fleet mode.");
+        return;
+    }
+
+    fleetWindow = new FleetWindow(ports, this);
+    fleetWindow->setAttribute(Qt::WA_DeleteOnClose); // Al cerrarla se cierran sus puertos
+    fleetWindow->show();
+}
+
+void MainWindow::handlePortLost(const QString &reason) {
+    if (selectedPort.isEmpty()) return; // Ya desconectado (pueden llegar varios avisos por la misma desconexión)
+
+    cerr << "Connection to " << selectedPort.toStdString() << " lost: " << reason.toStdString() << "\n";
+    disconnectSerialPort();
+}
+
 void MainWindow::monitorForcedDisconnects() {
+    // Solo en plataformas sin avisos de hotplug (ver HotplugMonitor), enumera los puertos cada HOTPLUG_FALLBACK_INTERVAL
     // Si no estamos conectados no hace nada
     if (portSelector->currentIndex() == -1) return;
 
@@ -18,17 +18,32 @@
 #include <QButtonGroup>
 #include <QByteArray>
 #include <QTimer>
+#include <QSignalBlocker>
 #include <QDateTime>
 #include <QTime>
 #include <QRandomGenerator>
-#include <QTextEdit>
+#include <QPlainTextEdit>
+#include <QTextCursor>
+#include <QTextCharFormat>
+#include <QScrollBar>
 #include <QDir>
 #include <QFile>
+#include <QPointer>
 #include <vector>
+#include <functional>
 #include <bitset>
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <array>
+#include "transaction.h"
+#include "metricsserver.h"
+#include "logqueue.h"
+#include "logwriter.h"
+#include "hotplugmonitor.h"
+#include "portdiscovery.h"
+#include "fleetwindow.h"
+#include "registerrules.h"
 
 // Ignorar warnings, las bibliotecas son usadas en el source file (.cpp), no las reconoce como en uso porque no se usan en el propio header (.h)
 
@@ -44,10 +59,16 @@ public:
     explicit MainWindow(QWidget *parent = nullptr); // Constructor
     ~MainWindow(); //Destructor
     // Pública para agregar cout y cerr de otras clases a los logs
-    static QTextEdit *globalLogBox;    // Manejador para unir los mensajes del sistema a los logs
+    static QPlainTextEdit *globalLogBox;    // Manejador para unir los mensajes del sistema a los logs
 
 private:
     manager *serialManager;               // Instancia de la clase manejador
+    MetricsServer *metricsServer;         // Endpoint de métricas en 127.0.0.1 (solo escucha si se pide con EOLE_METRICS_PORT)
+    LogFileWriter *logWriter;             // Escritor continuo de logs a EOLE_logs (rotación, compresión y presupuesto de disco)
+    HotplugMonitor *hotplugMonitor;       // Avisos del sistema al conectar o desconectar puertos
+    PortDiscovery *portDiscovery;         // Búsqueda de sensores en todos los puertos a la vez, con caché de resultados
+    int refreshBatch;                     // Lote de la última búsqueda de updateAvailablePorts, el único que saca el aviso al terminar
+    QPointer<FleetWindow> fleetWindow;    // Ventana del modo flota (se borra sola al cerrarla)
 
     QStringList availablePorts;           // Lista de puertos disponibles
     QGridLayout *gridLayout;              // Layout en grid para las variables
@@ -63,6 +84,7 @@ private:
     QPushButton *disconnectPortButton;    // Botón para desconectar el puerto actual
     QPushButton *updateButton;            // Botón para actualizar valores de los registros (campos de lectura)
     QPushButton *updatePortsButton;       // Botón para actualizar puertos
+    QPushButton *fleetButton;             // Botón para abrir la ventana del modo flota
     QString selectedPort;                 // Puerto serie seleccionado actualmente (al que se conecta)
     QLineEdit *writeBOX;                  // Caja de escritura para la variable custom (dirección de memoria de la misma, en hex)
     QString customVariable;               // Variable para almacenar el valor de la Custom Variable (en decimal)
@@ -71,56 +93,60 @@ private:
     QLineEdit *tframeBox;                 // Para mostrar el tframe (va a parte del resto de cajas del grid layout)
     QPushButton *hideLogs;                // Boton para ocultar o mostrar logs (ocultar el cuadro de texto)
     QPushButton *saveLogs;                // Boton para guardar los logs en un txt (en la subcarpeta EOLE_logs dentro del directorio de instalación de la app)
+    QPushButton *saveTrace;               // Boton para guardar las trazas de latencia en JSON de Chrome (también en EOLE_logs)
     QPushButton *clearLogs;               // Boton para borrar los logs (limpiar cuadro de texto)
-    QTextEdit  *logs;                     // Caja para texto de los logs donde mostrar todo
+    QPlainTextEdit *logs;                 // Caja para texto de los logs donde mostrar todo (con un máximo de LOG_MAX_LINES líneas)
+    array<QTextCharFormat, LOG_SEVERITIES> logFormats; // Color de cada tipo de mensaje
     bool logsShown;                       // Comprobar si los logs se están mostrando o no para saber si ocultar o mostrar
 
-    double MCK;                           // Guardar el MCK para operaciones internas de los cálculos de registros
+    SensorClock sensorClock;              // MCK, resolución y outputs (forzados a 4) decodificados para los cálculos de registros
     double MinTFrame;                     // Guardar el minimo Tframe para evitar pérdida de rendimiento
     double FPS;                           // Guardar variable con los FPS actuales
-    int pixels;                           // Resolucion (operación de alto * ancho)
-    int outputs;                          // Cantidad de outputs (Forzar a 4 si son 2 para evitar pérdida de rendimiento)
 
-    vector<uint8_t> uint32ToBytes(uint32_t value);   // Función para convertir un uint32_t en un vector de 4 bytes
-    bool sendWriteAndCheck(uint32_t address, const vector<uint8_t>& data); // Función para enviar un paquete y comprobar la respuesta
     void manageLogs();                    // Muestra u oculta los logs
     void clearAllLogs();                  // Maneja la limpieza de los logs
     void saveLogToFile();                 // Guarda los logs en un archivo default dentro de la carpeta de la app
+    void saveTraceToFile();               // Guarda las trazas de latencia y vuelca el desglose por registro en los logs
     static void simpleMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg); // Gestionar los logs
+    void drainLogs();                     // Pinta por lotes lo que haya en la cola de logs
 
-    bool sendReadRequest(int address, vector<uint8_t>& response); // Función para mandar paquete de lectura
-    QString formatResponseForDebug(const vector<uint8_t>& response); // Función para formatear la respuesta y poder debugearla (en los logs)
-    bool sanitizeResponse(vector<uint8_t>& response); // Función para comprobar la respuesta del paquete
-    bool validateAndExtractValue(const vector<uint8_t>& response, uint32_t& value); // Función para validar el paquete y extraer respuesta
+    bool checkTransaction(const TransactionResult& result); // Función para comprobar el resultado de una transacción y avisar si algo falló
+    QString transactionErrorMessage(const TransactionResult& result); // Mensaje de error para el usuario según el estado de la transacción
     int getAddressFromIndex(int index);   // Función para obtener la dirección en función del index
     bool validateValueByType(int index, uint32_t value); // Función para validar el tipo de valor
     void updateReadOnlyField(int index, uint32_t value); // Función para actualizar los campos de solo lectura
-    int decodeResolution(uint8_t resBits); // Funnción para obtener la resolución
-    int decodeClkSource(uint8_t clkSRCbits); // Función para obtener el CLK
-    int decodeMckDiv(uint8_t mckDIVbits); // Función para obtener los bits del MCK
-    void calculateMCKValues(int clkSRC, int xclkDIV, int mckDIV); // Función para obtener el MCK
+    void calculateMinimumFrame();         // Función para obtener el TFrame mínimo y las FPS con el MCK ya decodificado
     void bitDecode(uint32_t data);        // Función que decodifica los datos en bits (debugging avanzado para registros custom)
 
     void storeCustomVariable();           // Función para almacenar la variable custom
-    void updateAvailablePorts();          // Función para actualizar los puertos disponibles
+    void updateAvailablePorts(bool useCache = false); // Función para actualizar los puertos disponibles (solo los que contestan como un EOLE)
     void openSerialPort();                // Función para abrir el puerto serie seleccionado
     void setControlsEnabled(bool enabled);// Habilitar/deshabilitar controles en función de la selección del puerto
     void writeVariable(int index);        // Función para escribir una variable en el registro correspondiente
     void updateValues();                  // Función para actualizar los valores en la UI (los registros)
-    void writeOnInit();                   // Función para actualizar el period tras leer el time y ajustarlo al máximo rendimiento (fps)
+    void applyValues(const RegisterResults& results); // Vuelca en la UI el resultado de la lectura por lotes de la conexión
+    void writeOnInit(function<void()> next = nullptr); // Función para actualizar el period tras leer el time y ajustarlo al máximo rendimiento (fps)
+    void writeMinimumPeriod(function<void()> next); // Escribe el TFrame mínimo para el TInt actual con los datos del MCK ya calculados
 
-    void readMCKRegister();               // Leemos el registro que determina ITR o IWR, el MCK
-    void readOutputRegister();            // Leemos el registro que determina los outputs
+    void readMCKRegister(function<void()> next);    // Leemos el registro que determina ITR o IWR, el MCK
+    void readOutputRegister(function<void()> next); // Leemos el registro que determina los outputs
+    void applyMCKRegister(uint32_t value);          // Decodifica el registro del MCK y recalcula FPS y TFrame mínimo
+    void applyOutputRegister(uint32_t value);       // Decodifica el registro de los outputs (resolución y número de salidas)
 
     void onRadioITRToggled();             // Activamos los cambios si es modo ITR
     void onRadioIWRToggled();             // Activamos los cambios si es modo IWR
 
-    bool validateCRC(const vector<uint8_t>& response);  // Funcion que llama al manejador para validar un CRC
-
     void handlePortSelection(int index);  // Función para manejar la selección de puertos
     void disconnectSerialPort();          // Función para desconectar el puerto serie
     void clearFields();                   // Limpia los campos al desconectar un puerto
-    void monitorForcedDisconnects();      // Monitorizacion continua de fondo sobre desconexiones forzosas
+    void addPortToSelector(const QString &portName); // Añade un puerto a la lista sin cambiar la selección (ni abrir nada)
+    void handlePortProbed(const DiscoveryResult &result); // Añade a la lista un puerto en el que ha contestado un EOLE
+    void handleDiscoveryFinished(int batch, const QList<DiscoveryResult> &results); // Aviso con los sensores encontrados
+    void handlePortAdded(const QString &portName);   // Sondea un puerto que acaba de aparecer (se añade si contesta)
+    void handlePortRemoved(const QString &portName); // Quita de la lista un puerto que ha desaparecido (y desconecta si era el nuestro)
+    void handlePortLost(const QString &reason);      // Desconecta tras un error del puerto o un sensor que ya no contesta
+    void openFleetWindow();               // Abre (o trae al frente) la ventana del modo flota con los puertos de la lista
+    void monitorForcedDisconnects();      // Monitorizacion por sondeo, solo si la plataforma no avisa de los cambios de puertos
 };
 
 #endif // MAINWINDOW_H
@@ -1,81 +1,478 @@
 #include "manager.h"
-#include "serialmanager.h"
+#include "serialworker.h"
+#include "serialreactor.h"
+#include "values.h"
+#include "tracing.h"
+#include "metrics.h"
+#include "logging.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
 
 using namespace std;
 
-int cont = 0;
+// Identificadores únicos en todo el proceso, no por manejador: el anillo de trazas es global y la flota abre un manejador por puerto
+static atomic<uint64_t> nextTransactionId(1);
 
-manager::manager() {
-    // Ya no es necesario hacer new, ya que SerialManager es miembro directo de la clase
+manager::manager(QObject *parent)
+    : QObject(parent), dispatched(0), dispatchLimit(PIPELINE_DEPTH * SCHEDULER_WINDOWS), worker(nullptr), reactor(nullptr),
+      reactorLink(-1), scheduledReported(0), portOpen(false), heartbeatPending(false), missedResponses(0) {
+#ifdef __linux__
+    // Con muchos sensores en el mismo equipo, un solo hilo epoll atiende todos los puertos en lugar de un hilo por manejador
+    if (qgetenv(REACTOR_VARIABLE) == REACTOR_BACKEND) {
+        reactor = &serialReactor();
+    }
+#endif
+
+    if (!reactor) {
+        // El worker se mueve al hilo serie y allí crea el SerialManager, así el QSerialPort nunca se toca desde la UI
+        worker = new SerialWorker(this);
+        worker->moveToThread(&serialThread);
+        serialThread.start();
+
+        QMetaObject::invokeMethod(worker, [this]() { worker->initialize(); }, Qt::QueuedConnection);
+
+        // Los errores del puerto llegan desde el hilo serie, la conexión los pasa al hilo de la UI
+        connect(worker, &SerialWorker::portLost, this, &manager::portLost);
+    }
+    connect(&heartbeatTimer, &QTimer::timeout, this, &manager::sendHeartbeat);
+
+    // El reloj y los outputs son configuración de fábrica, los registros de la UI solo cambian si los escribimos nosotros
+    registerCache.setPolicy(MCK_ADDRESS, CACHE_UNTIL_INVALIDATED);
+    registerCache.setPolicy(OUTPUT_ADDRESS, CACHE_UNTIL_INVALIDATED);
+    registerCache.setPolicy(INT_TIME_ADDRESS, CACHE_MAX_AGE, CACHE_MAX_AGE_TIME);
+    registerCache.setPolicy(INT_PERIOD_ADDRESS, CACHE_MAX_AGE, CACHE_MAX_AGE_TIME);
+    registerCache.setPolicy(GPOL_ADDRESS, CACHE_MAX_AGE, CACHE_MAX_AGE_TIME);
 }
 
 manager::~manager() {
-    closePort();  // Cerramos el puerto cuando destruimos el objeto
+    linkMetrics().scheduled.add(-scheduledReported); // Lo que quedara en el planificador deja de contar con el manejador
+
+#ifdef __linux__
+    if (reactor) {
+        // closePort del reactor espera a que el enlace esté fuera, después ya no llega ningún callback suyo
+        if (reactorLink >= 0) reactor->closePort(reactorLink);
+        return;
+    }
+#endif
+
+    // Cerramos el puerto y destruimos el backend dentro de su hilo antes de pararlo
+    worker->cancelPending();
+    QMetaObject::invokeMethod(worker, [this]() { worker->shutdown(); }, Qt::BlockingQueuedConnection);
+
+    serialThread.quit();
+    serialThread.wait();
+    delete worker;
 }
 
-// Usamos la instancia de serialManager para abrir el puerto
-bool manager::openPort(const QString &portName) {
-    return serialManager.openPort(portName);
+// Pedimos al hilo serie que abra el puerto y devolvemos el resultado en el hilo de la UI
+void manager::openPort(const QString &portName, function<void(bool)> callback) {
+    registerCache.invalidateAll(); // Otro puerto puede ser otro sensor
+#ifdef __linux__
+    if (reactor) {
+        openReactorLink(portName);
+        bool opened = reactorLink >= 0;
+        QMetaObject::invokeMethod(this, [this, callback, opened]() {
+            portOpen = opened;
+            missedResponses = 0;
+            lastResponse = chrono::steady_clock::now();
+            if (callback) callback(opened);
+        }, Qt::QueuedConnection);
+        return;
+    }
+#endif
+    QMetaObject::invokeMethod(worker, [this, portName, callback]() {
+        bool opened = worker->openPort(portName);
+        QMetaObject::invokeMethod(this, [this, callback, opened]() {
+            portOpen = opened;
+            missedResponses = 0;
+            lastResponse = chrono::steady_clock::now();
+            if (callback) callback(opened);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
 }
 
-// Usamos la instancia de serialManager para cerrar el puerto
+// Cancelamos lo que quede en cola y pedimos al hilo serie que cierre el puerto
 void manager::closePort() {
-    serialManager.closePort();
+    portOpen = false;
+    registerCache.invalidateAll();
+    joinableReads.clear(); // Las que están en camino avisan igualmente a los suyos, pero ya no se une nadie más
+    for (const Transaction &transaction : scheduler.takeAll()) {
+        cancelUnsent(transaction);
+    }
+    reportScheduled();
+#ifdef __linux__
+    if (reactor) {
+        // Lo pendiente se cancela dentro del reactor y sus callbacks llegan igualmente al hilo de la UI
+        if (reactorLink >= 0) reactor->closePort(reactorLink);
+        reactorLink = -1;
+        return;
+    }
+#endif
+    worker->cancelPending();
+    QMetaObject::invokeMethod(worker, [this]() { worker->closePort(); }, Qt::QueuedConnection);
 }
 
 bool manager::checkPort() {
-    return serialManager.checkPortStatus(); // Comprobamos el estado del puerto
+#ifdef __linux__
+    if (reactor) {
+        return reactorLink < 0 || reactor->isLinkHealthy(reactorLink); // El reactor lo sabe en cuanto falla el puerto, no hay que preguntar
+    }
+#endif
+
+    // Devolvemos el último estado conocido y pedimos que se vuelva a comprobar en cuanto el hilo serie quede libre
+    QMetaObject::invokeMethod(worker, [this]() { worker->refreshPortStatus(); }, Qt::QueuedConnection);
+    return worker->isPortHealthy();
+}
+
+uint64_t manager::readRegister(int address, TransactionCallback callback, bool pipelined, TRANSACTIONPRIORITY priority) {
+    Transaction transaction;
+    transaction.type = READ_TRANSACTION;
+    transaction.address = address;
+    transaction.pipelined = pipelined;
+    transaction.priority = priority;
+    return submit(transaction, callback);
+}
+
+uint64_t manager::writeRegister(int address, uint32_t value, TransactionCallback callback, TRANSACTIONPRIORITY priority) {
+    Transaction transaction;
+    transaction.type = WRITE_TRANSACTION;
+    transaction.address = address;
+    transaction.value = value;
+    transaction.priority = priority;
+    return submit(transaction, callback);
+}
+
+bool manager::cancel(uint64_t id) {
+    if (cancelWaiter(id)) return true;
+
+    Transaction cancelled;
+    if (!scheduler.cancel(id, cancelled)) return false;
+    reportScheduled();
+    cancelUnsent(cancelled);
+    return true;
+}
+
+void manager::readCachedRegister(int address, TransactionCallback callback) {
+    uint32_t value = 0;
+    if (!registerCache.lookup(address, value)) {
+        readRegister(address, callback);
+        return;
+    }
+
+    // Aunque el valor ya lo tengamos, se entrega igual que una respuesta del cable: más tarde y en el hilo de la UI
+    TransactionResult result;
+    result.type = READ_TRANSACTION;
+    result.address = address;
+    result.value = value;
+    result.fromCache = true;
+    QMetaObject::invokeMethod(this, [callback, result]() {
+        if (callback) callback(result);
+    }, Qt::QueuedConnection);
+}
+
+void manager::invalidateCache(int address) {
+    if (address < 0) {
+        registerCache.invalidateAll();
+    } else {
+        registerCache.invalidate(address);
+    }
 }
 
-bool manager::sendWritePacket(int index, const vector<uint8_t>& data) {
-    vector<uint8_t> packet = serialManager.createWritePacket(index, data);  // Creamos el paquete de escritura
-    return serialManager.sendData(packet);  // Usamos la función que envía el paquete
+void manager::readRegisters(const vector<int>& addresses, BatchCallback callback, TRANSACTIONPRIORITY priority) {
+    // Quitamos direcciones repetidas manteniendo el orden pedido, cada registro se lee una sola vez
+    vector<int> uniqueAddresses;
+    for (int address : addresses) {
+        if (find(uniqueAddresses.begin(), uniqueAddresses.end(), address) == uniqueAddresses.end()) {
+            uniqueAddresses.push_back(address);
+        }
+    }
+
+    if (uniqueAddresses.empty()) {
+        if (callback) callback(RegisterResults());
+        return;
+    }
+
+    // Estado compartido entre los callbacks de cada lectura, el último en llegar entrega el lote completo
+    struct BatchState {
+        RegisterResults results;
+        size_t pending;
+    };
+    shared_ptr<BatchState> state = make_shared<BatchState>();
+    state->pending = uniqueAddresses.size();
+
+    // Todas van pipelined, y un fallo en una no impide que se lean las demás
+    for (int address : uniqueAddresses) {
+        readRegister(address, [state, callback](const TransactionResult &result) {
+            state->results[result.address] = result;
+            if (--state->pending == 0 && callback) {
+                callback(state->results);
+            }
+        }, true, priority);
+    }
 }
 
-vector<uint8_t> manager::createReadPacket(int index) {
-    return serialManager.createReadPacket(index);  // Devolvemos el paquete de lectura
+void manager::setPipelineDepth(int depth) {
+    if (!worker) return; // El reactor manda una petición cada vez por enlace
+    worker->setPipelineDepth(depth);
+
+    // En el hilo serie solo lo justo para no dejar huecos entre ráfagas: lo que sobre espera aquí, donde aún se puede adelantar
+    dispatchLimit = max(1, min(depth, PIPELINE_MAX_DEPTH)) * SCHEDULER_WINDOWS;
+    dispatch();
+}
+
+void manager::setHeartbeat(int intervalMs) {
+    if (intervalMs <= 0) {
+        heartbeatTimer.stop();
+        return;
+    }
+    heartbeatTimer.start(intervalMs);
 }
 
-// Función para enviar datos a través de SerialManager
-bool manager::sendData(const vector<uint8_t>& data) {
-    return serialManager.sendData(data);
+void manager::sendHeartbeat() {
+    // Solo si el enlace lleva todo el intervalo en silencio, con tráfico normal las propias respuestas ya dicen que sigue vivo
+    if (!portOpen || heartbeatPending) return;
+    if (chrono::steady_clock::now() - lastResponse < chrono::milliseconds(heartbeatTimer.interval())) return;
+
+    // El MCK es configuración de fábrica, leerlo no cambia nada en el sensor
+    // Va en segundo plano y, si no ha salido antes del siguiente intervalo, ya no dice nada útil y se descarta
+    Transaction transaction;
+    transaction.type = READ_TRANSACTION;
+    transaction.address = MCK_ADDRESS;
+    transaction.priority = PRIORITY_BACKGROUND;
+    transaction.deadline = chrono::steady_clock::now() + chrono::milliseconds(heartbeatTimer.interval());
+    heartbeatPending = true;
+    submit(transaction, [this](const TransactionResult &) { heartbeatPending = false; });
 }
 
-// Función para recibir datos a través de SerialManager
-vector<uint8_t> manager::receiveData() {
+void manager::trackLink(const TransactionResult &result) {
+    if (result.status == TRANSACTION_CANCELLED || result.status == TRANSACTION_SEND_ERROR) return; // No dicen nada del sensor
 
-    // Para casos de prueba
-    /*vector<uint8_t> packet = serialManager.readTestData(cont);
-    packet.erase(packet.begin() + 5);
-    packet.erase(packet.begin() + 6);
-    ++cont;
-    if (cont >= 4) {
-        cont = 0;
+    if (result.status != TRANSACTION_TIMEOUT) {
+        // Cualquier respuesta, aunque sea NOTOK o con el CRC mal, es que el sensor sigue al otro lado
+        missedResponses = 0;
+        lastResponse = chrono::steady_clock::now();
+        return;
     }
-    return packet;*/
 
-    return serialManager.readData();
+    if (!heartbeatTimer.isActive() || !portOpen) return;
+    if (++missedResponses >= HEARTBEAT_MAX_MISSES) {
+        missedResponses = 0;
+        emit portLost(QString("The sensor stopped answering (%1 consecutive timeouts).").arg(HEARTBEAT_MAX_MISSES));
+    }
 }
 
-bool manager::validateCRC(const vector<uint8_t>& response) {
+void manager::setCaptureDirectory(const QString &directory) {
+    // La captura la escribe el SerialManager, así que se configura dentro del hilo serie (el reactor no captura)
+    if (!worker) return;
+    QMetaObject::invokeMethod(worker, [this, directory]() { worker->setCaptureDirectory(directory); }, Qt::QueuedConnection);
+}
+
+uint64_t manager::submit(Transaction transaction, TransactionCallback callback) {
+    transaction.id = nextTransactionId.fetch_add(1, memory_order_relaxed);
+    uint64_t generation = registerCache.generation();
+    uint32_t written = (transaction.type == WRITE_TRANSACTION) ? transaction.value : 0;
+    chrono::steady_clock::time_point submitted = chrono::steady_clock::now();
+    linkMetrics().inFlight.add(1);
+
+    // Al terminar, primero la caché (write-through), luego la señal (para quien escuche todas las transacciones) y luego el callback de quien la pidió
+    transaction.callback = [this, callback, generation, written, submitted](const TransactionResult &result) {
+        LinkMetrics &metrics = linkMetrics();
+        metrics.inFlight.add(-1);
+        metrics.transaction(result.type, result.status).increment();
+        if (result.status == TRANSACTION_NOTOK) metrics.notOkResponses.increment();
+        if (result.status != TRANSACTION_CANCELLED) {
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - submitted).count();
+            (result.type == WRITE_TRANSACTION ? metrics.writeLatency : metrics.readLatency).observe(seconds);
+        }
 
-    // Extraer los últimos dos bytes como el CRC recibido
-    uint8_t crcHigh = response[response.size() - 2];  // MSB
-    uint8_t crcLow = response[response.size() - 1];   // LSB
-    uint16_t receivedCRC = (crcHigh << 8) | crcLow;   // Formar el CRC recibido en Big Endian
+        if (result.status == TRANSACTION_OK) {
+            registerCache.store(result.address, result.type == WRITE_TRANSACTION ? written : result.value, generation);
+        } else if (result.type == WRITE_TRANSACTION && result.status != TRANSACTION_CANCELLED) {
+            registerCache.invalidate(result.address); // No sabemos si la escritura llegó a aplicarse
+        }
 
-    // Calcular el CRC de los datos (sin los bytes CRC).
-    uint16_t calculatedCRC = serialManager.crc16Modbus(response);
+        if (result.retries > 0) {
+            INFO_LOG(LOGCAT_TRANSACTION) << (result.type == WRITE_TRANSACTION ? "Write" : "Read") << " of register 0x" << hex << result.address << dec
+                                         << " finished with status " << result.status << " after " << result.retries << " retry/ies.";
+        }
 
-    // Comparar el CRC calculado con el CRC recibido
-    if (calculatedCRC == receivedCRC) {
-        // Si el CRC es válido, imprimir los CRC calculado y recibido.
-        cout << "CRC Calculated: 0x" << hex << calculatedCRC << endl;
-        cout << "CRC Received: 0x" << hex << receivedCRC << endl;
-        return true;  // CRC es válido
+        if (result.type == WRITE_TRANSACTION) writeMarks[result.address]++;
+
+        trackLink(result);
+        emit transactionFinished(result);
+        if (callback) callback(result);
+    };
+
+    traceEvent(transaction.id, transaction.address, TRACE_ENQUEUE);
+    if (transaction.type == WRITE_TRANSACTION) {
+        writeMarks[transaction.address]++; // Las lecturas ya en camino pueden llegar con el valor de antes, nadie más se une a ellas
+    } else if (joinRead(transaction)) {
+        return transaction.id;
     } else {
-        // Si el CRC no es válido, imprimir un mensaje de error.
-        cout << "CRC is not valid." << endl;
-        return false;  // CRC no válido
+        shareRead(transaction);
+    }
+
+    vector<Transaction> superseded;
+    scheduler.push(transaction, superseded);
+    for (const Transaction &replaced : superseded) {
+        linkMetrics().superseded.increment();
+        cancelUnsent(replaced);
+    }
+    dispatch();
+    return transaction.id;
+}
+
+bool manager::joinRead(const Transaction &transaction) {
+    auto joinable = joinableReads.find(transaction.address);
+    if (joinable == joinableReads.end()) return false;
+
+    // Si desde que se pidió se ha pedido o terminado una escritura del registro, su valor puede ser anterior a ella
+    shared_ptr<SharedRead> shared = sharedReads.at(joinable->second);
+    if (shared->writeMark != writeMarks[transaction.address]) {
+        joinableReads.erase(joinable);
+        return false;
+    }
+
+    shared->waiters.push_back(make_pair(transaction.id, transaction.callback));
+    scheduler.adopt(shared->wireId, transaction.priority, transaction.deadline); // Si aún no ha salido, que no espere más que la nueva
+    linkMetrics().coalescedReads.increment();
+    return true;
+}
+
+void manager::shareRead(Transaction &transaction) {
+    shared_ptr<SharedRead> shared = make_shared<SharedRead>();
+    shared->wireId = transaction.id;
+    shared->address = transaction.address;
+    shared->writeMark = writeMarks[transaction.address];
+    shared->waiters.push_back(make_pair(transaction.id, transaction.callback));
+    sharedReads[shared->wireId] = shared;
+    joinableReads[shared->address] = shared->wireId;
+
+    // El resultado del cable va a todos los que se unieron, cada uno con su identificador
+    transaction.callback = [this, shared](const TransactionResult &result) {
+        forgetRead(*shared);
+        for (const pair<uint64_t, TransactionCallback> &waiter : shared->waiters) {
+            TransactionResult copy = result;
+            copy.id = waiter.first;
+            waiter.second(copy);
+        }
+    };
+}
+
+void manager::forgetRead(const SharedRead &shared) {
+    sharedReads.erase(shared.wireId);
+    auto joinable = joinableReads.find(shared.address);
+    if (joinable != joinableReads.end() && joinable->second == shared.wireId) joinableReads.erase(joinable);
+}
+
+bool manager::cancelWaiter(uint64_t id) {
+    for (const auto &entry : sharedReads) {
+        shared_ptr<SharedRead> shared = entry.second;
+        auto waiter = find_if(shared->waiters.begin(), shared->waiters.end(),
+                              [id](const pair<uint64_t, TransactionCallback> &candidate) { return candidate.first == id; });
+        if (waiter == shared->waiters.end()) continue;
+
+        // La lectura del cable sigue mientras quede alguien esperándola, si es el último solo se puede cancelar si aún no ha salido
+        if (shared->waiters.size() == 1) {
+            Transaction unsent;
+            if (!scheduler.cancel(shared->wireId, unsent)) return false; // Ya está en el backend, su resultado llega como el de cualquier otra
+            forgetRead(*shared);
+            reportScheduled();
+        }
+
+        Transaction cancelled;
+        cancelled.id = id;
+        cancelled.type = READ_TRANSACTION;
+        cancelled.address = shared->address;
+        cancelled.callback = waiter->second;
+        shared->waiters.erase(waiter);
+        cancelUnsent(cancelled);
+        return true;
+    }
+    return false;
+}
+
+void manager::dispatch() {
+    while (dispatched < dispatchLimit) {
+        Transaction next;
+        vector<Transaction> expired;
+        bool found = scheduler.pop(chrono::steady_clock::now(), next, expired);
+        for (const Transaction &late : expired) {
+            linkMetrics().expired.increment();
+            cancelUnsent(late);
+        }
+        if (!found) break;
+
+        // Cuando termine deja su hueco a la siguiente del planificador (los callbacks del backend llegan siempre al hilo de la UI)
+        TransactionCallback finished = next.callback;
+        next.callback = [this, finished](const TransactionResult &result) {
+            dispatched--;
+            finished(result);
+            dispatch();
+        };
+        dispatched++;
+        send(next);
+    }
+    reportScheduled();
+}
+
+void manager::reportScheduled() {
+    // La métrica es la suma de todos los manejadores (la flota tiene uno por puerto), cada uno pone solo lo que ha cambiado lo suyo
+    int64_t size = static_cast<int64_t>(scheduler.size());
+    linkMetrics().scheduled.add(size - scheduledReported);
+    scheduledReported = size;
+}
+
+void manager::cancelUnsent(const Transaction &transaction) {
+    // Como cualquier otro resultado, más tarde y en el hilo de la UI, nunca dentro de la llamada que la ha cancelado
+    TransactionResult result;
+    result.id = transaction.id;
+    result.type = transaction.type;
+    result.address = transaction.address;
+    result.status = TRANSACTION_CANCELLED;
+    TransactionCallback finished = transaction.callback;
+    QMetaObject::invokeMethod(this, [finished, result]() { finished(result); }, Qt::QueuedConnection);
+}
+
+void manager::send(Transaction transaction) {
+#ifdef __linux__
+    if (reactor) {
+        if (reactorLink >= 0) {
+            reactor->submit(reactorLink, transaction);
+            return;
+        }
+
+        // Sin puerto abierto no se puede escribir, lo mismo que devuelve el SerialWorker con el puerto cerrado
+        TransactionResult result;
+        result.id = transaction.id;
+        result.type = transaction.type;
+        result.address = transaction.address;
+        result.status = TRANSACTION_SEND_ERROR;
+        TransactionCallback finished = transaction.callback;
+        QMetaObject::invokeMethod(this, [finished, result]() { finished(result); }, Qt::QueuedConnection);
+        return;
     }
+#endif
+    worker->enqueue(transaction);
+}
+
+#ifdef __linux__
+void manager::openReactorLink(const QString &portName) {
+    if (reactorLink >= 0) reactor->closePort(reactorLink); // Igual que SerialManager::openPort, abrir otro puerto cierra el anterior
+
+    // Los dos avisos llegan en el hilo del reactor y se pasan al hilo de la UI, como hace el SerialWorker con los suyos
+    reactorLink = reactor->openPort(portName.toStdString(), [this](const Transaction &transaction, const TransactionResult &result) {
+        if (!transaction.callback) return;
+        TransactionCallback callback = transaction.callback;
+        QMetaObject::invokeMethod(this, [callback, result]() { callback(result); }, Qt::QueuedConnection);
+    }, [this](const string &reason) {
+        QString message = QString::fromStdString(reason);
+        QMetaObject::invokeMethod(this, [this, message]() { emit portLost(message); }, Qt::QueuedConnection);
+    });
+}
+#else
+void manager::openReactorLink(const QString &) {
 }
+#endif
@@ -1,32 +1,93 @@
 #ifndef MANAGER_H
 #define MANAGER_H
 
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QString>
 #include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <chrono>
 #include <stdint.h> // Para uint8_t y uint16_t
-#include "serialmanager.h"
+#include "transaction.h"
+#include "registercache.h"
+#include "transactionscheduler.h"
 #include <iostream>
 
 // Ignorar warnings, las bibliotecas son usadas en el source file (.cpp), no las reconoce como en uso porque no se usan en el propio header (.h)
 
 using namespace std;
 
-class manager {
+class SerialWorker;
+class SerialReactor;
+
+class manager : public QObject {
+    Q_OBJECT
+
 public:
-    manager(); // Constructor
+    explicit manager(QObject *parent = nullptr); // Constructor
     ~manager(); // Destructor
 
-    // Public para poder acceder desde mainwindow
-    bool openPort(const QString &portName); // Para llamar al backend y que abra el puerto
-    void closePort(); // Para llamar al backend y que cierre el puerto
+    // Public para poder acceder desde mainwindow, nada de esto bloquea: el puerto solo se toca desde el hilo serie
+    void openPort(const QString &portName, function<void(bool)> callback); // Para llamar al backend y que abra el puerto (avisa con el resultado)
+    void closePort(); // Para llamar al backend y que cierre el puerto (cancela lo pendiente)
     bool checkPort(); // Para conectar con el backend y comprobar el estado del puerto (monitorización continua)
-    bool sendWritePacket(int index, const vector<uint8_t>& data); // Enviar paquetes de escritura
-    vector<uint8_t> createReadPacket(int index); // Crear paquetes de lectura
-    bool sendData(const vector<uint8_t>& data); // Enviar datos
-    vector<uint8_t> receiveData(); // Recibir datos
-    bool validateCRC(const vector<uint8_t>& response); // Nueva función para validar CRC
+    // Encolar una lectura (pipelined para lecturas masivas) en la clase de prioridad indicada, devuelve su identificador
+    uint64_t readRegister(int address, TransactionCallback callback = nullptr, bool pipelined = false, TRANSACTIONPRIORITY priority = PRIORITY_INTERACTIVE_READ);
+    void readCachedRegister(int address, TransactionCallback callback); // Leer usando la caché si el valor sigue siendo válido, si no al cable
+    void invalidateCache(int address = -1); // Olvidar un registro de la caché (o todos con -1)
+    // Encolar una escritura, devuelve su identificador (reemplaza a otra al mismo registro que aún no haya salido, que acaba cancelada)
+    uint64_t writeRegister(int address, uint32_t value, TransactionCallback callback = nullptr, TRANSACTIONPRIORITY priority = PRIORITY_INTERACTIVE_WRITE);
+    void readRegisters(const vector<int>& addresses, BatchCallback callback, TRANSACTIONPRIORITY priority = PRIORITY_BULK); // Leer varios registros en una ráfaga, con el resultado de cada uno por separado
+    bool cancel(uint64_t id); // Cancela una transacción que aún espera en el planificador (false si ya salió hacia el puerto)
+    void setPipelineDepth(int depth); // Máximo de lecturas pipelined en vuelo a la vez (1 desactiva el pipelining)
+    void setCaptureDirectory(const QString &directory); // Capturar el tráfico de cada conexión en directory (vacío para dejar de capturar)
+    void setHeartbeat(int intervalMs); // Leer el MCK cada intervalMs si no ha habido tráfico, para notar un sensor que ya no contesta (0 lo desactiva)
+
+signals:
+    void transactionFinished(const TransactionResult &result); // Se emite en el hilo de la UI al terminar cada transacción
+    void portLost(const QString &reason); // El puerto abierto se ha perdido (error del puerto o sensor sin contestar), en el hilo de la UI
 
 private:
-    SerialManager serialManager;  // Instancia de SerialManager para manejar la comunicación serial
+    struct SharedRead { // Lectura en camino (en el planificador o en el backend) a la que se pueden unir otras del mismo registro
+        uint64_t wireId;     // Transacción que va al cable, la del primero que la pidió
+        int address;         // Registro que lee
+        uint64_t writeMark;  // writeMarks del registro cuando se pidió, si cambia ya no se puede unir nadie más
+        vector<pair<uint64_t, TransactionCallback>> waiters; // Identificador y callback de cada uno que espera el resultado
+    };
+
+    uint64_t submit(Transaction transaction, TransactionCallback callback); // Asigna identificador y deja la transacción en el planificador
+    bool joinRead(const Transaction &transaction); // Une una lectura a otra del mismo registro ya en camino (false si no se puede)
+    void shareRead(Transaction &transaction); // Abre la ventana para que otras lecturas del mismo registro se unan a esta
+    void forgetRead(const SharedRead &shared); // La lectura compartida ya terminó o se canceló entera
+    bool cancelWaiter(uint64_t id); // Quita una lectura de las que esperan a otra compartida (false si no es ninguna de ellas)
+    void dispatch(); // Pasa al hilo serie (o al reactor) lo más urgente del planificador mientras quede hueco
+    void reportScheduled(); // Actualiza la métrica de transacciones en el planificador con el tamaño del de este manejador
+    void send(Transaction transaction); // Entrega una transacción ya planificada al backend
+    void cancelUnsent(const Transaction &transaction); // Devuelve como cancelada una transacción que no llegó a salir del planificador
+    void sendHeartbeat(); // Lectura de comprobación si el enlace lleva un intervalo en reposo
+    void trackLink(const TransactionResult &result); // Cuenta los timeouts seguidos y avisa si el sensor ha dejado de contestar
+    void openReactorLink(const QString &portName); // Abre el puerto como un enlace del reactor (solo con el backend epoll)
+
+    RegisterCache registerCache; // Copia de los registros del sensor, se actualiza con cada lectura y escritura correcta
+    TransactionScheduler scheduler; // Transacciones que aún no se han pasado al backend, por prioridad
+    int dispatched;             // Transacciones pasadas al backend que aún no han terminado
+    int dispatchLimit;          // Máximo de dispatched (SCHEDULER_WINDOWS ráfagas), el resto espera en el planificador
+    map<uint64_t, shared_ptr<SharedRead>> sharedReads; // Lecturas en camino, por la transacción que va al cable
+    map<int, uint64_t> joinableReads; // La lectura en camino de cada registro a la que aún se puede unir otra
+    map<int, uint64_t> writeMarks; // Sube con cada escritura pedida o terminada de cada registro
+    QThread serialThread;       // Hilo dedicado a la comunicación serie
+    SerialWorker *worker;       // Instancia que maneja el puerto dentro del hilo serie (nullptr con el reactor)
+    SerialReactor *reactor;     // Reactor epoll compartido si se eligió con REACTOR_VARIABLE, nullptr con el SerialWorker
+    int reactorLink;            // Enlace del puerto abierto en el reactor (-1 si no hay)
+    int64_t scheduledReported;  // Lo que este manejador suma ahora mismo a linkMetrics().scheduled
+    QTimer heartbeatTimer;      // Dispara sendHeartbeat (parado si el heartbeat está desactivado)
+    bool portOpen;              // Hay un puerto abierto (según las respuestas de openPort y closePort)
+    bool heartbeatPending;      // Hay una lectura de comprobación sin terminar
+    int missedResponses;        // Timeouts seguidos desde la última respuesta
+    chrono::steady_clock::time_point lastResponse; // Última vez que llegó algo del sensor
 };
 
 #endif // MANAGER_H
@@ -0,0 +1,183 @@
+#include "metrics.h"
+#include <cstdio>
+#include <sstream>
+
+using namespace std;
+
+void MetricHistogram::observe(double seconds) {
+    if (seconds < 0) seconds = 0;
+
+    // Pocos buckets, una búsqueda lineal es más rápida que cualquier otra cosa
+    int bucket = 0;
+    while (bucket < METRICS_LATENCY_BUCKETS && seconds > METRICS_LATENCY_BOUNDS[bucket]) {
+        ++bucket;
+    }
+    buckets[bucket].fetch_add(1, memory_order_relaxed);
+    samples.fetch_add(1, memory_order_relaxed);
+    sumNs.fetch_add(static_cast<uint64_t>(seconds * 1e9), memory_order_relaxed);
+}
+
+uint64_t MetricHistogram::bucketCount(int bucket) const {
+    return buckets[bucket].load(memory_order_relaxed);
+}
+
+uint64_t MetricHistogram::count() const {
+    return samples.load(memory_order_relaxed);
+}
+
+double MetricHistogram::sum() const {
+    return sumNs.load(memory_order_relaxed) / 1e9;
+}
+
+MetricsRegistry::Entry &MetricsRegistry::findOrCreate(const string &name, const string &help, const string &labels, METRICTYPE type) {
+    lock_guard<mutex> locker(registryMutex);
+    for (unique_ptr<Entry> &entry : entries) {
+        if (entry->name == name && entry->labels == labels) return *entry;
+    }
+
+    unique_ptr<Entry> entry(new Entry);
+    entry->name = name;
+    entry->help = help;
+    entry->labels = labels;
+    entry->type = type;
+    switch (type) {
+    case METRIC_COUNTER: entry->counter.reset(new MetricCounter); break;
+    case METRIC_GAUGE: entry->gauge.reset(new MetricGauge); break;
+    case METRIC_HISTOGRAM: entry->histogram.reset(new MetricHistogram); break;
+    }
+    entries.push_back(move(entry));
+    return *entries.back();
+}
+
+MetricCounter &MetricsRegistry::counter(const string &name, const string &help, const string &labels) {
+    return *findOrCreate(name, help, labels, METRIC_COUNTER).counter;
+}
+
+MetricGauge &MetricsRegistry::gauge(const string &name, const string &help, const string &labels) {
+    return *findOrCreate(name, help, labels, METRIC_GAUGE).gauge;
+}
+
+MetricHistogram &MetricsRegistry::histogram(const string &name, const string &help, const string &labels) {
+    return *findOrCreate(name, help, labels, METRIC_HISTOGRAM).histogram;
+}
+
+static string formatLabels(const string &labels, const string &extra = "") {
+    // Junta las etiquetas de la métrica con las del bucket (le="...")
+    if (labels.empty() && extra.empty()) return "";
+    if (labels.empty()) return "{" + extra + "}";
+    if (extra.empty()) return "{" + labels + "}";
+    return "{" + labels + "," + extra + "}";
+}
+
+string MetricsRegistry::renderPrometheus() const {
+    lock_guard<mutex> locker(registryMutex);
+    ostringstream out;
+    vector<string> described; // HELP y TYPE una sola vez por nombre
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const string &name = entries[i]->name;
+        bool seen = false;
+        for (const string &done : described) seen = seen || done == name;
+        if (seen) continue;
+        described.push_back(name);
+
+        const char *type = entries[i]->type == METRIC_COUNTER ? "counter" : (entries[i]->type == METRIC_GAUGE ? "gauge" : "histogram");
+        out << "# HELP " << name << " " << entries[i]->help << "\n";
+        out << "# TYPE " << name << " " << type << "\n";
+
+        // Todas las series con ese nombre, aunque se registraran separadas
+        for (size_t j = i; j < entries.size(); ++j) {
+            const Entry &entry = *entries[j];
+            if (entry.name != name) continue;
+
+            if (entry.type == METRIC_COUNTER) {
+                out << name << formatLabels(entry.labels) << " " << entry.counter->get() << "\n";
+            } else if (entry.type == METRIC_GAUGE) {
+                out << name << formatLabels(entry.labels) << " " << entry.gauge->get() << "\n";
+            } else {
+                // Prometheus quiere los buckets acumulados
+                uint64_t cumulative = 0;
+                char bound[32];
+                for (int bucket = 0; bucket < METRICS_LATENCY_BUCKETS; ++bucket) {
+                    cumulative += entry.histogram->bucketCount(bucket);
+                    snprintf(bound, sizeof(bound), "le=\"%g\"", METRICS_LATENCY_BOUNDS[bucket]);
+                    out << name << "_bucket" << formatLabels(entry.labels, bound) << " " << cumulative << "\n";
+                }
+                cumulative += entry.histogram->bucketCount(METRICS_LATENCY_BUCKETS);
+                out << name << "_bucket" << formatLabels(entry.labels, "le=\"+Inf\"") << " " << cumulative << "\n";
+                out << name << "_sum" << formatLabels(entry.labels) << " " << entry.histogram->sum() << "\n";
+                out << name << "_count" << formatLabels(entry.labels) << " " << entry.histogram->count() << "\n";
+            }
+        }
+    }
+    return out.str();
+}
+
+static const char *transactionStatusLabel(int status) {
+    switch (status) {
+    case TRANSACTION_OK: return "ok";
+    case TRANSACTION_SEND_ERROR: return "send_error";
+    case TRANSACTION_TIMEOUT: return "timeout";
+    case TRANSACTION_BAD_FORMAT: return "bad_format";
+    case TRANSACTION_BAD_CRC: return "bad_crc";
+    case TRANSACTION_NOTOK: return "notok";
+    case TRANSACTION_CANCELLED: return "cancelled";
+    default: return "unknown";
+    }
+}
+
+LinkMetrics::LinkMetrics(MetricsRegistry &registry)
+    : registry(registry),
+      responseTimeouts(registry.counter("eole_response_timeouts_total", "Requests that got no response before the timeout.")),
+      crcFailures(registry.counter("eole_crc_failures_total", "Response frames received with a wrong CRC.")),
+      notOkResponses(registry.counter("eole_notok_responses_total", "Responses with NOTOK status.")),
+      resyncs(registry.counter("eole_resyncs_total", "Times garbage had to be skipped to find a response header.")),
+      resyncBytes(registry.counter("eole_resync_discarded_bytes_total", "Bytes discarded while resynchronising.")),
+      bytesSent(registry.counter("eole_bytes_sent_total", "Bytes written to the serial port.")),
+      bytesReceived(registry.counter("eole_bytes_received_total", "Bytes read from the serial port.")),
+      portOpens(registry.counter("eole_port_opens_total", "Serial ports opened successfully.")),
+      reconnects(registry.counter("eole_reconnects_total", "Successful port openings after the first one.")),
+      portErrors(registry.counter("eole_port_errors_total", "Errors opening or writing to the serial port.")),
+      retries(registry.counter("eole_retries_total", "Automatic retries after a timeout, bad CRC, incomplete frame or NOTOK.")),
+      superseded(registry.counter("eole_superseded_writes_total", "Queued writes replaced by a newer write to the same register.")),
+      expired(registry.counter("eole_deadline_expired_total", "Queued transactions dropped because their deadline passed.")),
+      coalescedReads(registry.counter("eole_coalesced_reads_total", "Reads answered by an identical read already in flight.")),
+      portOpen(registry.gauge("eole_port_open", "Serial ports currently open.")),
+      inFlight(registry.gauge("eole_transactions_in_flight", "Transactions queued or being executed.")),
+      scheduled(registry.gauge("eole_transactions_scheduled", "Transactions waiting in the priority scheduler.")),
+      readLatency(registry.histogram("eole_transaction_latency_seconds", "Time from enqueue to result.", "type=\"read\"")),
+      writeLatency(registry.histogram("eole_transaction_latency_seconds", "Time from enqueue to result.", "type=\"write\"")) {
+
+    for (int type = READ_TRANSACTION; type <= WRITE_TRANSACTION; ++type) {
+        for (int status = 0; status < METRICS_TRANSACTION_STATUSES; ++status) {
+            string labels = string("type=\"") + (type == READ_TRANSACTION ? "read" : "write") + "\",status=\"" + transactionStatusLabel(status) + "\"";
+            transactions[type * METRICS_TRANSACTION_STATUSES + status] =
+                &registry.counter("eole_transactions_total", "Finished transactions by type and status.", labels);
+        }
+    }
+}
+
+MetricCounter &LinkMetrics::transaction(TRANSACTIONTYPE type, TRANSACTIONSTATUS status) {
+    return *transactions[type * METRICS_TRANSACTION_STATUSES + status];
+}
+
+MetricGauge &LinkMetrics::responseTimeout(const string &port) {
+    // El nombre del puerto va como valor de etiqueta, así que se escapan las comillas y las barras invertidas
+    string label = "port=\"";
+    for (char character : port) {
+        if (character == '"' || character == '\\') label += '\\';
+        label += character;
+    }
+    label += "\"";
+    return registry.gauge("eole_response_timeout_ms", "Response timeout derived from the measured round-trip time, per port.", label);
+}
+
+MetricsRegistry &metricsRegistry() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+LinkMetrics &linkMetrics() {
+    static LinkMetrics metrics(metricsRegistry());
+    return metrics;
+}
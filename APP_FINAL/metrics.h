@@ -0,0 +1,126 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+// Registro de métricas del enlace con el sensor: contadores, gauges e histogramas de latencia con buckets fijos
+// Todo con atómicos para que el hilo serie y la UI puedan actualizarlas sin locks; el lock solo se usa al registrar y al exportar
+// Se exportan en formato texto de Prometheus (ver metricsserver.h para el endpoint HTTP)
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "transaction.h"
+
+using namespace std;
+
+#define METRICS_LATENCY_BUCKETS 12 // Buckets del histograma de latencia (más el +Inf)
+#define METRICS_TRANSACTION_STATUSES 7 // Valores de TRANSACTIONSTATUS
+
+// Límites superiores (en segundos) de los buckets, de medio milisegundo al timeout de respuesta y algo más
+inline constexpr array<double, METRICS_LATENCY_BUCKETS> METRICS_LATENCY_BOUNDS = {
+    0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0
+};
+
+enum METRICTYPE { // Tipos de métrica que sabe exportar el registro
+    METRIC_COUNTER = 0, METRIC_GAUGE = 1, METRIC_HISTOGRAM = 2
+};
+
+class MetricCounter { // Solo sube
+public:
+    void increment(uint64_t amount = 1) { value.fetch_add(amount, memory_order_relaxed); }
+    uint64_t get() const { return value.load(memory_order_relaxed); }
+
+private:
+    atomic<uint64_t> value{0};
+};
+
+class MetricGauge { // Sube y baja (estado actual)
+public:
+    void set(int64_t newValue) { value.store(newValue, memory_order_relaxed); }
+    void add(int64_t amount) { value.fetch_add(amount, memory_order_relaxed); }
+    int64_t get() const { return value.load(memory_order_relaxed); }
+
+private:
+    atomic<int64_t> value{0};
+};
+
+class MetricHistogram { // Buckets fijos (METRICS_LATENCY_BOUNDS), cada observación toca un solo bucket
+public:
+    void observe(double seconds); // Apunta una muestra
+    uint64_t bucketCount(int bucket) const; // Muestras de ese bucket (no acumulado, METRICS_LATENCY_BUCKETS es el +Inf)
+    uint64_t count() const; // Total de muestras
+    double sum() const; // Suma de todas las muestras (en segundos)
+
+private:
+    array<atomic<uint64_t>, METRICS_LATENCY_BUCKETS + 1> buckets{};
+    atomic<uint64_t> samples{0};
+    atomic<uint64_t> sumNs{0}; // La suma se guarda en ns para poder usar un atómico entero
+};
+
+class MetricsRegistry {
+public:
+    // Devuelven siempre la misma métrica para el mismo nombre y etiquetas, las referencias son válidas mientras viva el programa
+    // labels va ya en formato Prometheus sin llaves, por ejemplo: type="read",status="ok"
+    MetricCounter &counter(const string &name, const string &help, const string &labels = "");
+    MetricGauge &gauge(const string &name, const string &help, const string &labels = "");
+    MetricHistogram &histogram(const string &name, const string &help, const string &labels = "");
+
+    string renderPrometheus() const; // Todas las métricas en formato texto de Prometheus (version 0.0.4)
+
+private:
+    struct Entry {
+        string name;
+        string help;
+        string labels;
+        METRICTYPE type;
+        unique_ptr<MetricCounter> counter;
+        unique_ptr<MetricGauge> gauge;
+        unique_ptr<MetricHistogram> histogram;
+    };
+
+    Entry &findOrCreate(const string &name, const string &help, const string &labels, METRICTYPE type);
+
+    mutable mutex registryMutex;     // Solo para registrar y exportar, nunca al actualizar una métrica
+    vector<unique_ptr<Entry>> entries; // En orden de registro, las de un mismo nombre se exportan juntas
+};
+
+struct LinkMetrics { // Métricas del enlace serie, ya registradas, para no buscarlas por nombre en cada transacción
+    LinkMetrics(MetricsRegistry &registry); // Constructor, registra todas
+
+    MetricCounter &transaction(TRANSACTIONTYPE type, TRANSACTIONSTATUS status); // Contador de transacciones terminadas
+    // Timeout de respuesta que sale del estimador de ida y vuelta de un puerto (ms), una serie por puerto porque cada uno mide el suyo
+    // Busca en el registro: se pide al abrir el puerto y se guarda la referencia
+    MetricGauge &responseTimeout(const string &port);
+
+    MetricsRegistry &registry;
+
+    array<MetricCounter*, METRICS_TRANSACTION_STATUSES * 2> transactions; // Por tipo y estado
+    MetricCounter &responseTimeouts;   // "No response was received."
+    MetricCounter &crcFailures;        // Tramas con CRC incorrecto (en la búsqueda de trama o en validateCRC)
+    MetricCounter &notOkResponses;     // Respuestas con status NOTOK
+    MetricCounter &resyncs;            // Veces que hubo que saltar basura para encontrar la cabecera
+    MetricCounter &resyncBytes;        // Bytes descartados al resincronizar
+    MetricCounter &bytesSent;          // Bytes escritos en el puerto
+    MetricCounter &bytesReceived;      // Bytes leídos del puerto
+    MetricCounter &portOpens;          // Conexiones correctas
+    MetricCounter &reconnects;         // Conexiones correctas después de la primera
+    MetricCounter &portErrors;         // Fallos al abrir o escribir en el puerto
+    MetricCounter &retries;            // Reintentos automáticos (timeout, CRC, trama incompleta o NOTOK)
+    MetricCounter &superseded;         // Escrituras en cola reemplazadas por otra más nueva al mismo registro
+    MetricCounter &expired;            // Transacciones descartadas en cola porque venció su plazo
+    MetricCounter &coalescedReads;     // Lecturas servidas por otra lectura al mismo registro que ya estaba en camino
+    // Los gauges son de todo el proceso (con la flota hay un manejador por puerto): cada uno suma y resta lo suyo, nunca set
+    MetricGauge &portOpen;             // Puertos abiertos
+    MetricGauge &inFlight;             // Transacciones encoladas o en curso
+    MetricGauge &scheduled;            // Transacciones en el planificador, aún sin pasar al hilo serie
+    MetricHistogram &readLatency;      // Desde que se encola una lectura hasta su resultado
+    MetricHistogram &writeLatency;     // Lo mismo para las escrituras
+};
+
+MetricsRegistry &metricsRegistry(); // Registro global del proceso
+LinkMetrics &linkMetrics(); // Métricas del enlace, registradas en metricsRegistry() la primera vez
+
+#endif // METRICS_H
@@ -0,0 +1,68 @@
+#include "metricsserver.h"
+#include "metrics.h"
+#include "values.h"
+#include <QHostAddress>
+#include <iostream>
+
+using namespace std;
+
+MetricsServer::MetricsServer(QObject *parent) : QObject(parent), server(this) {
+    connect(&server, &QTcpServer::newConnection, this, &MetricsServer::acceptConnections);
+}
+
+bool MetricsServer::start(quint16 port) {
+    if (server.isListening()) server.close();
+
+    if (!server.listen(QHostAddress(QHostAddress::LocalHost), port)) {
+        cerr << "Metrics endpoint could not listen on 127.0.0.1:" << port << ": " << server.errorString().toStdString() << "\n";
+        return false;
+    }
+
+    cout << "Metrics available at http://127.0.0.1:" << port << "/metrics\n";
+    return true;
+}
+
+void MetricsServer::stop() {
+    server.close();
+}
+
+bool MetricsServer::isRunning() const {
+    return server.isListening();
+}
+
+void MetricsServer::acceptConnections() {
+    while (server.hasPendingConnections()) {
+        QTcpSocket *socket = server.nextPendingConnection();
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            pendingRequests.remove(socket);
+            socket->deleteLater();
+        });
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { handleRequest(socket); });
+    }
+}
+
+void MetricsServer::handleRequest(QTcpSocket *socket) {
+    // Esperamos a tener la cabecera entera, el cuerpo de la petición no nos interesa
+    QByteArray &request = pendingRequests[socket];
+    request += socket->readAll();
+    if (!request.contains("\r\n\r\n")) {
+        if (request.size() > METRICS_MAX_REQUEST_SIZE) socket->abort(); // Nadie legítimo manda tanto
+        return;
+    }
+
+    QByteArray status = "200 OK";
+    QByteArray body;
+    if (request.startsWith("GET /metrics ") || request.startsWith("GET / ")) {
+        body = QByteArray::fromStdString(metricsRegistry().renderPrometheus());
+    } else {
+        status = "404 Not Found";
+        body = "Only GET /metrics is served.\n";
+    }
+
+    QByteArray response = "HTTP/1.1 " + status + "\r\n"
+                          "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                          "Connection: close\r\n\r\n" + body;
+    socket->write(response);
+    socket->disconnectFromHost(); // Cierra cuando haya salido todo
+}
@@ -0,0 +1,32 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QByteArray>
+#include <QHash>
+
+// Endpoint HTTP mínimo que sirve metricsRegistry() en formato texto de Prometheus (GET /metrics)
+// Solo escucha en 127.0.0.1, la idea es que lo lea un scraper en la propia estación; vive en el hilo de la UI
+
+class MetricsServer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(QObject *parent = nullptr); // Constructor
+
+    bool start(quint16 port); // Empieza a escuchar en 127.0.0.1:port
+    void stop(); // Deja de escuchar (las conexiones abiertas terminan solas)
+    bool isRunning() const; // Si está escuchando
+
+private:
+    void acceptConnections(); // Atiende las conexiones nuevas
+    void handleRequest(QTcpSocket *socket); // Responde en cuanto ha llegado la cabecera de la petición
+
+    QTcpServer server; // Socket de escucha
+    QHash<QTcpSocket*, QByteArray> pendingRequests; // Lo recibido de cada conexión hasta completar la cabecera
+
+};
+
+#endif // METRICSSERVER_H
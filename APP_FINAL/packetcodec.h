@@ -0,0 +1,160 @@
+#ifndef PACKETCODEC_H
+#define PACKETCODEC_H
+
+// Codificación y decodificación de los paquetes del EOLE, compartida por la app y la librería eole_cmd
+// Solo cabecera y sin memoria dinámica: los paquetes son std::array de tamaño fijo y todo trabaja sobre el buffer de quien llama
+// Todo es constexpr, así que un paquete con dirección y datos conocidos se puede construir entero al compilar
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "crc16.h"
+
+using namespace std;
+
+constexpr size_t READ_REQUEST_SIZE = 8;   // Cabecera, comando, dirección (4) y CRC (2)
+constexpr size_t WRITE_REQUEST_SIZE = 12; // Cabecera, comando, dirección (4), datos (4) y CRC (2)
+constexpr size_t RESPONSE_SIZE = 8;       // Cabecera, status, datos (4) y CRC (2)
+
+constexpr uint8_t PACKET_HEADER_BYTE = 0x40;   // Cabecera de todos los paquetes (dirección del EOLE)
+constexpr uint8_t PACKET_READ_COMMAND = 0x90;  // Comando de lectura
+constexpr uint8_t PACKET_WRITE_COMMAND = 0x99; // Comando de escritura
+constexpr uint8_t PACKET_STATUS_OK = 0x80;     // Status de respuesta OK
+constexpr uint8_t PACKET_STATUS_NOTOK = 0x88;  // Status de respuesta NOTOK
+
+enum FRAMESEARCH { // Resultado de buscar una respuesta en un buffer de recepción
+    SEARCH_FRAME_OK = 0, // Hay una trama completa con CRC correcto
+    SEARCH_BAD_CRC = 1,  // Hay una trama completa con CRC incorrecto (solo sin resincronización)
+    SEARCH_NEED_MORE = 2 // No hay trama completa todavía, hay que esperar más bytes
+};
+
+enum DECODESTATUS { // Resultado de decodificar una respuesta
+    DECODE_OK = 0,         // Trama correcta con status OK, el valor es válido
+    DECODE_NOTOK = 1,      // Trama correcta pero el sensor respondió NOTOK
+    DECODE_BAD_FORMAT = 2, // No empieza por la cabecera o el status no es ninguno de los dos
+    DECODE_BAD_CRC = 3     // Formato correcto pero el CRC no cuadra
+};
+
+constexpr void storeBigEndian32(uint8_t *out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+constexpr uint32_t loadBigEndian32(const uint8_t *in) {
+    return (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 8) | uint32_t(in[3]);
+}
+
+constexpr uint16_t packetCrc(const uint8_t *packet, size_t size) {
+    // CRC de todo el paquete menos los 2 últimos bytes (slicing-by-4 es la variante más rápida con tramas de 6 y 10 bytes)
+    return crc16Slicing4(packet, size - 2);
+}
+
+constexpr void sealPacket(uint8_t *packet, size_t size) {
+    // Escribe el CRC en big endian en los 2 últimos bytes del paquete
+    uint16_t crc = packetCrc(packet, size);
+    packet[size - 2] = static_cast<uint8_t>(crc >> 8);
+    packet[size - 1] = static_cast<uint8_t>(crc);
+}
+
+constexpr bool packetCrcMatches(const uint8_t *packet, size_t size) {
+    uint16_t crc = packetCrc(packet, size);
+    return packet[size - 2] == static_cast<uint8_t>(crc >> 8) && packet[size - 1] == static_cast<uint8_t>(crc);
+}
+
+constexpr void encodeReadRequest(uint8_t *out, uint32_t address) {
+    // out tiene que tener sitio para READ_REQUEST_SIZE bytes
+    out[0] = PACKET_HEADER_BYTE;
+    out[1] = PACKET_READ_COMMAND;
+    storeBigEndian32(out + 2, address);
+    sealPacket(out, READ_REQUEST_SIZE);
+}
+
+constexpr void encodeWriteRequest(uint8_t *out, uint32_t address, uint32_t value) {
+    // out tiene que tener sitio para WRITE_REQUEST_SIZE bytes
+    out[0] = PACKET_HEADER_BYTE;
+    out[1] = PACKET_WRITE_COMMAND;
+    storeBigEndian32(out + 2, address);
+    storeBigEndian32(out + 6, value);
+    sealPacket(out, WRITE_REQUEST_SIZE);
+}
+
+constexpr bool isResponseStart(const uint8_t *in) {
+    // Cabecera y un status conocido, lo que se busca al resincronizar (en tiene que tener al menos 2 bytes)
+    return in[0] == PACKET_HEADER_BYTE && (in[1] == PACKET_STATUS_OK || in[1] == PACKET_STATUS_NOTOK);
+}
+
+constexpr DECODESTATUS decodeResponse(const uint8_t *in, uint32_t &value) {
+    // in tiene que tener RESPONSE_SIZE bytes, value solo se toca si la respuesta es OK
+    if (!isResponseStart(in)) return DECODE_BAD_FORMAT;
+    if (!packetCrcMatches(in, RESPONSE_SIZE)) return DECODE_BAD_CRC;
+    if (in[1] != PACKET_STATUS_OK) return DECODE_NOTOK;
+
+    value = loadBigEndian32(in + 2);
+    return DECODE_OK;
+}
+
+inline FRAMESEARCH findResponseFrame(const uint8_t *buffer, size_t size, bool resync, size_t &frameStart, size_t &consumed) {
+    // Busca una respuesta que empiece por la cabecera y cuyo CRC cuadre, saltándose la basura que haya delante
+    // consumed son los bytes que quien llama tiene que quitar del principio del buffer (basura, y la trama si se encontró)
+    // Sin resync una trama con CRC malo se entrega igual: con varias peticiones en vuelo no se puede saltar una respuesta
+    size_t position = 0;
+    while (size - position >= RESPONSE_SIZE) {
+        const uint8_t *header = static_cast<const uint8_t*>(memchr(buffer + position, PACKET_HEADER_BYTE, size - position));
+        if (header == nullptr) {
+            consumed = size; // Ningún byte puede ser inicio de trama, todo es basura
+            return SEARCH_NEED_MORE;
+        }
+        position = static_cast<size_t>(header - buffer);
+        if (size - position < RESPONSE_SIZE) break;
+
+        if (isResponseStart(header)) {
+            bool crcMatches = packetCrcMatches(header, RESPONSE_SIZE);
+            if (crcMatches || !resync) {
+                frameStart = position;
+                consumed = position + RESPONSE_SIZE; // Lo que sobre se queda para la siguiente búsqueda
+                return crcMatches ? SEARCH_FRAME_OK : SEARCH_BAD_CRC;
+            }
+        }
+
+        // Era un 0x40 dentro de los datos y no una cabecera, nos resincronizamos en el siguiente byte
+        position++;
+    }
+
+    consumed = position;
+    return SEARCH_NEED_MORE;
+}
+
+struct ReadRequest { // Petición de lectura ya codificada, lista para enviar
+    array<uint8_t, READ_REQUEST_SIZE> bytes = {};
+
+    constexpr ReadRequest() = default;
+    constexpr explicit ReadRequest(uint32_t address) { encodeReadRequest(bytes.data(), address); }
+    constexpr const uint8_t *data() const { return bytes.data(); }
+    constexpr size_t size() const { return bytes.size(); }
+    constexpr uint32_t address() const { return loadBigEndian32(bytes.data() + 2); }
+};
+
+struct WriteRequest { // Petición de escritura ya codificada, lista para enviar
+    array<uint8_t, WRITE_REQUEST_SIZE> bytes = {};
+
+    constexpr WriteRequest() = default;
+    constexpr WriteRequest(uint32_t address, uint32_t value) { encodeWriteRequest(bytes.data(), address, value); }
+    constexpr const uint8_t *data() const { return bytes.data(); }
+    constexpr size_t size() const { return bytes.size(); }
+    constexpr uint32_t address() const { return loadBigEndian32(bytes.data() + 2); }
+    constexpr uint32_t value() const { return loadBigEndian32(bytes.data() + 6); }
+};
+
+struct Response { // Respuesta recibida, se rellena directamente desde el buffer de recepción
+    array<uint8_t, RESPONSE_SIZE> bytes = {};
+
+    constexpr uint8_t *data() { return bytes.data(); }
+    constexpr const uint8_t *data() const { return bytes.data(); }
+    constexpr size_t size() const { return bytes.size(); }
+    constexpr DECODESTATUS decode(uint32_t &value) const { return decodeResponse(bytes.data(), value); }
+};
+
+#endif // PACKETCODEC_H
@@ -0,0 +1,200 @@
+#include "portdiscovery.h"
+#include "serialmanager.h"
+#include "readframes.h"
+#include "values.h"
+#include <QSerialPort>
+#include <QSettings>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QStringList>
+#include <iostream>
+
+using namespace std;
+
+PortDiscovery::PortDiscovery(QObject *parent) : QObject(parent), nextBatch(0) {
+    // Lista de VID o VID:PID en hexadecimal separados por comas, "*" para sondear todos los puertos
+    QString ids = qEnvironmentVariable(DISCOVERY_USB_IDS_VARIABLE, DISCOVERY_DEFAULT_USB_IDS).trimmed();
+    if (ids == "*") return;
+
+    for (const QString &entry : ids.split(",", Qt::SkipEmptyParts)) {
+        QStringList parts = entry.trimmed().split(":");
+        bool vidOk = false, pidOk = true;
+        int vid = parts[0].toInt(&vidOk, 16);
+        int pid = parts.size() > 1 ? parts[1].toInt(&pidOk, 16) : -1;
+        if (!vidOk || !pidOk || parts.size() > 2) {
+            cerr << "Ignoring invalid USB id in " << DISCOVERY_USB_IDS_VARIABLE << ": " << entry.toStdString() << "\n";
+            continue;
+        }
+        allowedIds.push_back(make_pair(vid, pid));
+    }
+}
+
+PortDiscovery::~PortDiscovery() {
+    // Los resultados que queden por entregar se pierden, pero los hilos no pueden seguir con el objeto destruido
+    for (Probe &probe : probes) {
+        probe.worker.join();
+    }
+}
+
+bool PortDiscovery::isCandidate(const QSerialPortInfo &port) const {
+    // Sin filtro o sin VID (puertos nativos, virtuales) no hay nada con lo que descartarlo
+    if (allowedIds.empty() || !port.hasVendorIdentifier()) return true;
+
+    for (const pair<int, int> &id : allowedIds) {
+        if (id.first != port.vendorIdentifier()) continue;
+        if (id.second == -1 || (port.hasProductIdentifier() && id.second == port.productIdentifier())) return true;
+    }
+    return false;
+}
+
+QString PortDiscovery::portIdentity(const QSerialPortInfo &port) {
+    if (!port.hasVendorIdentifier()) return QString();
+    return QString::number(port.vendorIdentifier(), 16) + ":" + QString::number(port.productIdentifier(), 16) + ":" + port.serialNumber();
+}
+
+bool PortDiscovery::cachedResult(const QSerialPortInfo &port, DiscoveryResult &result) const {
+    QSettings settings(DISCOVERY_SETTINGS_ORGANIZATION, DISCOVERY_SETTINGS_APPLICATION);
+    settings.beginGroup(QString(DISCOVERY_SETTINGS_GROUP) + "/" + port.portName());
+    bool found = settings.value("checked").isValid() && settings.value("identity").toString() == portIdentity(port);
+    if (found) {
+        // Si en ese puerto hay ahora otro adaptador (otro VID, PID o número de serie) lo guardado no vale
+        result.portName = port.portName();
+        result.identity = portIdentity(port);
+        result.answered = settings.value("answered").toBool();
+        result.mck = settings.value("mck").toUInt();
+        result.elapsedMs = settings.value("elapsed").toInt();
+        result.fromCache = true;
+    }
+    settings.endGroup();
+    return found;
+}
+
+void PortDiscovery::storeResult(const DiscoveryResult &result) {
+    if (!result.opened) return; // Ocupado por otro programa o sin permisos, lo que hubiera guardado sigue valiendo
+
+    QSettings settings(DISCOVERY_SETTINGS_ORGANIZATION, DISCOVERY_SETTINGS_APPLICATION);
+    settings.beginGroup(QString(DISCOVERY_SETTINGS_GROUP) + "/" + result.portName);
+    settings.setValue("identity", result.identity);
+    settings.setValue("answered", result.answered);
+    settings.setValue("mck", result.mck);
+    settings.setValue("elapsed", result.elapsedMs);
+    settings.setValue("checked", QDateTime::currentMSecsSinceEpoch());
+    settings.endGroup();
+}
+
+void PortDiscovery::joinFinished() {
+    for (size_t i = 0; i < probes.size();) {
+        if (probes[i].done->load()) {
+            probes[i].worker.join();
+            probes.erase(probes.begin() + i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+int PortDiscovery::discover(const QList<QSerialPortInfo> &ports) {
+    joinFinished();
+
+    QList<QSerialPortInfo> pendingPorts;
+    for (const QSerialPortInfo &port : ports) {
+        if (!probing.contains(port.portName())) pendingPorts.append(port);
+    }
+
+    int batch = nextBatch++;
+    Batch &pending = batches[batch];
+    pending.remaining = pendingPorts.size();
+    for (const QSerialPortInfo &port : pendingPorts) {
+        DiscoveryResult placeholder;
+        placeholder.portName = port.portName();
+        placeholder.identity = portIdentity(port);
+        pending.results.append(placeholder);
+    }
+
+    if (pendingPorts.isEmpty()) {
+        // Nada que sondear, pero finished llega igual y fuera de esta llamada, como con cualquier otro lote
+        batches.erase(batch);
+        QMetaObject::invokeMethod(this, [this, batch]() { emit finished(batch, QList<DiscoveryResult>()); }, Qt::QueuedConnection);
+        return batch;
+    }
+
+    // Un hilo por puerto: lo que más tarda es abrir el puerto y el timeout de los que no contestan, y así se solapan
+    for (int index = 0; index < pendingPorts.size(); ++index) {
+        QString portName = pendingPorts[index].portName();
+        QString identity = portIdentity(pendingPorts[index]);
+        probing.append(portName);
+        shared_ptr<atomic<bool>> done = make_shared<atomic<bool>>(false);
+
+        Probe launched;
+        launched.done = done;
+        launched.worker = std::thread([this, batch, index, portName, identity, done]() {
+            DiscoveryResult result = probe(portName, identity);
+            QMetaObject::invokeMethod(this, [this, batch, index, result]() { collect(batch, index, result); }, Qt::QueuedConnection);
+            done->store(true);
+        });
+        probes.push_back(move(launched));
+    }
+    return batch;
+}
+
+DiscoveryResult PortDiscovery::probe(const QString &portName, const QString &identity) {
+    DiscoveryResult result;
+    result.portName = portName;
+    result.identity = identity;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Puerto propio de este hilo y en modo bloqueante, igual que el del hilo serie
+    QSerialPort port;
+    SerialManager::configurePort(port, portName);
+    if (!port.open(QIODevice::ReadWrite)) {
+        result.elapsedMs = static_cast<int>(timer.elapsed()); // Ocupado por otro programa o sin permisos, no se puede saber
+        return result;
+    }
+    result.opened = true;
+    port.clear(); // Lo que hubiera en los buffers del sistema no es respuesta a nuestra petición
+
+    // La lectura del MCK es la más barata que siempre contesta cualquier EOLE, y no cambia nada en el sensor
+    port.write(reinterpret_cast<const char*>(ReadFrame<MCK_ADDRESS>::data()), ReadFrame<MCK_ADDRESS>::size());
+
+    QElapsedTimer wait; // El timeout cuenta desde la petición, abrir el puerto puede tardar bastante más en algunos adaptadores
+    wait.start();
+    QByteArray received;
+    while (true) {
+        // Lo que queda se calcula una sola vez: con 0 o menos (-1) waitForReadyRead esperaría para siempre a un puerto callado
+        qint64 remaining = DISCOVERY_TIMEOUT - wait.elapsed();
+        if (remaining <= 0 || !port.waitForReadyRead(static_cast<int>(remaining))) break;
+        received.append(port.readAll());
+
+        // Con resync: un dispositivo que no es un EOLE puede mandar cualquier cosa, solo vale una trama con CRC correcto
+        size_t frameStart = 0, consumed = 0;
+        const uint8_t *bytes = reinterpret_cast<const uint8_t*>(received.constData());
+        if (findResponseFrame(bytes, received.size(), true, frameStart, consumed) == SEARCH_FRAME_OK) {
+            uint32_t value = 0;
+            result.answered = true; // NOTOK también es un EOLE, aunque no quiera darnos el MCK
+            if (decodeResponse(bytes + frameStart, value) == DECODE_OK) result.mck = value;
+            break;
+        }
+        received.remove(0, static_cast<int>(consumed));
+    }
+    port.close();
+
+    result.elapsedMs = static_cast<int>(timer.elapsed());
+    return result;
+}
+
+void PortDiscovery::collect(int batch, int index, const DiscoveryResult &result) {
+    probing.removeAll(result.portName);
+    storeResult(result);
+    emit portProbed(result);
+
+    auto pending = batches.find(batch);
+    if (pending == batches.end()) return;
+    pending->second.results[index] = result;
+    if (--pending->second.remaining > 0) return;
+
+    QList<DiscoveryResult> results = pending->second.results;
+    batches.erase(pending);
+    emit finished(batch, results);
+}
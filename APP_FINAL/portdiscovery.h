@@ -0,0 +1,72 @@
+#ifndef PORTDISCOVERY_H
+#define PORTDISCOVERY_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QStringList>
+#include <QSerialPortInfo>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Busca sensores entre los puertos serie: a cada candidato se le manda una lectura del MCK (0x028), a todos a la vez y cada uno
+// desde su propio hilo con un timeout corto (DISCOVERY_TIMEOUT), y solo cuentan los que contestan como un EOLE
+// Los puertos USB se filtran antes por VID o VID:PID (DISCOVERY_USB_IDS_VARIABLE) para no mandar nada a módems, Bluetooth, etc.
+// El resultado de cada puerto se guarda en QSettings con la identidad del dispositivo, así al arrancar otra vez no hace falta sondearlo
+
+struct DiscoveryResult { // Resultado del sondeo de un puerto
+    QString portName;       // Nombre del puerto (el de QSerialPortInfo)
+    QString identity;       // VID:PID:número de serie (vacío si no es USB), para saber si en la caché sigue el mismo dispositivo
+    bool opened = false;    // Se pudo abrir (si no, no se sabe nada del puerto y no se guarda en la caché)
+    bool answered = false;  // Contestó con una respuesta EOLE (OK o NOTOK, con CRC correcto)
+    uint32_t mck = 0;       // Valor del MCK leído (solo si contestó OK)
+    int elapsedMs = 0;      // Lo que tardó el sondeo, desde abrir el puerto hasta la respuesta o el timeout
+    bool fromCache = false; // Sale de la caché, no se ha sondeado ahora
+};
+
+class PortDiscovery : public QObject {
+    Q_OBJECT
+
+public:
+    explicit PortDiscovery(QObject *parent = nullptr); // Constructor, lee el filtro de VID/PID
+    ~PortDiscovery(); // Destructor, espera a los sondeos en curso (como mucho lo que tarde en abrirse un puerto y DISCOVERY_TIMEOUT)
+
+    bool isCandidate(const QSerialPortInfo &port) const; // Pasa el filtro de VID/PID (los puertos que no son USB siempre pasan)
+    bool cachedResult(const QSerialPortInfo &port, DiscoveryResult &result) const; // Resultado guardado si el dispositivo es el mismo
+    int discover(const QList<QSerialPortInfo> &ports); // Sondea todos a la vez (menos los que ya se están sondeando), devuelve el lote de finished
+
+signals:
+    void portProbed(const DiscoveryResult &result); // Un puerto ya sondeado, según van terminando (siempre en el hilo de la UI)
+    void finished(int batch, const QList<DiscoveryResult> &results); // Todo el lote sondeado, en el orden en que se pidió
+
+private:
+    static DiscoveryResult probe(const QString &portName, const QString &identity); // Sondeo de un puerto, desde su propio hilo
+    static QString portIdentity(const QSerialPortInfo &port); // VID:PID:número de serie
+    void collect(int batch, int index, const DiscoveryResult &result); // Recoge en el hilo de la UI el resultado de un sondeo
+    void storeResult(const DiscoveryResult &result); // Guarda el resultado en la caché
+    void joinFinished(); // Recoge los hilos de los sondeos que ya terminaron
+
+    struct Probe { // Hilo de un sondeo
+        std::thread worker; // std:: porque QObject ya tiene un thread()
+        shared_ptr<atomic<bool>> done; // Lo marca el hilo al terminar, para recogerlo sin bloquear
+    };
+
+    struct Batch { // Lote de puertos de una llamada a discover
+        QList<DiscoveryResult> results;
+        int remaining; // Sondeos que faltan
+    };
+
+    vector<Probe> probes; // Sondeos lanzados, se recogen al lanzar los siguientes y en el destructor
+    map<int, Batch> batches; // Lotes que aún esperan algún sondeo
+    int nextBatch; // Número del siguiente lote
+    QStringList probing; // Puertos con un sondeo en curso, no se abren dos veces a la vez (kernel y udev avisan los dos al conectar)
+    vector<pair<int, int>> allowedIds; // VID y PID permitidos (PID -1 = cualquiera de ese fabricante), vacío = todos
+};
+
+#endif // PORTDISCOVERY_H
@@ -0,0 +1,76 @@
+#include "qserialtransport.h"
+
+using namespace std;
+
+QSerialTransport::QSerialTransport() {
+    // Qt avisa en cuanto el sistema da el dispositivo por perdido (también con el puerto en reposo), sin tener que preguntar
+    QObject::connect(&serial, &QSerialPort::errorOccurred, [this](QSerialPort::SerialPortError error) {
+        if (!serial.isOpen() || !linkLost) return;
+        if (error == QSerialPort::ResourceError || error == QSerialPort::DeviceNotFoundError || error == QSerialPort::PermissionError) {
+            linkLost(serial.errorString().toStdString());
+        }
+    });
+}
+
+QSerialTransport::~QSerialTransport() {
+    close();
+}
+
+void QSerialTransport::configure(QSerialPort &port, const QString &portName) {
+    // Esta es toda la configuración necesaria para el puerto según manual (también la usa la búsqueda de sensores)
+    port.setPortName(portName); // Que coincida el nombre que aparece en la lista con el que le asignamos al puerto
+    port.setBaudRate(QSerialPort::Baud115200); // Velocidad a la que trasnmiten los datos en bits por segundo (115200)
+    port.setDataBits(QSerialPort::Data8); // Bits de datos por trama (9)
+    port.setParity(QSerialPort::NoParity); // No hay paridad, no manda el bit adicional en los paquetes
+    port.setStopBits(QSerialPort::OneStop); // 1 bit de parada al final de los datos trasmitidos
+    port.setFlowControl(QSerialPort::NoFlowControl); // Sin controlo de flujo, no se satura el buffer
+}
+
+bool QSerialTransport::open(const string &name) {
+    close();
+    configure(serial, QString::fromStdString(name));
+
+    // Necesitamos poder hacer operaciones de lectura y escritura
+    return serial.open(QIODevice::ReadWrite);
+}
+
+void QSerialTransport::close() {
+    if (serial.isOpen()) serial.close();
+}
+
+bool QSerialTransport::isOpen() const {
+    return serial.isOpen();
+}
+
+bool QSerialTransport::isHealthy() const {
+    // Si salta un error o deja de poder ser R/W (siempre lo es en el sensor) es que se ha desconectado
+    return serial.isOpen() && serial.isWritable() && serial.isReadable() && serial.error() != QSerialPort::ResourceError;
+}
+
+bool QSerialTransport::write(const uint8_t *data, size_t size, int timeoutMs) {
+    if (serial.write(reinterpret_cast<const char*>(data), static_cast<qint64>(size)) == -1) return false;
+    return serial.waitForBytesWritten(timeoutMs);
+}
+
+int QSerialTransport::writeSome(const uint8_t *data, size_t size) {
+    // QSerialPort se queda con todo en su buffer y lo va sacando él
+    return static_cast<int>(serial.write(reinterpret_cast<const char*>(data), static_cast<qint64>(size)));
+}
+
+int QSerialTransport::read(uint8_t *buffer, size_t size, int timeoutMs) {
+    if (!serial.isOpen()) return -1;
+    if (serial.bytesAvailable() == 0 && timeoutMs > 0 && !serial.waitForReadyRead(timeoutMs)) return 0;
+    return static_cast<int>(serial.read(reinterpret_cast<char*>(buffer), static_cast<qint64>(size)));
+}
+
+int QSerialTransport::pollFd() const {
+#ifdef Q_OS_UNIX
+    return serial.isOpen() ? static_cast<int>(serial.handle()) : -1;
+#else
+    return -1;
+#endif
+}
+
+string QSerialTransport::errorString() const {
+    return serial.errorString().toStdString();
+}
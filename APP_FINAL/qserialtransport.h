@@ -0,0 +1,34 @@
+#ifndef QSERIALTRANSPORT_H
+#define QSERIALTRANSPORT_H
+
+// Transporte con QSerialPort, el de siempre y el único en Windows
+// Solo desde el hilo que lo creó (el hilo serie o el hilo de una búsqueda de sensores)
+
+#include <QtSerialPort/QSerialPort>
+#include <QString>
+#include "transport.h"
+
+using namespace std;
+
+class QSerialTransport : public Transport {
+public:
+    QSerialTransport(); // Constructor
+    ~QSerialTransport(); // Destructor, cierra el puerto si sigue abierto
+
+    static void configure(QSerialPort &port, const QString &portName); // Configuración del manual (115200 8N1, sin control de flujo), sin abrirlo
+
+    bool open(const string &name) override;
+    void close() override;
+    bool isOpen() const override;
+    bool isHealthy() const override;
+    bool write(const uint8_t *data, size_t size, int timeoutMs) override;
+    int writeSome(const uint8_t *data, size_t size) override;
+    int read(uint8_t *buffer, size_t size, int timeoutMs) override;
+    int pollFd() const override; // El descriptor del QSerialPort (solo en Unix), para esperar; leer sigue yendo por el QSerialPort
+    string errorString() const override;
+
+private:
+    QSerialPort serial; // Puerto serie
+};
+
+#endif // QSERIALTRANSPORT_H
@@ -0,0 +1,30 @@
+#include "readframes.h"
+
+using namespace std;
+
+ReadFrameCache::ReadFrameCache() : nextSlot(0) {
+}
+
+const uint8_t *ReadFrameCache::lookup(int address) {
+    // Los registros de siempre no pasan ni por la caché
+    switch (address) {
+    case INT_TIME_ADDRESS: return ReadFrame<INT_TIME_ADDRESS>::data();
+    case INT_PERIOD_ADDRESS: return ReadFrame<INT_PERIOD_ADDRESS>::data();
+    case GPOL_ADDRESS: return ReadFrame<GPOL_ADDRESS>::data();
+    case MCK_ADDRESS: return ReadFrame<MCK_ADDRESS>::data();
+    case OUTPUT_ADDRESS: return ReadFrame<OUTPUT_ADDRESS>::data();
+    default: break;
+    }
+
+    // Son pocas entradas, una búsqueda lineal es lo más rápido
+    for (const Entry &entry : entries) {
+        if (entry.address == address) return entry.request.data();
+    }
+
+    // No estaba: se codifica una vez y sustituye a la entrada más antigua
+    Entry &entry = entries[nextSlot];
+    entry.address = address;
+    entry.request = ReadRequest(static_cast<uint32_t>(address));
+    nextSlot = (nextSlot + 1) % entries.size();
+    return entry.request.data();
+}
@@ -0,0 +1,63 @@
+#ifndef READFRAMES_H
+#define READFRAMES_H
+
+#include <array>
+#include <cstdint>
+#include "packetcodec.h"
+#include "values.h"
+
+// Peticiones ya codificadas para los registros de siempre: se construyen al compilar y se envían desde memoria estática
+// Para direcciones custom hay una caché pequeña que evita volver a calcular el CRC cada vez que se lee el mismo registro
+
+using namespace std;
+
+template <uint32_t Address>
+struct ReadFrame { // Petición de lectura de Address, entera en tiempo de compilación
+    static constexpr ReadRequest request = ReadRequest(Address);
+    static constexpr const uint8_t *data() { return request.data(); }
+    static constexpr size_t size() { return READ_REQUEST_SIZE; }
+    static constexpr uint16_t crc() { return static_cast<uint16_t>((request.bytes[6] << 8) | request.bytes[7]); }
+};
+
+template <uint32_t Address, uint32_t Value>
+struct WriteFrame { // Petición de escritura de Value en Address, entera en tiempo de compilación
+    static constexpr WriteRequest request = WriteRequest(Address, Value);
+    static constexpr const uint8_t *data() { return request.data(); }
+    static constexpr size_t size() { return WRITE_REQUEST_SIZE; }
+    static constexpr uint16_t crc() { return static_cast<uint16_t>((request.bytes[10] << 8) | request.bytes[11]); }
+};
+
+// CRCs apuntados a mano en test.cpp, si el codec cambia y deja de cuadrar no compila
+static_assert(ReadFrame<INT_TIME_ADDRESS>::crc() == 0x6CCF, "Lectura de TINT: se esperaba 0x6C 0xCF");
+static_assert(ReadFrame<INT_PERIOD_ADDRESS>::crc() == 0x69CF, "Lectura de TFRAME: se esperaba 0x69 0xCF");
+static_assert(ReadFrame<GPOL_ADDRESS>::crc() == 0xAACE, "Lectura de GPOL: se esperaba 0xAA 0xCE");
+static_assert(WriteFrame<INT_TIME_ADDRESS, 0x2B2A0>::crc() == 0x4140, "Escritura de TINT: se esperaba 0x41 0x40");
+static_assert(WriteFrame<INT_TIME_ADDRESS, 0x1E6B8>::crc() == 0x8B8E, "Escritura de TINT: se esperaba 0x8B 0x8E");
+static_assert(WriteFrame<INT_PERIOD_ADDRESS, 0x3BD08>::crc() == 0xCE05, "Escritura de TFRAME: se esperaba 0xCE 0x05");
+static_assert(WriteFrame<INT_PERIOD_ADDRESS, 0x34616>::crc() == 0xF6C6, "Escritura de TFRAME: se esperaba 0xF6 0xC6");
+static_assert(WriteFrame<GPOL_ADDRESS, 0x708>::crc() == 0x6E77, "Escritura de GPOL: se esperaba 0x6E 0x77");
+static_assert(WriteFrame<GPOL_ADDRESS, 0x852>::crc() == 0xA5F2, "Escritura de GPOL: se esperaba 0xA5 0xF2");
+
+// Estos no están en test.cpp: calculados con el mismo algoritmo, solo sirven para notar si el codec cambia
+static_assert(ReadFrame<MCK_ADDRESS>::crc() == 0xD8CE, "Lectura de MCK: se esperaba 0xD8 0xCE");
+static_assert(ReadFrame<OUTPUT_ADDRESS>::crc() == 0x72CF, "Lectura de OUTPUT: se esperaba 0x72 0xCF");
+
+class ReadFrameCache { // Devuelve los bytes de la petición de lectura de cualquier dirección sin codificarla cada vez
+public:
+    ReadFrameCache(); // Constructor
+
+    // Registros conocidos: memoria estática. Custom: entrada de la caché, válida hasta la siguiente llamada a lookup
+    // No es thread-safe, cada hilo que envíe peticiones tiene la suya (el SerialWorker)
+    const uint8_t *lookup(int address);
+
+private:
+    struct Entry {
+        int address = -1;    // Dirección de la petición guardada (-1 = hueco libre)
+        ReadRequest request; // Petición ya codificada
+    };
+
+    array<Entry, READ_FRAME_CACHE_SIZE> entries; // Peticiones custom guardadas
+    size_t nextSlot;                             // Hueco que se reemplaza en el siguiente fallo (por turnos)
+};
+
+#endif // READFRAMES_H
@@ -0,0 +1,51 @@
+#include "registercache.h"
+
+using namespace std;
+
+RegisterCache::RegisterCache() : currentGeneration(1) {
+    clock.start();
+}
+
+void RegisterCache::setPolicy(int address, CACHEPOLICY policy, qint64 maxAgeMs) {
+    policies[address].policy = policy;
+    policies[address].maxAgeMs = maxAgeMs;
+}
+
+bool RegisterCache::lookup(int address, uint32_t& value) const {
+    auto policy = policies.find(address);
+    if (policy == policies.end() || policy->second.policy == CACHE_NEVER) return false;
+
+    auto entry = entries.find(address);
+    if (entry == entries.end() || entry->second.generation != currentGeneration) return false;
+
+    // Con antigüedad máxima, pasado ese tiempo hay que volver al cable
+    if (policy->second.policy == CACHE_MAX_AGE && clock.elapsed() - entry->second.timestamp > policy->second.maxAgeMs) {
+        return false;
+    }
+
+    value = entry->second.value;
+    return true;
+}
+
+void RegisterCache::store(int address, uint32_t value, uint64_t generation) {
+    // Una respuesta pedida antes de invalidar todo no puede colarse en la generación nueva
+    if (generation != currentGeneration) return;
+
+    CachedRegister &entry = entries[address];
+    entry.value = value;
+    entry.generation = generation;
+    entry.timestamp = clock.elapsed();
+}
+
+void RegisterCache::invalidate(int address) {
+    entries.erase(address);
+}
+
+void RegisterCache::invalidateAll() {
+    entries.clear();
+    ++currentGeneration;
+}
+
+uint64_t RegisterCache::generation() const {
+    return currentGeneration;
+}
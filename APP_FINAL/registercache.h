@@ -0,0 +1,48 @@
+#ifndef REGISTERCACHE_H
+#define REGISTERCACHE_H
+
+#include <QElapsedTimer>
+#include <map>
+#include <cstdint>
+
+// Copia local (shadow) de los registros del sensor, para no volver a leer del cable lo que casi nunca cambia
+// Solo se usa desde el hilo de la UI (los callbacks del manejador llegan ahí), así que no necesita mutex
+
+using namespace std;
+
+enum CACHEPOLICY { // Cuánto se puede fiar uno de un valor guardado
+    CACHE_NEVER = 0,             // Siempre al cable (registros desconocidos, pueden cambiar solos)
+    CACHE_UNTIL_INVALIDATED = 1, // Vale hasta que se invalide (registros de configuración fija: MCK, OUTPUT)
+    CACHE_MAX_AGE = 2            // Vale durante un tiempo máximo desde que se leyó o escribió
+};
+
+struct CachedRegister { // Entrada de la caché
+    uint32_t value = 0;      // Último valor conocido
+    uint64_t generation = 0; // Generación en la que se guardó, si no coincide con la actual está obsoleta
+    qint64 timestamp = 0;    // Momento en que se guardó (ms desde que se creó la caché)
+};
+
+class RegisterCache {
+public:
+    RegisterCache(); // Constructor
+
+    void setPolicy(int address, CACHEPOLICY policy, qint64 maxAgeMs = 0); // Política de un registro (por defecto CACHE_NEVER)
+    bool lookup(int address, uint32_t& value) const; // Devuelve true y el valor si hay una copia válida
+    void store(int address, uint32_t value, uint64_t generation); // Guarda un valor leído o escrito si su generación sigue vigente
+    void invalidate(int address); // Olvida un registro (por ejemplo tras una escritura fallida, no sabemos qué valor tiene)
+    void invalidateAll(); // Olvida todo empezando una generación nueva (cambio de puerto o de sensor)
+    uint64_t generation() const; // Generación actual, se apunta al pedir una lectura para descartarla si llega tarde
+
+private:
+    struct RegisterPolicy {
+        CACHEPOLICY policy = CACHE_NEVER;
+        qint64 maxAgeMs = 0;
+    };
+
+    map<int, CachedRegister> entries;  // Valores guardados por dirección
+    map<int, RegisterPolicy> policies; // Política de cada dirección
+    uint64_t currentGeneration;        // Se incrementa en cada invalidateAll
+    QElapsedTimer clock;               // Reloj monotónico para la antigüedad de las entradas
+};
+
+#endif // REGISTERCACHE_H
@@ -0,0 +1,86 @@
+#include "registerrules.h"
+#include "values.h"
+#include <QRandomGenerator>
+
+using namespace std;
+
+REGISTERCHECK checkRegisterValue(int address, uint32_t value) {
+    if ((address == INT_TIME_ADDRESS || address == INT_PERIOD_ADDRESS) && value < ONE) return REGISTER_BELOW_ONE;
+    if (address == GPOL_ADDRESS && (value < GPOL_MIN_VOLTAGE || value > GPOL_MAX_VOLTAGE)) return REGISTER_GPOL_RANGE;
+    return REGISTER_VALID;
+}
+
+REGISTERCHECK checkPeriod(uint32_t period, uint32_t intTime) {
+    // Que nunca supere el TFrame al TInt, se descalibra
+    return period < intTime ? REGISTER_PERIOD_SHORT : REGISTER_VALID;
+}
+
+bool isFactoryRegister(int address) {
+    return address == MCK_ADDRESS || address == OUTPUT_ADDRESS;
+}
+
+const char *registerCheckMessage(REGISTERCHECK check) {
+    switch (check) {
+    case REGISTER_BELOW_ONE:    return "Value must be equal or greater than 1.";
+    case REGISTER_GPOL_RANGE:   return "GPOL value must be between 1500 mV and 3600 mV.";
+    case REGISTER_PERIOD_SHORT: return "INT_PERIOD can't be less than INT_TIME.";
+    case REGISTER_FACTORY:      return "MCK and OUTPUT hold the factory clock and output setup, they are not written from here.";
+    default:                    return "";
+    }
+}
+
+static int decodeMckDiv(uint8_t mckDIVbits) {
+    // Decodificamos los bits del MCK
+    switch (mckDIVbits) {
+    case ZERO: return FIRST; // 00
+    case ONE: return SECOND; // 01
+    case TWO: return THIRD; // 10
+    default: return FIRST;
+    }
+}
+
+static int decodeResolution(uint8_t resBits) {
+    // Calculamos resolución máxima
+    switch (resBits) {
+    case ZERO: return FIRSTRES; // 00
+    case ONE: return SECONDRES; // 01
+    case TWO: return THIRDRES; // 10
+    default: {
+            // Random, no debería ocurrir nunca este caso si está correctamente configurada de fábrica
+            int options[] = { FIRSTRES, SECONDRES, THIRDRES };
+            return options[QRandomGenerator::global()->bounded(3)];
+        }
+    }
+}
+
+void decodeMckRegister(uint32_t value, SensorClock &clock) {
+    // Necesitamos los 2 primeros bytes
+    value = value & 0xFFFF;
+
+    clock.externalClock = (value & 0x01) == ONE; // Primer bit, placeholder: no vendrá así configurado y se calcula igual con CLK
+    int mckDIV = decodeMckDiv((value >> 4) & 0x03); // Bits 4 y 5
+    int xclkDIV = (value >> 8) & 0xFF; // Segundo byte entero
+
+    float XClk = (CLK * E6) * OPERATION / xclkDIV;
+    clock.mck = XClk / mckDIV;
+}
+
+void decodeOutputRegister(uint32_t value, SensorClock &clock) {
+    value = value & 0xFFFF; // 2 primeros bytes
+
+    clock.pixels = decodeResolution((value >> 6) & 0x03); // Bytes 6 y 7
+    clock.outputs = ((value >> 5) & 0x01) ? FOUR_VIDEO_OUTPUTS : TWO_VIDEO_OUTPUTS; // Bit 5
+
+    // Forzar a que sean 4 a modo de placeholder para evitar fallos
+    // Debería tener 4 en el registro sin embargo salen 2, a pesar que la imagen se muestra para 4 con datos de 4...
+    clock.outputs = FOUR_VIDEO_OUTPUTS;
+}
+
+double minimumFrameTime(uint32_t intTime, const SensorClock &clock) {
+    // Operaciones sacadas del manual, hay que hacer cambios de unidades en alguna
+    return (intTime / clock.mck) + (clock.pixels / (clock.mck * clock.outputs));
+}
+
+uint32_t minimumPeriodValue(double frameTime, const SensorClock &clock) {
+    return static_cast<uint32_t>((frameTime * clock.mck) + ONE);
+}
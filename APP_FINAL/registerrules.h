@@ -0,0 +1,40 @@
+#ifndef REGISTERRULES_H
+#define REGISTERRULES_H
+
+#include <cstdint>
+
+// Reglas de los registros del sensor que comparten la ventana principal y el modo flota, para que una escritura a todos los
+// dispositivos pase por las mismas comprobaciones que una a uno solo:
+// rangos de TINT, TFRAME y GPOL, TFRAME nunca por debajo de TINT, MCK y OUTPUT sin tocar, y el TFRAME mínimo tras cambiar TINT
+
+using namespace std;
+
+#define GPOL_MIN_VOLTAGE 1500 // GPOL mínimo (mV)
+#define GPOL_MAX_VOLTAGE 3600 // GPOL máximo (mV)
+
+enum REGISTERCHECK { // Resultado de comprobar un valor de un registro
+    REGISTER_VALID = 0,        // Se puede escribir (o mostrar)
+    REGISTER_BELOW_ONE = 1,    // TINT o TFRAME a 0
+    REGISTER_GPOL_RANGE = 2,   // GPOL fuera de rango
+    REGISTER_PERIOD_SHORT = 3, // TFRAME por debajo de TINT, el sensor se descalibra
+    REGISTER_FACTORY = 4       // MCK u OUTPUT, configuración de fábrica de la que salen los cálculos
+};
+
+struct SensorClock { // Lo que sale de los registros MCK y OUTPUT para calcular el TFRAME mínimo
+    double mck = 0;   // Reloj interno (Hz)
+    int pixels = 0;   // Resolución (alto * ancho)
+    int outputs = 0;  // Salidas de vídeo
+    bool externalClock = false; // El MCK pide reloj externo (no debería venir así de fábrica, se calcula igual con CLK)
+};
+
+REGISTERCHECK checkRegisterValue(int address, uint32_t value); // Rangos de TINT, TFRAME y GPOL (cualquier otro vale)
+REGISTERCHECK checkPeriod(uint32_t period, uint32_t intTime); // TFRAME frente al TINT que tiene el sensor
+bool isFactoryRegister(int address); // MCK u OUTPUT
+const char *registerCheckMessage(REGISTERCHECK check); // Mensaje para el usuario
+
+void decodeMckRegister(uint32_t value, SensorClock &clock); // Decodifica el registro del MCK (reloj y si pide reloj externo)
+void decodeOutputRegister(uint32_t value, SensorClock &clock); // Decodifica el registro de los outputs (resolución y número de salidas)
+double minimumFrameTime(uint32_t intTime, const SensorClock &clock); // TFRAME mínimo (s) para un TINT, el de más FPS
+uint32_t minimumPeriodValue(double frameTime, const SensorClock &clock); // Valor del registro TFRAME para ese tiempo
+
+#endif // REGISTERRULES_H
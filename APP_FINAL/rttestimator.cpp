@@ -0,0 +1,47 @@
+#include "rttestimator.h"
+#include "values.h"
+#include <cmath>
+
+using namespace std;
+
+RttEstimator::RttEstimator() {
+    reset();
+}
+
+void RttEstimator::reset() {
+    measured = false;
+    srtt = 0.0;
+    rttvar = 0.0;
+    currentTimeout = RESPONSE_TIMEOUT; // Hasta la primera respuesta no sabemos nada del enlace
+}
+
+void RttEstimator::sample(double roundTripMs) {
+    if (!measured) {
+        srtt = roundTripMs;
+        rttvar = roundTripMs / 2.0;
+        measured = true;
+    } else {
+        // Las ganancias de la RFC (1/4 para la variación, 1/8 para la media), la variación se actualiza con la media anterior
+        rttvar = 0.75 * rttvar + 0.25 * fabs(srtt - roundTripMs);
+        srtt = 0.875 * srtt + 0.125 * roundTripMs;
+    }
+
+    double timeoutMs = ceil(srtt + 4.0 * rttvar);
+    currentTimeout = static_cast<int>(min(max(timeoutMs, static_cast<double>(RTT_MIN_TIMEOUT)), static_cast<double>(RESPONSE_TIMEOUT)));
+}
+
+void RttEstimator::backoff() {
+    currentTimeout = min(currentTimeout * 2, RESPONSE_TIMEOUT);
+}
+
+int RttEstimator::timeout() const {
+    return currentTimeout;
+}
+
+double RttEstimator::smoothed() const {
+    return srtt;
+}
+
+double RttEstimator::variation() const {
+    return rttvar;
+}
@@ -0,0 +1,31 @@
+#ifndef RTTESTIMATOR_H
+#define RTTESTIMATOR_H
+
+// Estimador de la ida y vuelta de un puerto, como el de TCP (RFC 6298): media suavizada y variación de las muestras
+// El timeout de cada respuesta sale de ahí (media + 4 variaciones) en lugar de esperar siempre RESPONSE_TIMEOUT:
+// con un sensor sano (~1 ms) un enlace muerto se nota en RTT_MIN_TIMEOUT, y un enlace lento sube el timeout solo
+// Sin Qt y sin bloqueos, cada puerto tiene el suyo y solo lo usa el hilo que tiene el puerto
+
+#include <algorithm>
+
+using namespace std;
+
+class RttEstimator {
+public:
+    RttEstimator(); // Constructor, sin muestras (timeout RESPONSE_TIMEOUT)
+
+    void reset(); // Olvidar lo medido (otro puerto puede ser otro sensor u otro adaptador)
+    void sample(double roundTripMs); // Nueva medida, solo de transacciones sin reintentos (con reintentos no se sabe a cuál contestó)
+    void backoff(); // Timeout sin respuesta: se dobla el timeout hasta la siguiente medida buena
+    int timeout() const; // Timeout actual para una respuesta (ms)
+    double smoothed() const; // Media suavizada (ms, 0 sin muestras)
+    double variation() const; // Variación suavizada (ms, 0 sin muestras)
+
+private:
+    bool measured;      // Ya hay al menos una muestra
+    double srtt;        // Media suavizada
+    double rttvar;      // Variación suavizada
+    int currentTimeout; // Timeout en vigor (ms), entre RTT_MIN_TIMEOUT y RESPONSE_TIMEOUT
+};
+
+#endif // RTTESTIMATOR_H
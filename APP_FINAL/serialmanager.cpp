@@ -1,54 +1,114 @@
 #include "serialmanager.h"
 #include "values.h"
+#include "crc16.h"
+#include "tracing.h"
+#include "metrics.h"
+#include "logging.h"
+#include "qserialtransport.h"
+#include "readframes.h"
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QDir>
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <cstring>
 
 using namespace std;
 
-SerialManager::SerialManager() {
-    // El objeto QSerialPort ya está creado y persistente
+SerialManager::SerialManager() : rxLength(0), firstByteNs(0), lowLatency(qgetenv(LOW_LATENCY_VARIABLE) == "1"), timeoutMetric(nullptr) {
+    // El transporte se crea al abrir, según el nombre del puerto
 }
 
 SerialManager::~SerialManager() {
     closePort();
 }
 
+void SerialManager::configurePort(QSerialPort& port, const QString& portName) {
+    QSerialTransport::configure(port, portName);
+}
+
+unique_ptr<Transport> SerialManager::createTransport(const QString& portName) {
+#ifdef __linux__
+    // Sockets y termios en crudo no necesitan el plugin de Qt, así los equipos sin interfaz pueden quitar Qt del camino de E/S
+    string name = portName.toStdString();
+    if (isPosixTransportName(name) || qgetenv(TRANSPORT_VARIABLE) == TRANSPORT_TERMIOS_BACKEND) {
+        return createPosixTransport(name);
+    }
+#endif
+    return unique_ptr<Transport>(new QSerialTransport);
+}
+
 bool SerialManager::openPort(const QString& portName) {
 
-    if (serial.isOpen()) {
+    if (transport && transport->isOpen()) {
         closePort(); // Si ya estaba abierto primero cerramos antes de reiniciar la conexión
     }
 
-    // Esta es toda la configuración necesaria para el puerto según manual
-    serial.setPortName(portName); // Que coincida el nombre que aparece en la lista con el que le asignamos al puerto
-    serial.setBaudRate(QSerialPort::Baud115200); // Velocidad a la que trasnmiten los datos en bits por segundo (115200)
-    serial.setDataBits(QSerialPort::Data8); // Bits de datos por trama (9)
-    serial.setParity(QSerialPort::NoParity); // No hay paridad, no manda el bit adicional en los paquetes
-    serial.setStopBits(QSerialPort::OneStop); // 1 bit de parada al final de los datos trasmitidos
-    serial.setFlowControl(QSerialPort::NoFlowControl); // Sin controlo de flujo, no se satura el buffer
+    rxLength = 0; // Los bytes pendientes del puerto anterior no valen para este
+    roundTrip.reset(); // Ni lo que se midió en él
+
+    // Cada transporte avisa a su manera cuando el dispositivo se pierde (también con el puerto en reposo)
+    transport = createTransport(portName);
+    transport->setLinkLostHandler([this](const string &reason) {
+        linkMetrics().portErrors.increment();
+        if (linkLost) linkLost(QString::fromStdString(reason));
+    });
 
     // Necesitamos poder hacer operaciones de lectura y escritura
-    if (!serial.open(QIODevice::ReadWrite)) {
-        cerr << "Error when trying to open port.";
+    if (!transport->open(portName.toStdString())) {
+        cerr << "Error when trying to open port: " << transport->errorString() << "\n";
+        linkMetrics().portErrors.increment();
+        transport.reset();
         return false;
     }
 
+    LinkMetrics &metrics = linkMetrics();
+    if (metrics.portOpens.get() > 0) metrics.reconnects.increment();
+    metrics.portOpens.increment();
+    metrics.portOpen.add(1);
+    timeoutMetric = &metrics.responseTimeout(portName.toStdString());
+    reportResponseTimeout();
+
     cout << "Port " << portName.toStdString() << " succesfully opened.\n";
+
+    // Una captura por conexión, con la hora de conexión en el nombre
+    if (!captureDirectory.isEmpty()) {
+        QString fileName = "EOLE_capture_" + QDateTime::currentDateTime().toString("yyyy-MM-dd_HH-mm-ss") + CAPTURE_EXTENSION;
+        capture.open(QDir(captureDirectory).filePath(fileName), portName);
+    }
+
+    if (lowLatency) {
+        enableLowLatency();
+    }
     return true;
 }
 
 void SerialManager::closePort() {
 
     // Cerrar el puerto si no se ha cerrado ya (por errores o desconexiones repentinas)
-    if (serial.isOpen()) {
-        serial.close();
+    if (transport && transport->isOpen()) {
+#ifdef __linux__
+        lowLatencyMode.restore(); // Antes de cerrar, que el descriptor sigue siendo el del puerto
+#endif
+        transport->close();
         cout << "Port succesfully closed.\n" << flush;
     }
+    if (timeoutMetric) {
+        // Solo lo que contó openPort, aunque el transporte ya se hubiera cerrado solo por un error
+        // La serie del puerto se queda en el registro, a 0 mientras no esté abierto
+        linkMetrics().portOpen.add(-1);
+        timeoutMetric->set(0);
+        timeoutMetric = nullptr;
+    }
+    capture.close();
+    rxLength = 0;
 }
 
 bool SerialManager::checkPortStatus() {
 
-    // Monitorizamos el puerto y si salta un error o deja de poder ser R/W (siempre lo es en el sensor) es que se ha desconectado
-    if (serial.isOpen() && (!serial.isWritable() || !serial.isReadable()|| serial.error() == QSerialPort::ResourceError)) {
+    // Monitorizamos el puerto y si el transporte ha dado un error irrecuperable es que se ha desconectado
+    if (transport && transport->isOpen() && !transport->isHealthy()) {
         return false;
     }
     return true;
@@ -56,86 +116,266 @@ bool SerialManager::checkPortStatus() {
 
 uint16_t SerialManager::crc16Modbus(const vector<uint8_t>& data) {
 
-    // Hay que quitar los 2 ultimos bytes, que seran el crc, para calcularlo bien sobre el resto de bytes
-    vector<uint8_t> dataWithoutDefaultCRC(data.begin(), data.end() - 2);
-
-    // Función para calcular el crc correcto según el paquete
-    uint16_t crc = 0xFFFF;
-    for (uint8_t byte : dataWithoutDefaultCRC) {
-        crc ^= byte;
-        for (int i = 0; i < 8; i++) {
-            if (crc & 0x0001) {
-                crc >>= 1;
-                crc ^= 0xA001;
-            } else {
-                crc >>= 1;
-            }
+    // Los 2 ultimos bytes seran el crc, se calcula sobre el resto sin copiar el paquete
+    if (data.size() < 2) return CRC16_INIT;
+    return crc16Compute(data.data(), data.size() - 2);
+}
+
+bool SerialManager::sanitizeResponse(const Response& response, int size) {
+    // readFrame ya entrega la trama alineada en la cabecera, aquí solo queda comprobar que llegó entera y con formato correcto
+    if (size != RESPONSE_PACKET_SIZE || !isResponseStart(response.data())) {
+        cerr << "Incorrect response format.\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool SerialManager::validateCRC(const Response& response) {
+
+    // Extraer los últimos dos bytes como el CRC recibido
+    uint8_t crcHigh = response.bytes[RESPONSE_PACKET_SIZE - 2];  // MSB
+    uint8_t crcLow = response.bytes[RESPONSE_PACKET_SIZE - 1];   // LSB
+    uint16_t receivedCRC = (crcHigh << 8) | crcLow;   // Formar el CRC recibido en Big Endian
+
+    // Calcular el CRC de los datos (sin los bytes CRC).
+    uint16_t calculatedCRC = packetCrc(response.data(), RESPONSE_PACKET_SIZE);
+
+    // Comparar el CRC calculado con el CRC recibido
+    if (calculatedCRC == receivedCRC) {
+        // Si el CRC es válido, imprimir los CRC calculado y recibido (solo con trazas, es cada respuesta)
+        TRACE_LOG(LOGCAT_PROTOCOL) << "CRC Calculated: 0x" << hex << calculatedCRC << ", CRC Received: 0x" << receivedCRC;
+        return true;  // CRC es válido
+    } else {
+        // Si el CRC no es válido, imprimir un mensaje de error.
+        WARNING_LOG(LOGCAT_PROTOCOL) << "CRC is not valid (calculated 0x" << hex << calculatedCRC << ", received 0x" << receivedCRC << ").";
+        linkMetrics().crcFailures.increment();
+        return false;  // CRC no válido
+    }
+}
+
+int64_t SerialManager::firstByteTime() const {
+    return firstByteNs;
+}
+
+void SerialManager::setLinkLostHandler(function<void(const QString&)> handler) {
+    linkLost = handler;
+}
+
+RttEstimator &SerialManager::rttEstimator() {
+    return roundTrip;
+}
+
+void SerialManager::reportResponseTimeout() {
+    if (timeoutMetric) timeoutMetric->set(roundTrip.timeout());
+}
+
+void SerialManager::setLowLatency(bool enabled) {
+    // Se aplica a partir de la siguiente conexión
+    lowLatency = enabled;
+}
+
+void SerialManager::enableLowLatency() {
+#ifdef __linux__
+    // Se mide con el puerto tal cual y después con los cambios, así el log dice si ha servido de algo con este adaptador
+    double before = measureRoundTrip();
+    if (!lowLatencyMode.apply(transport->pollFd(), RESPONSE_PACKET_SIZE)) {
+        INFO_LOG(LOGCAT_SERIAL) << "Low-latency mode is not available on this port.";
+        return;
+    }
+    double after = measureRoundTrip();
+
+    if (before < 0 || after < 0) {
+        INFO_LOG(LOGCAT_SERIAL) << "Low-latency mode on (" << lowLatencyMode.summary() << "), no response to measure the round trip.";
+        return;
+    }
+    INFO_LOG(LOGCAT_SERIAL) << "Low-latency mode on (" << lowLatencyMode.summary() << "), round trip " << fixed << setprecision(2)
+                            << before << " ms -> " << after << " ms.";
+#else
+    INFO_LOG(LOGCAT_SERIAL) << "Low-latency mode is only available on Linux.";
+#endif
+}
+
+double SerialManager::measureRoundTrip() {
+    // El MCK es configuración de fábrica, leerlo no cambia nada en el sensor
+    vector<double> samples;
+    for (int i = 0; i < LOW_LATENCY_RTT_SAMPLES; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        Response frame;
+        int frameSize = 0;
+        if (!sendData(ReadFrame<MCK_ADDRESS>::data(), ReadFrame<MCK_ADDRESS>::size()) ||
+            readFrame(RESPONSE_TIMEOUT, true, frame, frameSize) != FRAME_OK) {
+            return -1;
         }
+        samples.push_back(timer.nsecsElapsed() / 1e6);
     }
-    return crc;
+
+    sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
 }
 
-bool SerialManager::sendData(const vector<uint8_t>& dataReceived) {
+void SerialManager::setCaptureDirectory(const QString& directory) {
+    // Se aplica a partir de la siguiente conexión
+    captureDirectory = directory;
+    if (directory.isEmpty()) capture.close();
+}
 
-    // Recibe enteros (decimales)
-    if (!serial.isOpen()) {
+bool SerialManager::sendData(const uint8_t *data, size_t size) {
+
+    // El paquete ya viene codificado con su CRC, se escribe directamente desde el buffer de quien llama
+    if (!transport || !transport->isOpen()) {
         cerr << "Error: port is not open.\n";
         return false;
     }
 
-    // Calcular CRC16 en big endian
-    uint16_t crc = crc16Modbus(dataReceived);
-    vector<uint8_t> completeData = dataReceived;
+    // Imprimir los datos que se van a enviar, solo se formatean si el nivel debug está activo
+    DEBUG_LOG(LOGCAT_SERIAL) << "Sending data: " << HexBytes(data, size);
+
+    // Enviar datos, esperando a que salgan como mucho lo mismo que se esperaría la respuesta
+    if (!transport->write(data, size, roundTrip.timeout())) {
+        cerr << "Error when writing into serial port: " << transport->errorString() << "\n";
+        linkMetrics().portErrors.increment();
+        return false;
+    }
+    capture.record(CAPTURE_TX, data, size, traceNow());
 
-    completeData.push_back((crc >> 8) & 0xFF);  // MSB
-    completeData.push_back(crc & 0xFF);         // LSB
+    linkMetrics().bytesSent.increment(size);
+    return true;
+}
 
-    // Imprimir los datos que se van a enviar byte a byte
-    cout << "Sending data: ";
-    for (size_t i = 0; i < dataReceived.size(); ++i) {
-        cout << "0x" << hex << uppercase << (int)dataReceived[i] << " ";
+int SerialManager::receiveAvailable(int timeoutMs) {
+    // Leemos directamente al buffer fijo, sin QByteArray intermedios
+    if (rxLength >= RX_BUFFER_SIZE) return 0; // Lleno, extractFrame lo irá vaciando
+
+    int received = transport->read(rxBuffer.data() + rxLength, RX_BUFFER_SIZE - rxLength, timeoutMs);
+    if (received > 0) {
+        capture.record(CAPTURE_RX, rxBuffer.data() + rxLength, static_cast<size_t>(received), traceNow());
+        rxLength += received;
+        linkMetrics().bytesReceived.increment(static_cast<uint64_t>(received));
     }
-    cout << dec << endl;  // Regresar a formato decimal para el resto de los logs
+    return received;
+}
 
-    // Enviar datos
-    QByteArray dataToSend(reinterpret_cast<const char*>(dataReceived.data()), dataReceived.size());
-    if (serial.write(dataToSend) == -1) {
-        cerr << "Error when writing into serial port.\n";
-        return false;
+void SerialManager::consumeReceived(int count) {
+    // Lo que queda detrás se mueve al principio, son pocos bytes
+    if (count >= rxLength) {
+        rxLength = 0;
+        return;
     }
+    memmove(rxBuffer.data(), rxBuffer.data() + count, rxLength - count);
+    rxLength -= count;
+}
 
-    if (!serial.waitForBytesWritten(1000)) {
-        cerr << "Timeout when writing into serial port.\n";
-        return false;
+FRAMESTATUS SerialManager::extractFrame(bool resync, Response& frame) {
+
+    // La búsqueda (cabecera, CRC y resincronización) es la del codec, la misma que usan el benchmark y las herramientas offline
+    size_t frameStart = 0;
+    size_t consumed = 0;
+    FRAMESEARCH search = findResponseFrame(rxBuffer.data(), static_cast<size_t>(rxLength), resync, frameStart, consumed);
+    if (search != SEARCH_NEED_MORE) {
+        memcpy(frame.data(), rxBuffer.data() + frameStart, RESPONSE_PACKET_SIZE);
     }
+    consumeReceived(static_cast<int>(consumed));
 
-    return true;
+    // Lo que hubo que saltar delante de la trama (o todo lo consumido si no apareció ninguna) era basura
+    size_t discarded = (search == SEARCH_NEED_MORE) ? consumed : frameStart;
+    if (discarded > 0) {
+        linkMetrics().resyncs.increment();
+        linkMetrics().resyncBytes.increment(discarded);
+    }
+    if (search == SEARCH_BAD_CRC) linkMetrics().crcFailures.increment();
+
+    if (search == SEARCH_FRAME_OK) return FRAME_OK;
+    if (search == SEARCH_BAD_CRC) return FRAME_BAD_CRC;
+    return FRAME_TIMEOUT;
+}
+
+FRAMESTATUS SerialManager::readFrame(int timeoutMs, bool resync, Response& frame, int& frameSize) {
+    frameSize = 0;
+    firstByteNs = 0;
+
+    if (!transport || !transport->isOpen()) {
+        cerr << "Error: port is not open.\n";
+        return FRAME_TIMEOUT;
+    }
+
+    // Sabemos cuántos bytes tiene la respuesta, así que volvemos en cuanto llega una trama completa
+    QElapsedTimer timer;
+    timer.start();
+    receiveAvailable(); // Puede que ya estuviera todo en el buffer del puerto
+
+    while (true) {
+        if (firstByteNs == 0 && rxLength > 0) {
+            firstByteNs = traceNow(); // Si ya estaba en el buffer (ráfagas) cuenta desde que empezamos a esperarla
+        }
+
+        FRAMESTATUS status = extractFrame(resync, frame);
+        if (status != FRAME_TIMEOUT) {
+            frameSize = RESPONSE_PACKET_SIZE;
+            return status;
+        }
+
+        int remaining = timeoutMs - static_cast<int>(timer.elapsed());
+        if (remaining <= 0 || receiveAvailable(remaining) <= 0) {
+            if (rxLength == 0) {
+                cerr << "No response was received.\n";
+                linkMetrics().responseTimeouts.increment();
+                return FRAME_TIMEOUT;
+            }
+
+            // Trama incompleta (quedan menos bytes que una trama), devolvemos lo recibido para que se rechace al validarlo
+            frameSize = rxLength;
+            memcpy(frame.data(), rxBuffer.data(), rxLength);
+            rxLength = 0;
+            return FRAME_INCOMPLETE;
+        }
+    }
 }
 
-vector<uint8_t> SerialManager::readData() {
+void SerialManager::discardInput(int quietMs) {
+    // Tras un fallo con varias peticiones en vuelo, las respuestas que queden llegando ya no sabemos de quién son
+    rxLength = 0;
+    if (!transport || !transport->isOpen()) return;
+
+    while (receiveAvailable(quietMs) > 0) {
+        rxLength = 0;
+    }
+}
+
+vector<uint8_t> SerialManager::readData(int expectedSize) {
 
     // Variable auxiliar donde iremos guardando los datos
     vector<uint8_t> data;
 
-    if (!serial.isOpen()) {
+    // Modo por tramas: volvemos en cuanto llega una trama completa y válida, resincronizando si hay basura delante
+    // Todas las respuestas del EOLE tienen el mismo tamaño, así que cualquier expectedSize positivo espera una respuesta
+    if (expectedSize > 0) {
+        Response frame;
+        int frameSize = 0;
+        readFrame(roundTrip.timeout(), true, frame, frameSize);
+        data.assign(frame.bytes.begin(), frame.bytes.begin() + frameSize);
+        return data;
+    }
+
+    if (!transport || !transport->isOpen()) {
         cerr << "Error: port is not open.\n";
         return data;
     }
 
     // Timeout al segundo sin recibir respuesta
-    if (!serial.waitForReadyRead(1000)) {
+    if (rxLength == 0 && receiveAvailable(roundTrip.timeout()) <= 0) {
         cerr << "No response was received.\n";
         return data;
     }
 
     // Hay que darle un tiempo de espera para evitar que se corten paquetes
     // De esta forma no se reciben paquetes mas cortos cuyos bytes que faltan se añaden a otros paquetes que quedan mas largos
-    QByteArray responseData = serial.readAll();
-    while (serial.waitForReadyRead(100))
-        responseData += serial.readAll();
-
-    for (int i = 0; i < responseData.size(); ++i) {
-        data.push_back(static_cast<uint8_t>(responseData[i]));
+    data.assign(rxBuffer.begin(), rxBuffer.begin() + rxLength);
+    rxLength = 0;
+    while (receiveAvailable(100) > 0) {
+        data.insert(data.end(), rxBuffer.begin(), rxBuffer.begin() + rxLength);
+        rxLength = 0;
     }
 
     // Aqui van los casos de prueba
@@ -264,60 +504,12 @@ vector<uint8_t> SerialManager::readTestData(int readRegister) {
 
 // Los paquetes siguen una estructura predefinida y deben construirse byte a byte, siempre big endian
 
-vector<uint8_t> SerialManager::createWritePacket(int index, const vector<uint8_t>& data) {
-
-    vector<uint8_t> packet(WRITE_PACKET_SIZE, 0);  // Paquete de 12 bytes con ceros
-    packet[0] = HEADER;  // Header
-
-    // Command ID siempre 0x99 para escrituraa ver
-    packet[1] = WRITE_COMMAND_ID;
-
-    // Seleccionar la dirección correcta y expandirla a 4 bytes
-    uint32_t address = static_cast<uint32_t>(index);
-
-    // Direcciones en 4 bytes Big Endian
-    packet[2] = (address >> 24) & 0xFF;  // Siempre será 0x00
-    packet[3] = (address >> 16) & 0xFF;  // Siempre será 0x00
-    packet[4] = (address >> 8) & 0xFF;   // Byte alto real
-    packet[5] = address & 0xFF;          // Byte bajo real
-
-    // Leer los 4 bytes de `data` correctamente en Big Endian
-    packet[6] = data.size() > 0 ? data[0] : 0x00;
-    packet[7] = data.size() > 1 ? data[1] : 0x00;
-    packet[8] = data.size() > 2 ? data[2] : 0x00;
-    packet[9] = data.size() > 3 ? data[3] : 0x00;
-
-    // WRITE_REQUEST_PACKET.write_crc |= (crc >> 8) & 0xF | crc & 0xFF;
-    // WRITE_REQUEST_PACKET.write_crc = __builtinswap16(crc16Modbus(packet));
-
-    // Calcular CRC16 Big Endian
-    uint16_t crc = crc16Modbus(packet);
-    packet[10] = (crc >> 8) & 0xFF;  // MSB del CRC
-    packet[11] = crc & 0xFF;         // LSB del CRC
-
-    return packet;
+WriteRequest SerialManager::createWritePacket(int index, uint32_t value) {
+    // Cabecera, comando 0x99, dirección y datos en big endian y CRC, todo en un array fijo
+    return WriteRequest(static_cast<uint32_t>(index), value);
 }
 
-
-vector<uint8_t> SerialManager::createReadPacket(int index) {
-
-    vector<uint8_t> packet(READ_PACKET_SIZE, 0);  // Paquete de 8 bytes con ceros
-    packet[0] = HEADER;  // Header
-    packet[1] = READ_COMMAND_ID;  // Command ID siempre 0x90 para lectura
-
-    // Seleccionar la dirección correcta y expandirla a 4 bytes
-    uint32_t address = static_cast<uint32_t>(index);
-
-    // Direcciones en 4 bytes Big Endian
-    packet[2] = (address >> 24) & 0xFF;  // Siempre será 0x00
-    packet[3] = (address >> 16) & 0xFF;  // Siempre será 0x00
-    packet[4] = (address >> 8) & 0xFF;   // Byte alto real
-    packet[5] = address & 0xFF;          // Byte bajo real
-
-    // Calcular CRC16 Big Endian
-    uint16_t crc = crc16Modbus(packet);
-    packet[6] = (crc >> 8) & 0xFF;  // MSB del CRC
-    packet[7] = crc & 0xFF;         // LSB del CRC
-
-    return packet;
+ReadRequest SerialManager::createReadPacket(int index) {
+    // Cabecera, comando 0x90, dirección en big endian y CRC, todo en un array fijo
+    return ReadRequest(static_cast<uint32_t>(index));
 }
@@ -4,27 +4,76 @@
 #include <QtSerialPort/QSerialPort>
 #include <vector>
 #include <QString>
+#include <QByteArray>
 #include <cstdint>
+#include <array>
+#include <functional>
+#include <memory>
+#include "values.h"
+#include "packetcodec.h"
+#include "capturewriter.h"
+#include "transport.h"
+#include "lowlatency.h"
+#include "rttestimator.h"
 
 using namespace std;
 
+class MetricGauge;
+
+enum FRAMESTATUS { // Resultado de esperar una trama de respuesta
+    FRAME_OK = 0,         // Trama completa con HEADER, status y CRC válidos
+    FRAME_TIMEOUT = 1,    // No llegó nada
+    FRAME_INCOMPLETE = 2, // Llegaron bytes pero no llegaron a formar una trama
+    FRAME_BAD_CRC = 3     // Trama completa con CRC incorrecto (solo sin resincronización)
+};
+
 class SerialManager {
 public:
     SerialManager(); // Constructor
     ~SerialManager(); // Destructor
 
-    vector<uint8_t> createWritePacket(int index, const vector<uint8_t>& data); // Paquete de escritura de 12 bytes
-    vector<uint8_t> createReadPacket(int index); // Paquete de lectura de 8 bytes
+    WriteRequest createWritePacket(int index, uint32_t value); // Paquete de escritura de 12 bytes
+    ReadRequest createReadPacket(int index); // Paquete de lectura de 8 bytes
+    static void configurePort(QSerialPort& port, const QString& portName); // Configuración del manual (115200 8N1, sin control de flujo), sin abrirlo
+    static unique_ptr<Transport> createTransport(const QString& portName); // Transporte según el nombre (tcp:, unix:, termios:) o TRANSPORT_VARIABLE, si no QSerialPort
     bool openPort(const QString& portName); // Abrir puerto serial
     void closePort(); // Cerrar puerto serial
     bool checkPortStatus(); // Comprueba si el puerto sigue disponible
-    bool sendData(const vector<uint8_t>& data); // Enviar paquetes al serial
-    vector<uint8_t> readData(); // Leer paquetes recibidos por el serial
+    bool sendData(const uint8_t *data, size_t size); // Enviar paquetes al serial tal cual, sin copiarlos
+    vector<uint8_t> readData(int expectedSize = RESPONSE_PACKET_SIZE); // Leer paquetes recibidos por el serial (por tramas de expectedSize bytes, 0 para esperar a que la línea quede en silencio)
+    FRAMESTATUS readFrame(int timeoutMs, bool resync, Response& frame, int& frameSize); // Esperar una trama de respuesta, sin resync una trama con CRC malo se consume y se informa
+    void discardInput(int quietMs); // Tirar todo lo recibido hasta que la línea quede en silencio quietMs
     vector<uint8_t> readTestData(int readRegister); // Casos de prueba
     uint16_t crc16Modbus(const vector<uint8_t>& data); // Calcular el crc en 2 bytes
+    bool sanitizeResponse(const Response& response, int size); // Comprobar que la respuesta es una trama de 8 bytes con formato correcto
+    bool validateCRC(const Response& response); // Comprobar que el CRC recibido coincide con el calculado
+    int64_t firstByteTime() const; // Cuándo llegó el primer byte de la última trama de readFrame (reloj de traceNow, 0 si no llegó nada)
+    void setCaptureDirectory(const QString& directory); // Capturar el tráfico de cada conexión a un .eolecap en directory (vacío = no capturar)
+    void setLinkLostHandler(function<void(const QString&)> handler); // A quién avisar cuando el puerto da un error de los que no se recuperan
+    RttEstimator &rttEstimator(); // Ida y vuelta medida en este puerto, de ella salen los timeouts (se reinicia al abrir)
+    void reportResponseTimeout(); // Publica el timeout actual del estimador en la métrica de este puerto
+    void setLowLatency(bool enabled); // Modo de baja latencia (lowlatency.h) en las siguientes conexiones, por defecto según LOW_LATENCY_VARIABLE
 
 private:
-    QSerialPort serial; // Guardar el puerto serial
+    FRAMESTATUS extractFrame(bool resync, Response& frame); // Busca en el buffer de recepción una trama completa con HEADER y CRC válidos
+    int receiveAvailable(int timeoutMs = 0); // Pasa al buffer de recepción lo que haya en el puerto, esperando hasta timeoutMs (bytes recibidos)
+    void consumeReceived(int count); // Quita count bytes del principio del buffer de recepción
+    void enableLowLatency(); // Activa el modo de baja latencia en el puerto recién abierto y apunta la ida y vuelta de antes y de después
+    double measureRoundTrip(); // Mediana de LOW_LATENCY_RTT_SAMPLES lecturas del MCK (en ms), -1 si el sensor no contesta
+
+    unique_ptr<Transport> transport; // Puerto abierto (QSerialPort, termios o socket según el nombre), nullptr si no hay ninguno
+    array<uint8_t, RX_BUFFER_SIZE> rxBuffer; // Bytes recibidos que aún no forman una trama, se guardan para la siguiente transacción
+    int rxLength; // Bytes válidos en rxBuffer
+    int64_t firstByteNs; // Marca de tiempo del primer byte de la trama que se está esperando
+    QString captureDirectory; // Dónde dejar las capturas, vacío si no se captura
+    CaptureWriter capture; // Captura de la conexión actual (solo abierta si se pidió)
+    function<void(const QString&)> linkLost; // Aviso de puerto perdido (cable desconectado, dispositivo retirado)
+    bool lowLatency; // Activar el modo de baja latencia al abrir
+    RttEstimator roundTrip; // Estimador de la ida y vuelta del puerto abierto
+    MetricGauge *timeoutMetric; // Serie de la métrica del timeout para el puerto abierto (nullptr sin puerto)
+#ifdef __linux__
+    LowLatencySerial lowLatencyMode; // Lo cambiado en el puerto abierto, se restaura al cerrar
+#endif
 };
 
 #endif // SERIALMANAGER_H
@@ -0,0 +1,459 @@
+#include "serialreactor.h"
+
+#ifdef __linux__
+
+#include "tracing.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <future>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const uint64_t REACTOR_WAKE_KEY = UINT64_MAX; // Clave del eventfd en el epoll, los enlaces usan id * 2 (puerto) e id * 2 + 1 (timer)
+
+static TransactionResult resultFor(const Transaction &transaction, TRANSACTIONSTATUS status) {
+    TransactionResult result;
+    result.id = transaction.id;
+    result.type = transaction.type;
+    result.address = transaction.address;
+    result.status = status;
+    return result;
+}
+
+SerialReactor::SerialReactor() : epollFd(-1), wakeFd(-1), running(false), nextLink(0) {
+}
+
+SerialReactor::~SerialReactor() {
+    stop();
+}
+
+bool SerialReactor::start() {
+    if (running) return true;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        if (epollFd >= 0) close(epollFd);
+        if (wakeFd >= 0) close(wakeFd);
+        epollFd = wakeFd = -1;
+        return false;
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = REACTOR_WAKE_KEY;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    running = true;
+    loop = thread(&SerialReactor::run, this);
+    return true;
+}
+
+void SerialReactor::stop() {
+    if (!running) return;
+
+    // El último comando cierra todos los enlaces (avisando de lo pendiente) y hace salir al bucle
+    post([this]() {
+        vector<int> ids;
+        for (const auto &entry : links) ids.push_back(entry.first);
+        for (int id : ids) removeLink(id);
+        running = false;
+    });
+    loop.join();
+
+    close(wakeFd);
+    close(epollFd);
+    epollFd = wakeFd = -1;
+}
+
+int SerialReactor::openPort(const string &path, ReactorCompletion completion, ReactorLinkLost lost) {
+    if (!running) return -1;
+
+    // El transporte lo configura igual que SerialManager::openPort (115200 8N1, sin control de flujo), en crudo y sin bloquear
+    unique_ptr<Transport> transport = createPosixTransport(path);
+    int timerFd = -1;
+    if (!transport->open(path) || (timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+        linkMetrics().portErrors.increment();
+        return -1;
+    }
+
+    int id = nextLink++;
+    Link *link = new Link;
+    link->id = id;
+    link->fd = transport->pollFd();
+    link->transport = move(transport);
+    link->timerFd = timerFd;
+    link->completion = completion;
+    link->lost = lost;
+    link->timeoutMetric = &linkMetrics().responseTimeout(path);
+    link->timeoutMetric->set(link->roundTrip.timeout());
+    {
+        lock_guard<mutex> locker(healthMutex);
+        healthy[link->id] = true;
+    }
+    linkMetrics().portOpens.increment();
+    linkMetrics().portOpen.add(1);
+
+    // Se registra en el hilo del reactor, que es el único que toca links y el epoll
+    post([this, link]() {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = static_cast<uint64_t>(link->id) * 2;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, link->fd, &event);
+        event.data.u64 = static_cast<uint64_t>(link->id) * 2 + 1;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, link->timerFd, &event);
+        links[link->id].reset(link);
+    });
+    return id;
+}
+
+void SerialReactor::closePort(int link) {
+    if (!running) return;
+    if (loop.get_id() == this_thread::get_id()) {
+        removeLink(link); // Desde un comando del propio reactor no se puede esperar a sí mismo
+        return;
+    }
+
+    // Se espera a que el reactor lo haya quitado: a partir de aquí el dueño del enlace ya puede destruirse
+    promise<void> removed;
+    post([this, link, &removed]() {
+        removeLink(link);
+        removed.set_value();
+    });
+    removed.get_future().wait();
+}
+
+void SerialReactor::submit(int link, const Transaction &transaction) {
+    post([this, link, transaction]() {
+        auto entry = links.find(link);
+        if (entry == links.end()) return; // Enlace ya cerrado, su dueño ya no espera resultados
+
+        Link &target = *entry->second;
+        if (target.state == REACTOR_LOST) {
+            if (target.completion) target.completion(transaction, resultFor(transaction, TRANSACTION_SEND_ERROR));
+            return;
+        }
+        target.queue.push_back(transaction);
+        startNext(target);
+    });
+}
+
+void SerialReactor::cancelPending(int link) {
+    post([this, link]() {
+        auto entry = links.find(link);
+        if (entry != links.end()) cancelQueued(*entry->second, TRANSACTION_CANCELLED);
+    });
+}
+
+bool SerialReactor::isLinkHealthy(int link) const {
+    lock_guard<mutex> locker(healthMutex);
+    auto entry = healthy.find(link);
+    return entry != healthy.end() && entry->second;
+}
+
+void SerialReactor::post(function<void()> command) {
+    {
+        lock_guard<mutex> locker(commandMutex);
+        commands.push_back(move(command));
+    }
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written; // Si el contador ya estaba a tope el bucle ya tiene que despertarse de todos modos
+}
+
+void SerialReactor::runCommands() {
+    vector<function<void()>> pending;
+    {
+        lock_guard<mutex> locker(commandMutex);
+        pending.swap(commands);
+    }
+    for (function<void()> &command : pending) {
+        command();
+    }
+}
+
+void SerialReactor::run() {
+    epoll_event events[REACTOR_MAX_EVENTS];
+
+    while (running) {
+        int count = epoll_wait(epollFd, events, REACTOR_MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int i = 0; i < count && running; ++i) {
+            uint64_t key = events[i].data.u64;
+            if (key == REACTOR_WAKE_KEY) {
+                uint64_t value;
+                ssize_t received = read(wakeFd, &value, sizeof(value));
+                (void)received;
+                runCommands();
+                continue;
+            }
+
+            // El enlace puede haberse cerrado con un comando de esta misma vuelta
+            auto entry = links.find(static_cast<int>(key / 2));
+            if (entry == links.end()) continue;
+            Link &link = *entry->second;
+
+            if (key % 2 == 1) {
+                handleTimeout(link);
+            } else {
+                if ((events[i].events & EPOLLOUT) && link.state == REACTOR_SENDING) sendPending(link);
+                if (events[i].events & EPOLLIN) handleReadable(link);
+                if ((events[i].events & (EPOLLHUP | EPOLLERR)) && link.state != REACTOR_LOST) {
+                    failLink(link, "The serial port was closed or failed.");
+                }
+            }
+            startNext(link);
+        }
+    }
+}
+
+void SerialReactor::startNext(Link &link) {
+    // En bucle porque una petición que no se puede escribir termina en el acto y deja el enlace libre otra vez
+    while (link.state == REACTOR_IDLE && !link.queue.empty()) {
+        link.current = move(link.queue.front());
+        link.queue.pop_front();
+
+        if (link.current.type == WRITE_TRANSACTION) {
+            WriteRequest packet(link.current.address, link.current.value);
+            memcpy(link.tx.data(), packet.data(), WRITE_REQUEST_SIZE);
+            link.txLength = WRITE_REQUEST_SIZE;
+        } else {
+            memcpy(link.tx.data(), readFrames.lookup(link.current.address), READ_REQUEST_SIZE); // Bytes ya codificados, sin calcular el CRC
+            link.txLength = READ_REQUEST_SIZE;
+        }
+        link.txSent = 0;
+        link.firstByteSeen = false;
+        link.state = REACTOR_SENDING;
+        link.sentAt = chrono::steady_clock::now();
+
+        armTimer(link, link.roundTrip.timeout());
+        sendPending(link);
+    }
+}
+
+void SerialReactor::sendPending(Link &link) {
+    while (link.txSent < link.txLength) {
+        int written = link.transport->writeSome(link.tx.data() + link.txSent, link.txLength - link.txSent);
+        if (written > 0) {
+            link.txSent += static_cast<size_t>(written);
+            linkMetrics().bytesSent.increment(static_cast<uint64_t>(written));
+            continue;
+        }
+        if (written == 0) {
+            watchWritable(link, true); // El resto cuando el puerto tenga sitio
+            return;
+        }
+
+        watchWritable(link, false);
+        armTimer(link, 0);
+        linkMetrics().portErrors.increment();
+        TransactionResult result = resultFor(link.current, TRANSACTION_SEND_ERROR);
+        finish(link, result);
+        return;
+    }
+
+    watchWritable(link, false);
+    link.state = REACTOR_WAITING;
+    traceEvent(link.current.id, link.current.address, TRACE_WRITE_COMPLETE);
+}
+
+void SerialReactor::handleReadable(Link &link) {
+    while (true) {
+        if (link.rxLength == link.rx.size()) {
+            // Buffer lleno sin ninguna trama: nada de eso puede ser una respuesta, se tira lo más antiguo
+            size_t discard = link.rx.size() / 2;
+            memmove(link.rx.data(), link.rx.data() + discard, link.rxLength - discard);
+            link.rxLength -= discard;
+            linkMetrics().resyncBytes.increment(discard);
+        }
+
+        int received = link.transport->read(link.rx.data() + link.rxLength, link.rx.size() - link.rxLength, 0);
+        if (received > 0) {
+            if (link.state == REACTOR_WAITING && !link.firstByteSeen) {
+                link.firstByteSeen = true;
+                traceEvent(link.current.id, link.current.address, TRACE_FIRST_RX);
+            }
+            link.rxLength += static_cast<size_t>(received);
+            linkMetrics().bytesReceived.increment(static_cast<uint64_t>(received));
+            continue;
+        }
+        if (received == 0) break; // Ya no queda nada
+
+        failLink(link, link.transport->errorString());
+        return;
+    }
+
+    if (link.state == REACTOR_DRAINING) {
+        // Una respuesta atrasada al intento anterior, que no se confunda con la del reintento; el silencio vuelve a contar
+        linkMetrics().resyncBytes.increment(link.rxLength);
+        link.rxLength = 0;
+        armTimer(link, PIPELINE_DRAIN_TIME);
+        return;
+    }
+
+    // Sin transacción en curso los bytes se quedan para la siguiente, como en SerialManager
+    if (link.state != REACTOR_WAITING) return;
+
+    size_t frameStart = 0;
+    size_t consumed = 0;
+    FRAMESEARCH search = findResponseFrame(link.rx.data(), link.rxLength, true, frameStart, consumed);
+    size_t garbage = (search == SEARCH_FRAME_OK) ? frameStart : consumed;
+    if (garbage > 0) {
+        linkMetrics().resyncs.increment();
+        linkMetrics().resyncBytes.increment(garbage);
+    }
+
+    TransactionResult result = resultFor(link.current, TRANSACTION_OK);
+    if (search == SEARCH_FRAME_OK) {
+        memcpy(result.response.data(), link.rx.data() + frameStart, RESPONSE_SIZE);
+        result.responseSize = RESPONSE_SIZE;
+    }
+    memmove(link.rx.data(), link.rx.data() + consumed, link.rxLength - consumed);
+    link.rxLength -= consumed;
+    if (search != SEARCH_FRAME_OK) return; // Falta trama, se sigue esperando hasta el timeout
+
+    traceEvent(link.current.id, link.current.address, TRACE_FRAME_COMPLETE);
+    armTimer(link, 0);
+    if (link.current.retries == 0) { // Karn: en un reintento no se sabe a qué petición contesta
+        link.roundTrip.sample(chrono::duration<double, milli>(chrono::steady_clock::now() - link.sentAt).count());
+        link.timeoutMetric->set(link.roundTrip.timeout());
+    }
+    if (result.response.decode(result.value) != DECODE_OK) result.status = TRANSACTION_NOTOK; // Con resync el CRC ya está comprobado
+    finish(link, result);
+}
+
+void SerialReactor::handleTimeout(Link &link) {
+    uint64_t expirations = 0;
+    if (read(link.timerFd, &expirations, sizeof(expirations)) != sizeof(expirations)) return; // Ya desarmado
+    if (link.state == REACTOR_DRAINING) {
+        link.state = REACTOR_IDLE; // La línea lleva PIPELINE_DRAIN_TIME en silencio, run() manda el reintento
+        return;
+    }
+    if (link.state != REACTOR_SENDING && link.state != REACTOR_WAITING) return;
+
+    TransactionResult result = resultFor(link.current, TRANSACTION_TIMEOUT);
+    if (link.state == REACTOR_SENDING) {
+        // La petición no llegó a salir entera en todo el timeout
+        watchWritable(link, false);
+        result.status = TRANSACTION_SEND_ERROR;
+    } else if (link.rxLength > 0) {
+        // Llegaron bytes pero no llegaron a formar una trama, igual que FRAME_INCOMPLETE
+        result.status = TRANSACTION_BAD_FORMAT;
+        result.responseSize = static_cast<int>(min(link.rxLength, RESPONSE_SIZE));
+        memcpy(result.response.data(), link.rx.data(), result.responseSize);
+        link.rxLength = 0;
+    } else {
+        linkMetrics().responseTimeouts.increment();
+        link.roundTrip.backoff();
+    }
+    link.timeoutMetric->set(link.roundTrip.timeout());
+    finish(link, result);
+}
+
+void SerialReactor::finish(Link &link, TransactionResult &result) {
+    link.state = REACTOR_IDLE;
+    traceEvent(link.current.id, link.current.address, TRACE_VALIDATED);
+
+    // Los fallos del enlace vuelven a la cabeza de la cola, como en SerialWorker::execute pero sin bloquear el hilo
+    if (isRetryable(result.status) && link.current.retries < RETRY_MAX) {
+        link.current.retries++;
+        linkMetrics().retries.increment();
+        link.queue.push_front(move(link.current));
+
+        // Como SerialWorker::execute: tras un timeout la respuesta aún puede llegar tarde y se emparejaría con el reintento
+        if (result.status == TRANSACTION_TIMEOUT || result.status == TRANSACTION_BAD_FORMAT) {
+            link.rxLength = 0;
+            link.state = REACTOR_DRAINING;
+            armTimer(link, PIPELINE_DRAIN_TIME);
+        }
+        return;
+    }
+    result.retries = link.current.retries;
+    if (link.completion) link.completion(link.current, result);
+}
+
+void SerialReactor::cancelQueued(Link &link, TRANSACTIONSTATUS status) {
+    deque<Transaction> cancelled;
+    cancelled.swap(link.queue);
+    for (const Transaction &transaction : cancelled) {
+        if (link.completion) link.completion(transaction, resultFor(transaction, status));
+    }
+}
+
+void SerialReactor::failLink(Link &link, const string &reason) {
+    armTimer(link, 0);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, link.fd, nullptr); // Un puerto colgado seguiría despertando el epoll con EPOLLHUP
+    linkMetrics().portErrors.increment();
+    {
+        lock_guard<mutex> locker(healthMutex);
+        healthy[link.id] = false;
+    }
+
+    if (link.state == REACTOR_SENDING || link.state == REACTOR_WAITING) {
+        TransactionResult result = resultFor(link.current, TRANSACTION_SEND_ERROR);
+        finish(link, result);
+    }
+    link.state = REACTOR_LOST;
+    cancelQueued(link, TRANSACTION_CANCELLED);
+    if (link.lost) link.lost(reason);
+}
+
+void SerialReactor::removeLink(int id) {
+    auto entry = links.find(id);
+    if (entry == links.end()) return;
+    Link &link = *entry->second;
+
+    // Lo que quede (también la que está en curso) se da por cancelado, igual que al cerrar con el SerialWorker
+    if (link.state == REACTOR_SENDING || link.state == REACTOR_WAITING) {
+        TransactionResult result = resultFor(link.current, TRANSACTION_CANCELLED);
+        finish(link, result);
+    }
+    cancelQueued(link, TRANSACTION_CANCELLED);
+
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, link.fd, nullptr);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, link.timerFd, nullptr);
+    close(link.timerFd);
+    link.transport->close();
+    linkMetrics().portOpen.add(-1);
+    link.timeoutMetric->set(0); // Como SerialManager::closePort, la serie del puerto queda a 0
+    links.erase(entry);
+
+    lock_guard<mutex> locker(healthMutex);
+    healthy.erase(id);
+}
+
+void SerialReactor::armTimer(Link &link, int timeoutMs) {
+    itimerspec spec = {};
+    spec.it_value.tv_sec = timeoutMs / 1000;
+    spec.it_value.tv_nsec = static_cast<long>(timeoutMs % 1000) * 1000000L;
+    timerfd_settime(link.timerFd, 0, &spec, nullptr);
+}
+
+void SerialReactor::watchWritable(Link &link, bool writable) {
+    if (link.watchingWrite == writable || link.state == REACTOR_LOST) return;
+    link.watchingWrite = writable;
+
+    epoll_event event = {};
+    event.events = writable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.u64 = static_cast<uint64_t>(link.id) * 2;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, link.fd, &event);
+}
+
+SerialReactor &serialReactor() {
+    static SerialReactor reactor;
+    static bool started = reactor.start();
+    (void)started;
+    return reactor;
+}
+
+#endif // __linux__
@@ -0,0 +1,116 @@
+#ifndef SERIALREACTOR_H
+#define SERIALREACTOR_H
+
+// Reactor serie para Linux: un solo hilo atiende muchos puertos a la vez con epoll sobre los descriptores de transportes POSIX
+// (termios en crudo para los puertos serie y pty, o sockets tcp:/unix:)
+// Cada puerto (enlace) tiene su cola y su máquina de estados petición/respuesta, y el timeout de la respuesta va en un timerfd,
+// así un núcleo lleva decenas de sensores sin un hilo ni un QSerialPort por dispositivo
+// Sin Qt: el manejador lo usa como backend alternativo al SerialWorker (REACTOR_VARIABLE) y el benchmark lo mide sin Qt
+
+#ifdef __linux__
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "transaction.h"
+#include "transport.h"
+#include "readframes.h"
+#include "rttestimator.h"
+#include "values.h"
+
+using namespace std;
+
+class MetricGauge;
+
+#define REACTOR_MAX_EVENTS 64 // Eventos que se recogen en cada epoll_wait
+
+typedef function<void(const Transaction&, const TransactionResult&)> ReactorCompletion; // Resultado de una transacción (en el hilo del reactor)
+typedef function<void(const string&)> ReactorLinkLost; // El puerto ha dado un error irrecuperable (en el hilo del reactor)
+
+enum REACTORSTATE { // Estado de un enlace
+    REACTOR_IDLE = 0,    // Sin transacción en curso
+    REACTOR_SENDING = 1, // La petición no cabía entera, se espera a poder escribir el resto (EPOLLOUT)
+    REACTOR_WAITING = 2, // Petición enviada, esperando la respuesta o el timeout
+    REACTOR_LOST = 3,    // El puerto falló, ya no se atiende
+    REACTOR_DRAINING = 4 // Antes de un reintento tras un timeout o una trama incompleta: se tira lo que llegue hasta PIPELINE_DRAIN_TIME de silencio
+};
+
+class SerialReactor {
+public:
+    SerialReactor(); // Constructor
+    ~SerialReactor(); // Destructor, cierra todos los enlaces y para el hilo
+
+    bool start(); // Crea el epoll y arranca el hilo
+    void stop(); // Cierra los enlaces (cancelando lo pendiente) y para el hilo
+
+    // Desde cualquier hilo (closePort no desde los callbacks del reactor)
+    int openPort(const string &path, ReactorCompletion completion, ReactorLinkLost lost = nullptr); // Abre y configura el puerto (o socket), devuelve el enlace o -1
+    void closePort(int link); // Cancela lo pendiente y restaura el puerto, al volver ya no llega ningún callback de ese enlace
+    void submit(int link, const Transaction &transaction); // Encola una transacción en el enlace
+    void cancelPending(int link); // Cancela lo que aún no se ha enviado (la transacción en curso termina normalmente)
+    bool isLinkHealthy(int link) const; // El enlace sigue abierto y sin errores
+
+private:
+    struct Link { // Un puerto atendido por el reactor
+        int id = -1;
+        unique_ptr<Transport> transport; // Puerto o socket en modo no bloqueante, al cerrarlo queda como estaba
+        int fd = -1;                  // Descriptor del transporte, el que se vigila con el epoll
+        int timerFd = -1;             // Timeout de la respuesta en curso
+        REACTORSTATE state = REACTOR_IDLE;
+        deque<Transaction> queue;     // Pendientes, en orden de llegada
+        Transaction current;          // La que está en curso
+        array<uint8_t, WRITE_REQUEST_SIZE> tx = {}; // Petición en curso ya codificada
+        size_t txLength = 0;          // Bytes de la petición
+        size_t txSent = 0;            // Bytes ya escritos
+        bool watchingWrite = false;   // EPOLLOUT activado (solo mientras queda petición por escribir)
+        bool firstByteSeen = false;   // Ya llegó el primer byte de la respuesta en curso (para las trazas)
+        RttEstimator roundTrip;       // Ida y vuelta medida en este enlace, de ella sale el timeout
+        MetricGauge *timeoutMetric = nullptr; // Serie de la métrica del timeout para este puerto
+        chrono::steady_clock::time_point sentAt; // Cuándo empezó a salir la petición en curso
+        array<uint8_t, RX_BUFFER_SIZE> rx = {}; // Bytes recibidos que aún no forman una trama
+        size_t rxLength = 0;          // Bytes válidos en rx
+        ReactorCompletion completion; // A quién avisar con cada resultado
+        ReactorLinkLost lost;         // A quién avisar si el puerto falla
+    };
+
+    void run(); // Bucle de epoll del hilo del reactor
+    void post(function<void()> command); // Ejecuta command en el hilo del reactor (despierta el epoll con el eventfd)
+    void runCommands(); // Ejecuta lo que otros hilos han pedido
+    void startNext(Link &link); // Envía la siguiente transacción de la cola si el enlace está libre
+    void sendPending(Link &link); // Escribe lo que quede de la petición en curso
+    void handleReadable(Link &link); // Lee todo lo disponible y busca la respuesta
+    void handleTimeout(Link &link); // Venció el timerfd sin respuesta completa
+    void finish(Link &link, TransactionResult &result); // Entrega el resultado de la transacción en curso y pasa a la siguiente
+    void cancelQueued(Link &link, TRANSACTIONSTATUS status); // Entrega todas las de la cola con ese estado
+    void failLink(Link &link, const string &reason); // El puerto falló: se cancela todo y se avisa
+    void removeLink(int id); // Saca el enlace del epoll, restaura el puerto y lo cierra
+    void armTimer(Link &link, int timeoutMs); // Programa (o con 0 desarma) el timeout del enlace
+    void watchWritable(Link &link, bool writable); // Añade o quita EPOLLOUT
+
+    int epollFd;                      // epoll con los puertos, sus timerfd y el eventfd de los comandos
+    int wakeFd;                       // eventfd para despertar el bucle desde otros hilos
+    thread loop;                      // Hilo del reactor
+    atomic<bool> running;             // El hilo sigue en marcha
+    atomic<int> nextLink;             // Identificador del siguiente enlace
+    mutex commandMutex;               // Protege commands
+    vector<function<void()>> commands;// Pedidos de otros hilos, se ejecutan en el hilo del reactor
+    mutable mutex healthMutex;        // Protege healthy
+    map<int, bool> healthy;           // Estado de cada enlace, para leerlo sin pasar por el hilo del reactor
+    map<int, unique_ptr<Link>> links; // Enlaces abiertos (solo desde el hilo del reactor)
+    ReadFrameCache readFrames;        // Peticiones de lectura ya codificadas (solo desde el hilo del reactor)
+};
+
+SerialReactor &serialReactor(); // Reactor compartido por todos los manejadores del proceso, arrancado la primera vez
+
+#endif // __linux__
+
+#endif // SERIALREACTOR_H
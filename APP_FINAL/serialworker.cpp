@@ -0,0 +1,305 @@
+#include "serialworker.h"
+#include "values.h"
+#include "tracing.h"
+#include "metrics.h"
+#include "logging.h"
+#include <QElapsedTimer>
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+
+static const char *retryReason(TRANSACTIONSTATUS status) {
+    switch (status) {
+    case TRANSACTION_TIMEOUT:    return "a timeout";
+    case TRANSACTION_BAD_CRC:    return "a bad CRC";
+    case TRANSACTION_BAD_FORMAT: return "an incomplete frame";
+    case TRANSACTION_NOTOK:      return "a NOTOK response";
+    default:                     return "an error";
+    }
+}
+
+SerialWorker::SerialWorker(QObject *resultReceiver)
+    : receiver(resultReceiver), serialManager(nullptr), processingScheduled(false), portHealthy(true), pipelineDepth(PIPELINE_DEPTH) {
+    // El SerialManager se crea en initialize() para que su QSerialPort pertenezca al hilo serie
+}
+
+SerialWorker::~SerialWorker() {
+    // Si no se llamó a shutdown() (no debería pasar) lo liberamos igualmente
+    delete serialManager;
+}
+
+void SerialWorker::initialize() {
+    serialManager = new SerialManager;
+    serialManager->setLinkLostHandler([this](const QString &reason) {
+        portHealthy = false;
+        emit portLost(reason);
+    });
+}
+
+void SerialWorker::shutdown() {
+    cancelPending();
+    delete serialManager;
+    serialManager = nullptr;
+}
+
+bool SerialWorker::openPort(const QString &portName) {
+    bool opened = serialManager->openPort(portName);
+    portHealthy = opened;
+    return opened;
+}
+
+void SerialWorker::closePort() {
+    serialManager->closePort();
+    portHealthy = true; // Sin puerto abierto no hay nada que vigilar
+}
+
+void SerialWorker::refreshPortStatus() {
+    if (serialManager) {
+        portHealthy = serialManager->checkPortStatus();
+    }
+}
+
+void SerialWorker::setCaptureDirectory(const QString &directory) {
+    if (serialManager) {
+        serialManager->setCaptureDirectory(directory);
+    }
+}
+
+bool SerialWorker::isPortHealthy() const {
+    return portHealthy;
+}
+
+void SerialWorker::setPipelineDepth(int depth) {
+    pipelineDepth = depth < 1 ? 1 : (depth > PIPELINE_MAX_DEPTH ? PIPELINE_MAX_DEPTH : depth);
+}
+
+void SerialWorker::enqueue(const Transaction &transaction) {
+    QMutexLocker locker(&queueMutex);
+    pendingTransactions.push_back(transaction);
+
+    // Si el hilo serie no tiene ya un processQueue pendiente, le pedimos uno
+    if (!processingScheduled) {
+        processingScheduled = true;
+        QMetaObject::invokeMethod(this, [this]() { processQueue(); }, Qt::QueuedConnection);
+    }
+}
+
+void SerialWorker::cancelPending() {
+    // Sacamos las transacciones de la cola bajo el mutex y avisamos fuera de él
+    deque<Transaction> cancelled;
+    {
+        QMutexLocker locker(&queueMutex);
+        cancelled.swap(pendingTransactions);
+    }
+
+    for (const Transaction &transaction : cancelled) {
+        TransactionResult result;
+        result.id = transaction.id;
+        result.type = transaction.type;
+        result.address = transaction.address;
+        result.status = TRANSACTION_CANCELLED;
+        deliver(transaction, result);
+    }
+}
+
+void SerialWorker::processQueue() {
+    // Atendemos la cola en orden hasta que quede vacía, las nuevas peticiones que lleguen mientras tanto se recogen en la misma vuelta
+    while (true) {
+        vector<Transaction> window;
+        {
+            QMutexLocker locker(&queueMutex);
+            if (pendingTransactions.empty()) {
+                processingScheduled = false;
+                return;
+            }
+            window.push_back(pendingTransactions.front());
+            pendingTransactions.pop_front();
+
+            // Si es una lectura pipelined, juntamos en la misma ráfaga las siguientes que también lo sean
+            while (window.front().pipelined && window.front().type == READ_TRANSACTION &&
+                   static_cast<int>(window.size()) < pipelineDepth && !pendingTransactions.empty() &&
+                   pendingTransactions.front().pipelined && pendingTransactions.front().type == READ_TRANSACTION) {
+                window.push_back(pendingTransactions.front());
+                pendingTransactions.pop_front();
+            }
+        }
+
+        if (window.size() == 1) {
+            deliver(window.front(), execute(window.front()));
+        } else {
+            executeWindow(window);
+        }
+    }
+}
+
+TransactionResult SerialWorker::execute(const Transaction &transaction) {
+    // Los fallos del enlace se reintentan aquí mismo, sin volver a la cola, como mucho RETRY_MAX veces
+    Transaction current = transaction;
+    TransactionResult result = attempt(current);
+    while (isRetryable(result.status) && current.retries < RETRY_MAX) {
+        // Tras un timeout la respuesta aún puede llegar tarde, y sería la que se empareje con el reintento
+        if (result.status == TRANSACTION_TIMEOUT || result.status == TRANSACTION_BAD_FORMAT) {
+            serialManager->discardInput(PIPELINE_DRAIN_TIME);
+        }
+        current.retries++;
+        logRetry(current, result.status);
+        result = attempt(current);
+    }
+    result.retries = current.retries;
+    return result;
+}
+
+TransactionResult SerialWorker::attempt(const Transaction &transaction) {
+    TransactionResult result;
+    result.id = transaction.id;
+    result.type = transaction.type;
+    result.address = transaction.address;
+
+    // Construimos el paquete según el tipo de petición, en la pila y sin memoria dinámica
+    QElapsedTimer roundTrip;
+    roundTrip.start();
+    bool sent;
+    if (transaction.type == WRITE_TRANSACTION) {
+        WriteRequest packet = serialManager->createWritePacket(transaction.address, transaction.value);
+        sent = serialManager->sendData(packet.data(), packet.size());
+    } else {
+        sent = serialManager->sendData(readFrames.lookup(transaction.address), READ_REQUEST_SIZE); // Bytes ya codificados, sin calcular el CRC
+    }
+
+    if (!sent) {
+        result.status = TRANSACTION_SEND_ERROR;
+        portHealthy = serialManager->checkPortStatus();
+        return result;
+    }
+    traceEvent(transaction.id, transaction.address, TRACE_WRITE_COMPLETE);
+
+    // Misma secuencia de comprobaciones para lecturas y escrituras, con el timeout que sale de lo que tarda el sensor en este puerto
+    RttEstimator &estimator = serialManager->rttEstimator();
+    FRAMESTATUS frameStatus = serialManager->readFrame(estimator.timeout(), true, result.response, result.responseSize);
+    if (frameStatus == FRAME_OK || frameStatus == FRAME_BAD_CRC) {
+        // Un reintento no da muestra: no se sabe si contestó a la petición nueva o a la anterior
+        if (transaction.retries == 0) estimator.sample(roundTrip.nsecsElapsed() / 1e6);
+    } else if (result.responseSize == 0) {
+        estimator.backoff();
+    }
+    serialManager->reportResponseTimeout();
+    traceFrame(transaction, result.responseSize);
+    classifyResponse(frameStatus, result);
+    traceEvent(transaction.id, transaction.address, TRACE_VALIDATED);
+
+    portHealthy = serialManager->checkPortStatus();
+    return result;
+}
+
+void SerialWorker::executeWindow(const vector<Transaction> &window) {
+    // Mandamos todas las peticiones de lectura de una sola vez, así solo pagamos la ida y vuelta una vez por ráfaga
+    // La ráfaga se monta en un buffer fijo copiando las peticiones ya codificadas (processQueue nunca junta más de PIPELINE_MAX_DEPTH)
+    array<uint8_t, READ_REQUEST_SIZE * PIPELINE_MAX_DEPTH> burst;
+    size_t burstSize = 0;
+    for (const Transaction &transaction : window) {
+        memcpy(burst.data() + burstSize, readFrames.lookup(transaction.address), READ_REQUEST_SIZE);
+        burstSize += READ_REQUEST_SIZE;
+    }
+
+    bool sent = serialManager->sendData(burst.data(), burstSize);
+    if (sent) {
+        int64_t writtenNs = traceNow(); // Toda la ráfaga sale a la vez
+        for (const Transaction &transaction : window) {
+            traceEventAt(transaction.id, transaction.address, TRACE_WRITE_COMPLETE, writtenNs);
+        }
+    }
+
+    // El protocolo no dice a qué dirección corresponde cada respuesta, así que se emparejan por orden de llegada
+    // Aquí no se mide la ida y vuelta: cada respuesta espera además a las de delante
+    RttEstimator &estimator = serialManager->rttEstimator();
+    vector<Transaction> requeue; // Lo que vuelve a la cabeza de la cola, en orden (reintentos y lo que quedó detrás de un fallo)
+    for (size_t i = 0; i < window.size(); ++i) {
+        TransactionResult result;
+        result.id = window[i].id;
+        result.type = window[i].type;
+        result.address = window[i].address;
+
+        if (!sent) {
+            result.status = TRANSACTION_SEND_ERROR;
+            deliver(window[i], result);
+            continue;
+        }
+
+        // Cada respuesta tiene su propio timeout y aquí no se resincroniza: una respuesta corrupta ocupa su hueco
+        FRAMESTATUS frameStatus = serialManager->readFrame(estimator.timeout(), false, result.response, result.responseSize);
+        if (result.responseSize == 0) estimator.backoff();
+        traceFrame(window[i], result.responseSize);
+        classifyResponse(frameStatus, result);
+        traceEvent(window[i].id, window[i].address, TRACE_VALIDATED);
+
+        if (isRetryable(result.status) && window[i].retries < RETRY_MAX) {
+            Transaction again = window[i];
+            again.retries++;
+            logRetry(again, result.status);
+            requeue.push_back(again);
+        } else {
+            result.retries = window[i].retries;
+            deliver(window[i], result);
+        }
+
+        // NOTOK es una trama válida y no descuadra nada, cualquier otro fallo sí
+        if (result.status != TRANSACTION_OK && result.status != TRANSACTION_NOTOK) {
+            if (i + 1 < window.size()) {
+                cerr << "Pipelined read of register 0x" << hex << window[i].address << dec
+                     << " failed, resending the remaining " << (window.size() - i - 1) << " request/s.\n";
+            }
+
+            // Vaciamos la línea para no confundir respuestas atrasadas con las de lo que se vuelve a mandar
+            requeue.insert(requeue.end(), window.begin() + i + 1, window.end());
+            if (!requeue.empty()) serialManager->discardInput(PIPELINE_DRAIN_TIME);
+            break;
+        }
+    }
+    serialManager->reportResponseTimeout();
+
+    if (!requeue.empty()) {
+        QMutexLocker locker(&queueMutex);
+        pendingTransactions.insert(pendingTransactions.begin(), requeue.begin(), requeue.end());
+    }
+
+    portHealthy = serialManager->checkPortStatus();
+}
+
+void SerialWorker::classifyResponse(FRAMESTATUS frameStatus, TransactionResult &result) {
+    if (frameStatus == FRAME_TIMEOUT || result.responseSize == 0) {
+        result.status = TRANSACTION_TIMEOUT;
+    } else if (frameStatus == FRAME_BAD_CRC) {
+        result.status = TRANSACTION_BAD_CRC;
+    } else if (!serialManager->sanitizeResponse(result.response, result.responseSize)) {
+        result.status = TRANSACTION_BAD_FORMAT;
+    } else if (!serialManager->validateCRC(result.response)) {
+        result.status = TRANSACTION_BAD_CRC;
+    } else if (result.response.decode(result.value) != DECODE_OK) {
+        result.status = TRANSACTION_NOTOK; // Formato y CRC ya comprobados, solo puede ser el status
+    }
+}
+
+void SerialWorker::traceFrame(const Transaction &transaction, int responseSize) {
+    // El primer byte se apunta con la marca que guardó readFrame, la trama completa es ahora
+    if (responseSize == 0) return; // Timeout, no llegó nada
+    traceEventAt(transaction.id, transaction.address, TRACE_FIRST_RX, serialManager->firstByteTime());
+    traceEvent(transaction.id, transaction.address, TRACE_FRAME_COMPLETE);
+}
+
+void SerialWorker::logRetry(const Transaction &transaction, TRANSACTIONSTATUS status) {
+    linkMetrics().retries.increment();
+    WARNING_LOG(LOGCAT_SERIAL) << "Retrying " << (transaction.type == WRITE_TRANSACTION ? "write" : "read") << " of register 0x" << hex
+                               << transaction.address << dec << " after " << retryReason(status) << " (retry " << transaction.retries
+                               << "/" << RETRY_MAX << ", timeout " << serialManager->rttEstimator().timeout() << " ms).";
+}
+
+void SerialWorker::deliver(const Transaction &transaction, const TransactionResult &result) {
+    // El callback se ejecuta en el hilo del receptor (la UI), nunca en el hilo serie
+    if (!transaction.callback) return;
+
+    TransactionCallback callback = transaction.callback;
+    QMetaObject::invokeMethod(receiver, [callback, result]() {
+        callback(result);
+    }, Qt::QueuedConnection);
+}
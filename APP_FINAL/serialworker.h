@@ -0,0 +1,61 @@
+#ifndef SERIALWORKER_H
+#define SERIALWORKER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QString>
+#include <deque>
+#include <atomic>
+#include "transaction.h"
+#include "serialmanager.h"
+#include "readframes.h"
+
+// Vive en su propio hilo y es el único que toca el puerto serie, así la UI nunca se bloquea esperando al sensor
+
+using namespace std;
+
+class SerialWorker : public QObject {
+    Q_OBJECT
+
+public:
+    explicit SerialWorker(QObject *resultReceiver); // El receptor es el objeto en cuyo hilo se ejecutan los callbacks (el manejador)
+    ~SerialWorker(); // Destructor
+
+    // Solo desde el hilo serie (se invocan con QMetaObject::invokeMethod)
+    void initialize(); // Crea el SerialManager dentro del hilo serie
+    void shutdown(); // Cierra el puerto y destruye el SerialManager dentro del hilo serie
+    bool openPort(const QString &portName); // Abrir puerto serial
+    void closePort(); // Cerrar puerto serial
+    void refreshPortStatus(); // Vuelve a comprobar el estado del puerto
+    void setCaptureDirectory(const QString &directory); // Activa (o con vacío desactiva) la captura binaria del tráfico
+
+    // Desde cualquier hilo
+    void enqueue(const Transaction &transaction); // Añade una transacción a la cola y despierta al hilo serie si hace falta
+    void cancelPending(); // Cancela todo lo que aún no se ha enviado
+    bool isPortHealthy() const; // Último estado conocido del puerto
+    void setPipelineDepth(int depth); // Cuántas lecturas pipelined se pueden tener en vuelo a la vez
+
+signals:
+    void portLost(const QString &reason); // El puerto ha dado un error irrecuperable (se emite desde el hilo serie)
+
+private:
+    void processQueue(); // Atiende la cola hasta vaciarla
+    TransactionResult execute(const Transaction &transaction); // Envía una petición y espera su respuesta, con los reintentos que hagan falta
+    TransactionResult attempt(const Transaction &transaction); // Un solo intento de execute
+    void executeWindow(const vector<Transaction> &window); // Envía varias lecturas de golpe y empareja las respuestas en orden
+    void classifyResponse(FRAMESTATUS frameStatus, TransactionResult &result); // Traduce la trama recibida a estado y valor
+    void traceFrame(const Transaction &transaction, int responseSize); // Apunta en las trazas la llegada del primer byte y de la trama completa
+    void logRetry(const Transaction &transaction, TRANSACTIONSTATUS status); // Apunta en el log y en las métricas un reintento automático
+    void deliver(const Transaction &transaction, const TransactionResult &result); // Devuelve el resultado al hilo de la UI
+
+    QObject *receiver;                        // Objeto en cuyo hilo se ejecutan los callbacks
+    SerialManager *serialManager;             // Backend del puerto serie, creado dentro del hilo serie
+    QMutex queueMutex;                        // Protege la cola y el flag de procesamiento
+    deque<Transaction> pendingTransactions;   // Transacciones pendientes, en orden de llegada
+    bool processingScheduled;                 // Ya hay un processQueue en camino, no hace falta pedir otro
+    atomic<bool> portHealthy;                 // Resultado del último checkPortStatus, se puede leer sin tocar el puerto
+    atomic<int> pipelineDepth;                // Máximo de lecturas en vuelo en una ráfaga
+    ReadFrameCache readFrames;                // Peticiones de lectura ya codificadas, solo se usa en el hilo serie
+};
+
+#endif // SERIALWORKER_H
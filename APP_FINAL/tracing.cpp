@@ -0,0 +1,250 @@
+#include "tracing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0, "TRACE_RING_SIZE tiene que ser potencia de 2");
+
+static atomic<bool> tracingActive(true);
+static atomic<uint32_t> nextTraceThread(1);
+
+static TraceRing &traceRing() {
+    static TraceRing ring;
+    return ring;
+}
+
+static uint32_t currentTraceThread() {
+    // Numeramos los hilos según van apuntando eventos (1 suele ser la UI y 2 el hilo serie)
+    thread_local uint32_t thread = nextTraceThread.fetch_add(1, memory_order_relaxed);
+    return thread;
+}
+
+TraceRing::TraceRing() : writeIndex(0) {
+    for (Slot &slot : entries) {
+        slot.sequence.store(0, memory_order_relaxed);
+    }
+}
+
+void TraceRing::record(uint64_t transactionId, int address, TRACEPOINT point, int64_t timestampNs) {
+    // Cada productor se queda un hueco con un fetch_add y lo rellena; si da la vuelta pisa el más antiguo
+    uint64_t index = writeIndex.fetch_add(1, memory_order_relaxed);
+    Slot &slot = entries[index & (TRACE_RING_SIZE - 1)];
+
+    slot.sequence.store(2 * index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot.transactionId.store(transactionId, memory_order_relaxed);
+    slot.timestampNs.store(timestampNs, memory_order_relaxed);
+    slot.address.store(address, memory_order_relaxed);
+    slot.pointAndThread.store(static_cast<uint32_t>(point) | (currentTraceThread() << 8), memory_order_relaxed);
+    slot.sequence.store(2 * index + 2, memory_order_release);
+}
+
+vector<TraceEvent> TraceRing::snapshot() const {
+    vector<TraceEvent> events;
+    uint64_t end = writeIndex.load(memory_order_acquire);
+    uint64_t begin = end > TRACE_RING_SIZE ? end - TRACE_RING_SIZE : 0;
+    events.reserve(static_cast<size_t>(end - begin));
+
+    for (uint64_t index = begin; index < end; ++index) {
+        const Slot &slot = entries[index & (TRACE_RING_SIZE - 1)];
+
+        // Si el hueco se está escribiendo o ya es de otra vuelta, el evento se descarta
+        uint64_t before = slot.sequence.load(memory_order_acquire);
+        if (before != 2 * index + 2) continue;
+
+        TraceEvent event;
+        event.transactionId = slot.transactionId.load(memory_order_relaxed);
+        event.timestampNs = slot.timestampNs.load(memory_order_relaxed);
+        event.address = slot.address.load(memory_order_relaxed);
+        uint32_t pointAndThread = slot.pointAndThread.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.sequence.load(memory_order_relaxed) != before) continue;
+
+        event.point = static_cast<TRACEPOINT>(pointAndThread & 0xFF);
+        event.thread = pointAndThread >> 8;
+        events.push_back(event);
+    }
+    return events;
+}
+
+int64_t traceNow() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void traceEvent(uint64_t transactionId, int address, TRACEPOINT point) {
+    if (!tracingActive.load(memory_order_relaxed) || transactionId == 0) return; // 0 son resultados de la caché
+    traceRing().record(transactionId, address, point, traceNow());
+}
+
+void traceEventAt(uint64_t transactionId, int address, TRACEPOINT point, int64_t timestampNs) {
+    if (!tracingActive.load(memory_order_relaxed) || transactionId == 0 || timestampNs == 0) return;
+    traceRing().record(transactionId, address, point, timestampNs);
+}
+
+void setTracingEnabled(bool enabled) {
+    tracingActive = enabled;
+}
+
+bool tracingEnabled() {
+    return tracingActive;
+}
+
+const char *tracePointName(TRACEPOINT point) {
+    switch (point) {
+    case TRACE_ENQUEUE: return "enqueue";
+    case TRACE_WRITE_COMPLETE: return "queued";      // Encolada hasta que sale por el puerto
+    case TRACE_FIRST_RX: return "turnaround";        // Tiempo de respuesta del sensor (y del adaptador USB)
+    case TRACE_FRAME_COMPLETE: return "receive";     // Desde el primer byte hasta la trama completa
+    case TRACE_VALIDATED: return "validate";         // Formato, CRC y status
+    case TRACE_UI_APPLIED: return "ui";              // Vuelta al hilo de la UI y callback
+    default: return "unknown";
+    }
+}
+
+struct TracedTransaction { // Marcas de una transacción reconstruidas a partir de los eventos
+    int address = 0;
+    array<int64_t, TRACE_POINTS> timestamps = {}; // 0 si esa fase no se apuntó
+};
+
+static map<uint64_t, TracedTransaction> groupByTransaction(const vector<TraceEvent> &events) {
+    map<uint64_t, TracedTransaction> transactions;
+    for (const TraceEvent &event : events) {
+        TracedTransaction &transaction = transactions[event.transactionId];
+        transaction.address = event.address;
+        transaction.timestamps[event.point] = event.timestampNs;
+    }
+    return transactions;
+}
+
+static TracePhaseStats phaseStats(vector<double> samplesUs) {
+    TracePhaseStats stats;
+    if (samplesUs.empty()) return stats;
+
+    sort(samplesUs.begin(), samplesUs.end());
+    double sum = 0;
+    for (double sample : samplesUs) sum += sample;
+
+    stats.count = samplesUs.size();
+    stats.meanUs = sum / samplesUs.size();
+    stats.p50Us = samplesUs[(samplesUs.size() - 1) / 2];
+    stats.p99Us = samplesUs[static_cast<size_t>((samplesUs.size() - 1) * 0.99)];
+    stats.maxUs = samplesUs.back();
+    return stats;
+}
+
+vector<AddressLatency> traceLatencyByAddress() {
+    map<uint64_t, TracedTransaction> transactions = groupByTransaction(traceRing().snapshot());
+
+    // Muestras por registro: el total y cada fase desde la anterior que se apuntó (una lectura fallida no tiene todas)
+    struct Samples {
+        vector<double> total;
+        array<vector<double>, TRACE_POINTS> phases;
+    };
+    map<int, Samples> byAddress;
+
+    for (const auto &entry : transactions) {
+        const TracedTransaction &transaction = entry.second;
+        if (transaction.timestamps[TRACE_ENQUEUE] == 0) continue; // Se encoló antes de lo que guarda el buffer
+
+        Samples &samples = byAddress[transaction.address];
+        int64_t previous = transaction.timestamps[TRACE_ENQUEUE];
+        for (int point = TRACE_WRITE_COMPLETE; point < TRACE_POINTS; ++point) {
+            int64_t timestamp = transaction.timestamps[point];
+            if (timestamp == 0) continue;
+            samples.phases[point].push_back((timestamp - previous) / 1000.0);
+            previous = timestamp;
+        }
+        samples.total.push_back((previous - transaction.timestamps[TRACE_ENQUEUE]) / 1000.0);
+    }
+
+    vector<AddressLatency> result;
+    for (auto &entry : byAddress) {
+        AddressLatency latency;
+        latency.address = entry.first;
+        latency.total = phaseStats(entry.second.total);
+        for (int point = TRACE_WRITE_COMPLETE; point < TRACE_POINTS; ++point) {
+            latency.phases[point] = phaseStats(entry.second.phases[point]);
+        }
+        result.push_back(latency);
+    }
+    return result;
+}
+
+string formatTraceBreakdown() {
+    ostringstream out;
+    out.setf(ios::fixed);
+    out.precision(3);
+
+    vector<AddressLatency> latencies = traceLatencyByAddress();
+    if (latencies.empty()) {
+        out << "No traced transactions.\n";
+        return out.str();
+    }
+
+    for (const AddressLatency &latency : latencies) {
+        char address[16];
+        snprintf(address, sizeof(address), "0x%03X", latency.address);
+        out << "Register " << address << ": " << latency.total.count << " transactions, total p50 "
+            << latency.total.p50Us / 1000.0 << " ms, p99 " << latency.total.p99Us / 1000.0 << " ms, max "
+            << latency.total.maxUs / 1000.0 << " ms | mean";
+        for (int point = TRACE_WRITE_COMPLETE; point < TRACE_POINTS; ++point) {
+            out << " " << tracePointName(static_cast<TRACEPOINT>(point)) << " " << latency.phases[point].meanUs / 1000.0 << " ms";
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+bool exportChromeTrace(const string &path) {
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    vector<TraceEvent> events = traceRing().snapshot();
+    map<uint64_t, TracedTransaction> transactions = groupByTransaction(events);
+    int64_t origin = events.empty() ? 0 : events.front().timestampNs;
+    for (const TraceEvent &event : events) origin = min(origin, event.timestampNs);
+
+    // Una fila por registro (tid = dirección): la transacción entera y debajo cada fase
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool first = true;
+    map<int, bool> namedRows;
+    for (const auto &entry : transactions) {
+        const TracedTransaction &transaction = entry.second;
+        if (!namedRows[transaction.address]) {
+            namedRows[transaction.address] = true;
+            fprintf(file, "%s  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"Register 0x%03X\"}}",
+                    first ? "" : ",\n", transaction.address, transaction.address);
+            first = false;
+        }
+
+        int64_t start = 0;
+        int64_t previous = 0;
+        for (int point = TRACE_ENQUEUE; point < TRACE_POINTS; ++point) {
+            int64_t timestamp = transaction.timestamps[point];
+            if (timestamp == 0) continue;
+            if (previous != 0) {
+                fprintf(file, ",\n  {\"name\": \"%s\", \"cat\": \"phase\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, "
+                              "\"args\": {\"id\": %llu}}",
+                        tracePointName(static_cast<TRACEPOINT>(point)), transaction.address, (previous - origin) / 1000.0,
+                        (timestamp - previous) / 1000.0, static_cast<unsigned long long>(entry.first));
+            } else {
+                start = timestamp;
+            }
+            previous = timestamp;
+        }
+
+        if (start != 0 && previous != start) {
+            fprintf(file, ",\n  {\"name\": \"transaction %llu\", \"cat\": \"transaction\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+                          "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"address\": \"0x%03X\"}}",
+                    static_cast<unsigned long long>(entry.first), transaction.address, (start - origin) / 1000.0,
+                    (previous - start) / 1000.0, transaction.address);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return true;
+}
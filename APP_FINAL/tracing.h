@@ -0,0 +1,80 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+// Trazas de latencia por transacción: cada fase apunta una marca de tiempo en un buffer circular sin locks
+// Se pueden exportar como JSON de Chrome (chrome://tracing o ui.perfetto.dev) y resumir por dirección de registro
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define TRACE_RING_SIZE 16384 // Eventos que se guardan (potencia de 2), los más antiguos se van pisando
+#define TRACE_POINTS 6 // Número de fases de TRACEPOINT
+
+enum TRACEPOINT { // Fases de una transacción, en el orden en que ocurren
+    TRACE_ENQUEUE = 0,        // El manejador la encola (hilo de la UI)
+    TRACE_WRITE_COMPLETE = 1, // La petición ha salido por el puerto (waitForBytesWritten)
+    TRACE_FIRST_RX = 2,       // Llega el primer byte de su respuesta
+    TRACE_FRAME_COMPLETE = 3, // La trama de respuesta está completa
+    TRACE_VALIDATED = 4,      // Formato, CRC y status comprobados
+    TRACE_UI_APPLIED = 5      // La UI ha procesado el resultado
+};
+
+struct TraceEvent { // Una marca de tiempo de una fase
+    uint64_t transactionId = 0; // Identificador de la transacción (el del manejador)
+    int address = 0;            // Registro de la transacción
+    TRACEPOINT point = TRACE_ENQUEUE; // Fase
+    int64_t timestampNs = 0;    // Reloj monotónico (ns)
+    uint32_t thread = 0;        // Hilo que la apuntó (numerado por orden de aparición)
+};
+
+struct TracePhaseStats { // Estadística de una fase para un registro
+    uint64_t count = 0; // Transacciones que pasaron por ella
+    double meanUs = 0;
+    double p50Us = 0;
+    double p99Us = 0;
+    double maxUs = 0;
+};
+
+struct AddressLatency { // Desglose de latencia de un registro
+    int address = 0;
+    TracePhaseStats total; // Desde que se encola hasta la última fase registrada
+    array<TracePhaseStats, TRACE_POINTS> phases; // phases[i]: desde la fase anterior hasta la fase i (phases[0] no se usa)
+};
+
+class TraceRing { // Buffer circular multi-productor sin locks, cada hueco es un seqlock
+public:
+    TraceRing(); // Constructor
+
+    void record(uint64_t transactionId, int address, TRACEPOINT point, int64_t timestampNs); // Desde cualquier hilo
+    vector<TraceEvent> snapshot() const; // Copia los eventos que siguen en el buffer, ignorando los que se estén escribiendo
+
+private:
+    struct Slot {
+        atomic<uint64_t> sequence;      // 2*n+1 mientras se escribe el evento n, 2*n+2 cuando está completo
+        atomic<uint64_t> transactionId;
+        atomic<int64_t> timestampNs;
+        atomic<int32_t> address;
+        atomic<uint32_t> pointAndThread; // Fase en los 8 bits bajos, hilo en el resto
+    };
+
+    array<Slot, TRACE_RING_SIZE> entries;
+    atomic<uint64_t> writeIndex; // Siguiente evento a escribir
+};
+
+int64_t traceNow(); // Reloj de las trazas (ns, monotónico)
+void traceEvent(uint64_t transactionId, int address, TRACEPOINT point); // Apunta una fase ahora
+void traceEventAt(uint64_t transactionId, int address, TRACEPOINT point, int64_t timestampNs); // Apunta una fase ocurrida antes
+void setTracingEnabled(bool enabled); // Activa o desactiva las trazas (activadas por defecto, cuestan unos pocos ns)
+bool tracingEnabled(); // Si las trazas están activas
+
+const char *tracePointName(TRACEPOINT point); // Nombre de la fase que acaba en point (queued, turnaround, ...)
+vector<AddressLatency> traceLatencyByAddress(); // Desglose por registro de lo que hay en el buffer
+string formatTraceBreakdown(); // El desglose en texto, una línea por registro, para los logs
+bool exportChromeTrace(const string &path); // Guarda el buffer como trace-event JSON de Chrome
+
+#endif // TRACING_H
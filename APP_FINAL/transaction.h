@@ -0,0 +1,70 @@
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include "packetcodec.h"
+
+// Tipos compartidos entre la UI, el manejador y el hilo serie para describir una transacción petición/respuesta
+
+using namespace std;
+
+enum TRANSACTIONTYPE { // Tipos de transacción con el sensor
+    READ_TRANSACTION = 0, WRITE_TRANSACTION = 1
+};
+
+enum TRANSACTIONPRIORITY { // Clases del planificador del manejador, de más a menos urgente
+    PRIORITY_INTERACTIVE_WRITE = 0, // Escrituras que pide el usuario (writeVariable)
+    PRIORITY_INTERACTIVE_READ = 1,  // Lecturas sueltas que espera la UI
+    PRIORITY_BACKGROUND = 2,        // Comprobaciones periódicas (heartbeat)
+    PRIORITY_BULK = 3               // Lecturas por lotes y volcados largos
+};
+
+#define PRIORITY_CLASSES 4 // Valores de TRANSACTIONPRIORITY
+
+enum TRANSACTIONSTATUS { // Resultado de una transacción, para que la UI sepa qué mensaje mostrar
+    TRANSACTION_OK = 0,         // Respuesta válida con status OK
+    TRANSACTION_SEND_ERROR = 1, // No se pudo escribir en el puerto (cerrado o error de escritura)
+    TRANSACTION_TIMEOUT = 2,    // No llegó ninguna respuesta a tiempo
+    TRANSACTION_BAD_FORMAT = 3, // Llegaron bytes pero no forman una trama correcta
+    TRANSACTION_BAD_CRC = 4,    // Trama completa pero con CRC incorrecto
+    TRANSACTION_NOTOK = 5,      // El sensor respondió con status NOTOK
+    TRANSACTION_CANCELLED = 6   // Se canceló antes de enviarse (desconexión, cancel, otra escritura la reemplazó o venció su plazo)
+};
+
+struct TransactionResult { // Lo que se devuelve a la UI al terminar una transacción
+    uint64_t id = 0; // Identificador de la petición (el que devolvió el manejador al encolarla)
+    TRANSACTIONTYPE type = READ_TRANSACTION; // Lectura o escritura
+    int address = 0; // Registro al que iba dirigida
+    TRANSACTIONSTATUS status = TRANSACTION_OK; // Cómo ha ido
+    uint32_t value = 0; // Valor leído (o confirmado en escritura), solo válido si status es OK
+    bool fromCache = false; // El valor sale de la caché de registros, no se ha tocado el cable
+    Response response; // Respuesta en bruto para los logs (array fijo, no reserva memoria)
+    int responseSize = 0; // Bytes recibidos en response (0 si no llegó nada, menos de 8 si llegó incompleta)
+    int retries = 0; // Reintentos que hicieron falta (el resultado es el del último intento)
+};
+
+typedef function<void(const TransactionResult&)> TransactionCallback; // Se ejecuta siempre en el hilo de la UI
+typedef map<int, TransactionResult> RegisterResults; // Resultado de una lectura por lotes, por dirección de registro
+typedef function<void(const RegisterResults&)> BatchCallback; // Se ejecuta una vez en el hilo de la UI cuando han terminado todas
+
+struct Transaction { // Petición pendiente en la cola del hilo serie
+    uint64_t id = 0; // Identificador único
+    TRANSACTIONTYPE type = READ_TRANSACTION; // Lectura o escritura
+    int address = 0; // Registro a leer o escribir
+    uint32_t value = 0; // Valor a escribir (solo escritura), el codec lo pasa a big endian
+    bool pipelined = false; // Lectura que puede ir en ráfaga junto a otras sin esperar cada respuesta (lecturas masivas)
+    int retries = 0; // Reintentos ya hechos, lo lleva el hilo serie (o el reactor) al volver a encolarla
+    TRANSACTIONPRIORITY priority = PRIORITY_INTERACTIVE_READ; // Clase en el planificador del manejador
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max(); // Si no ha salido para entonces ya no sirve (max = sin plazo)
+    TransactionCallback callback; // A quién avisar con el resultado
+};
+
+inline bool isRetryable(TRANSACTIONSTATUS status) { // Fallos del enlace que un nuevo intento puede arreglar
+    return status == TRANSACTION_TIMEOUT || status == TRANSACTION_BAD_CRC || status == TRANSACTION_BAD_FORMAT || status == TRANSACTION_NOTOK;
+}
+
+#endif // TRANSACTION_H
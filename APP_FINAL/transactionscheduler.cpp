@@ -0,0 +1,94 @@
+#include "transactionscheduler.h"
+#include <algorithm>
+
+using namespace std;
+
+void TransactionScheduler::push(const Transaction &transaction, vector<Transaction> &superseded) {
+    if (transaction.type == WRITE_TRANSACTION) {
+        // Solo cuenta el último valor: la escritura anterior al mismo registro que aún no ha salido ya no hace falta
+        for (deque<Transaction> &queue : queues) {
+            for (auto entry = queue.begin(); entry != queue.end();) {
+                if (entry->type == WRITE_TRANSACTION && entry->address == transaction.address) {
+                    superseded.push_back(*entry);
+                    entry = queue.erase(entry);
+                } else {
+                    ++entry;
+                }
+            }
+        }
+    }
+    queues[transaction.priority].push_back(transaction);
+}
+
+bool TransactionScheduler::pop(chrono::steady_clock::time_point now, Transaction &next, vector<Transaction> &expired) {
+    for (deque<Transaction> &queue : queues) {
+        // Primero se quita lo que ya no llega a tiempo, después se elige el plazo más cercano (max, sin plazo, va al final)
+        for (auto entry = queue.begin(); entry != queue.end();) {
+            if (entry->deadline <= now) {
+                expired.push_back(*entry);
+                entry = queue.erase(entry);
+            } else {
+                ++entry;
+            }
+        }
+        if (queue.empty()) continue;
+
+        auto chosen = queue.begin();
+        for (auto entry = queue.begin() + 1; entry != queue.end(); ++entry) {
+            if (entry->deadline < chosen->deadline) chosen = entry;
+        }
+        next = *chosen;
+        queue.erase(chosen);
+        return true;
+    }
+    return false;
+}
+
+bool TransactionScheduler::cancel(uint64_t id, Transaction &cancelled) {
+    for (deque<Transaction> &queue : queues) {
+        for (auto entry = queue.begin(); entry != queue.end(); ++entry) {
+            if (entry->id == id) {
+                cancelled = *entry;
+                queue.erase(entry);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool TransactionScheduler::adopt(uint64_t id, TRANSACTIONPRIORITY priority, chrono::steady_clock::time_point deadline) {
+    for (deque<Transaction> &queue : queues) {
+        for (auto entry = queue.begin(); entry != queue.end(); ++entry) {
+            if (entry->id != id) continue;
+
+            entry->deadline = max(entry->deadline, deadline); // Mientras alguien la siga queriendo no caduca
+            if (priority < entry->priority) {
+                // Pasa al final de la clase más urgente, como si hubiera llegado ahora con esa prioridad
+                Transaction promoted = *entry;
+                promoted.priority = priority;
+                queue.erase(entry);
+                queues[priority].push_back(promoted);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+vector<Transaction> TransactionScheduler::takeAll() {
+    vector<Transaction> all;
+    for (deque<Transaction> &queue : queues) {
+        all.insert(all.end(), queue.begin(), queue.end());
+        queue.clear();
+    }
+    return all;
+}
+
+size_t TransactionScheduler::size() const {
+    size_t total = 0;
+    for (const deque<Transaction> &queue : queues) {
+        total += queue.size();
+    }
+    return total;
+}
@@ -0,0 +1,33 @@
+#ifndef TRANSACTIONSCHEDULER_H
+#define TRANSACTIONSCHEDULER_H
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include "transaction.h"
+
+// Cola con prioridades del manejador: las transacciones esperan aquí y solo unas pocas pasan al hilo serie (o al reactor),
+// así una escritura del usuario nunca se queda detrás de un volcado largo que ya estuviera encolado
+// Se saca siempre de la clase más urgente y, dentro de ella, la de plazo más cercano (a igual plazo, por orden de llegada)
+// Solo se usa desde el hilo de la UI (los callbacks del manejador llegan ahí), así que no necesita mutex
+
+using namespace std;
+
+class TransactionScheduler {
+public:
+    // Encola; una escritura reemplaza a la que siga en cola para el mismo registro, que se devuelve en superseded para cancelarla
+    void push(const Transaction &transaction, vector<Transaction> &superseded);
+    // Saca la siguiente a enviar; las que vencieron su plazo sin salir se quitan y se devuelven en expired para cancelarlas
+    bool pop(chrono::steady_clock::time_point now, Transaction &next, vector<Transaction> &expired);
+    bool cancel(uint64_t id, Transaction &cancelled); // Quita una que aún no ha salido (false si ya salió o no existe)
+    // Otra petición se ha unido a una que aún no ha salido: sube a la clase más urgente de las dos y se queda con el plazo más largo
+    bool adopt(uint64_t id, TRANSACTIONPRIORITY priority, chrono::steady_clock::time_point deadline);
+    vector<Transaction> takeAll(); // Vacía la cola (cierre del puerto), en orden de prioridad
+    size_t size() const; // Transacciones en cola
+
+private:
+    array<deque<Transaction>, PRIORITY_CLASSES> queues; // Una cola por clase, en orden de llegada
+};
+
+#endif // TRANSACTIONSCHEDULER_H
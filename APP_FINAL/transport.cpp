@@ -0,0 +1,270 @@
+#include "transport.h"
+
+#ifdef __linux__
+
+#include "values.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+static bool hasPrefix(const string &name, const char *prefix) {
+    return name.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// connect sin bloquear más de RESPONSE_TIMEOUT: el reactor abre desde el hilo de la UI y un puente caído la dejaría colgada
+// hasta el timeout de TCP del kernel (el socket ya viene con O_NONBLOCK)
+static bool connectWithTimeout(int fd, const sockaddr *address, socklen_t length) {
+    if (connect(fd, address, length) == 0) return true;
+    if (errno != EINPROGRESS) return false;
+
+    pollfd descriptor = {fd, POLLOUT, 0};
+    int ready;
+    do {
+        ready = poll(&descriptor, 1, RESPONSE_TIMEOUT);
+    } while (ready < 0 && errno == EINTR);
+    if (ready == 0) errno = ETIMEDOUT;
+    if (ready <= 0) return false;
+
+    int error = 0;
+    socklen_t errorLength = sizeof(error);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) != 0) return false;
+    errno = error;
+    return error == 0;
+}
+
+PosixTransport::PosixTransport() : fd(-1), healthy(false), isSocket(false) {
+}
+
+PosixTransport::~PosixTransport() {
+    // close() es virtual pero aquí ya no se puede llamar a release() de la clase hija, cada backend cierra en su close
+    if (fd >= 0) ::close(fd);
+}
+
+void PosixTransport::close() {
+    if (fd < 0) return;
+    release();
+    ::close(fd);
+    fd = -1;
+    healthy = false;
+}
+
+bool PosixTransport::isOpen() const {
+    return fd >= 0;
+}
+
+bool PosixTransport::isHealthy() const {
+    return fd >= 0 && healthy;
+}
+
+int PosixTransport::pollFd() const {
+    return fd;
+}
+
+string PosixTransport::errorString() const {
+    return lastError;
+}
+
+bool PosixTransport::fail(const string &reason) {
+    lastError = reason;
+    bool wasHealthy = healthy;
+    healthy = false;
+    if (wasHealthy && linkLost) linkLost(reason);
+    return false;
+}
+
+bool PosixTransport::failErrno(const string &what) {
+    return fail(what + ": " + strerror(errno));
+}
+
+int PosixTransport::writeSome(const uint8_t *data, size_t size) {
+    if (fd < 0) return -1;
+
+    while (true) {
+        // En un socket sin MSG_NOSIGNAL un otro lado ya cerrado mataría la app con SIGPIPE
+        ssize_t written = isSocket ? send(fd, data, size, MSG_NOSIGNAL) : ::write(fd, data, size);
+        if (written >= 0) return static_cast<int>(written);
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        failErrno("Error writing to " + string(isSocket ? "the socket" : "the serial port"));
+        return -1;
+    }
+}
+
+bool PosixTransport::write(const uint8_t *data, size_t size, int timeoutMs) {
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    size_t sent = 0;
+
+    while (sent < size) {
+        int written = writeSome(data + sent, size - sent);
+        if (written < 0) return false;
+        sent += static_cast<size_t>(written);
+        if (sent == size) break;
+
+        // No cabe más, se espera a que el dispositivo tenga sitio sin pasarse del plazo
+        int remaining = static_cast<int>(chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count());
+        if (remaining <= 0) {
+            lastError = "Timeout when writing.";
+            return false;
+        }
+        pollfd descriptor = {fd, POLLOUT, 0};
+        if (poll(&descriptor, 1, remaining) < 0 && errno != EINTR) return failErrno("Error waiting to write");
+    }
+    return true;
+}
+
+int PosixTransport::read(uint8_t *buffer, size_t size, int timeoutMs) {
+    if (fd < 0) return -1;
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+
+    while (true) {
+        ssize_t received = ::read(fd, buffer, size);
+        if (received > 0) return static_cast<int>(received);
+        if (received == 0 && isSocket) {
+            fail("The other end closed the connection.");
+            return -1;
+        }
+        if (received < 0 && errno == EINTR) continue;
+        if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            failErrno("Error reading from " + string(isSocket ? "the socket" : "the serial port")); // EIO al quitar el adaptador o cerrar el pty
+            return -1;
+        }
+
+        int remaining = static_cast<int>(chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count());
+        if (remaining <= 0) return 0;
+
+        pollfd descriptor = {fd, POLLIN, 0};
+        int ready = poll(&descriptor, 1, remaining);
+        if (ready < 0 && errno != EINTR) {
+            failErrno("Error waiting for data");
+            return -1;
+        }
+        if (ready > 0 && (descriptor.revents & (POLLERR | POLLNVAL))) {
+            fail("The device reported an error.");
+            return -1;
+        }
+        // Con POLLHUP se vuelve a leer: lo que quedara se entrega y después read da el error o el fin
+    }
+}
+
+TermiosTransport::~TermiosTransport() {
+    close(); // Aquí release() todavía es el de esta clase, así el puerto queda como estaba
+}
+
+bool TermiosTransport::open(const string &name) {
+    close();
+    string path = hasPrefix(name, TRANSPORT_TERMIOS_PREFIX) ? name.substr(strlen(TRANSPORT_TERMIOS_PREFIX)) : name;
+    if (!path.empty() && path[0] != '/') path = "/dev/" + path; // Los nombres de la lista de puertos vienen sin /dev (ttyUSB0)
+
+    // Lo mismo que configura SerialManager::configurePort (115200 8N1, sin control de flujo), en crudo y sin bloquear
+    fd = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return failErrno("Could not open " + path);
+
+    if (tcgetattr(fd, &original) != 0) {
+        failErrno("Could not read the settings of " + path);
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    termios settings = original;
+    cfmakeraw(&settings); // 8 bits de datos, sin paridad y sin ningún procesado de caracteres
+    cfsetispeed(&settings, B115200);
+    cfsetospeed(&settings, B115200);
+    settings.c_cflag |= CLOCAL | CREAD;
+    settings.c_cflag &= ~(CSTOPB | CRTSCTS); // 1 bit de parada, sin control de flujo
+    settings.c_cc[VMIN] = 0;
+    settings.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &settings) != 0) {
+        failErrno("Could not configure " + path);
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    tcflush(fd, TCIOFLUSH); // Lo que hubiera en los buffers no es respuesta a nada nuestro
+
+    isSocket = false;
+    healthy = true;
+    lastError.clear();
+    return true;
+}
+
+void TermiosTransport::release() {
+    tcsetattr(fd, TCSANOW, &original);
+}
+
+bool SocketTransport::open(const string &name) {
+    close();
+
+    if (hasPrefix(name, TRANSPORT_UNIX_PREFIX)) {
+        string path = name.substr(strlen(TRANSPORT_UNIX_PREFIX));
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) return fail("Invalid socket path " + path);
+        memcpy(address.sun_path, path.c_str(), path.size());
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return failErrno("Could not create the socket");
+        if (!connectWithTimeout(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address))) {
+            failErrno("Could not connect to " + path);
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+    } else if (hasPrefix(name, TRANSPORT_TCP_PREFIX)) {
+        // tcp:puerto va a esta misma máquina, tcp:host:puerto a donde diga (el último ':' separa el puerto)
+        string target = name.substr(strlen(TRANSPORT_TCP_PREFIX));
+        size_t separator = target.rfind(':');
+        string host = separator == string::npos ? TRANSPORT_TCP_DEFAULT_HOST : target.substr(0, separator);
+        string port = separator == string::npos ? target : target.substr(separator + 1);
+
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *addresses = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0 || !addresses) return fail("Could not resolve " + target);
+
+        for (addrinfo *address = addresses; address && fd < 0; address = address->ai_next) {
+            fd = socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address->ai_protocol);
+            if (fd >= 0 && !connectWithTimeout(fd, address->ai_addr, address->ai_addrlen)) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        if (fd < 0) return failErrno("Could not connect to " + target);
+
+        // Las tramas son de 8 y 12 bytes: sin esto Nagle retiene cada petición esperando el ACK de la anterior
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    } else {
+        return fail("Unknown socket address " + name);
+    }
+
+    // A partir de aquí funciona igual que el puerto serie
+    isSocket = true;
+    healthy = true;
+    lastError.clear();
+    return true;
+}
+
+bool isPosixTransportName(const string &name) {
+    return hasPrefix(name, TRANSPORT_TERMIOS_PREFIX) || hasPrefix(name, TRANSPORT_TCP_PREFIX) || hasPrefix(name, TRANSPORT_UNIX_PREFIX);
+}
+
+unique_ptr<Transport> createPosixTransport(const string &name) {
+    if (hasPrefix(name, TRANSPORT_TCP_PREFIX) || hasPrefix(name, TRANSPORT_UNIX_PREFIX)) {
+        return unique_ptr<Transport>(new SocketTransport);
+    }
+    return unique_ptr<Transport>(new TermiosTransport);
+}
+
+#endif // __linux__
@@ -0,0 +1,90 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+// Capa de transporte bajo SerialManager y el reactor: lo único que necesita el protocolo es abrir, cerrar, escribir,
+// leer con un plazo y un descriptor para esperar con poll/epoll, así el mismo código va por un puerto serie, un pty o un socket
+// Este fichero no usa Qt: los backends POSIX (termios y sockets) sirven también para el reactor, el benchmark y los equipos sin Qt
+// El backend con QSerialPort está en qserialtransport.h
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+typedef function<void(const string&)> TransportLostHandler; // El transporte ha dado un error irrecuperable (se avisa una vez)
+
+class Transport {
+public:
+    virtual ~Transport() {} // Destructor
+
+    virtual bool open(const string &name) = 0; // Abre y configura (115200 8N1 sin control de flujo en los puertos serie)
+    virtual void close() = 0; // Cierra y deja el dispositivo como estaba
+    virtual bool isOpen() const = 0; // Hay algo abierto
+    virtual bool isHealthy() const = 0; // Abierto y sin errores irrecuperables
+    virtual bool write(const uint8_t *data, size_t size, int timeoutMs) = 0; // Escribe todo, esperando como mucho timeoutMs a que quepa
+    virtual int writeSome(const uint8_t *data, size_t size) = 0; // Escribe lo que quepa sin esperar (bytes escritos, 0 si no cabe nada, -1 error)
+    virtual int read(uint8_t *buffer, size_t size, int timeoutMs) = 0; // Espera hasta timeoutMs a que haya algo y lo lee (bytes, 0 si no llegó nada, -1 error)
+    virtual int pollFd() const = 0; // Descriptor para esperar con poll/epoll (-1 si no hay), nunca para leer por fuera del transporte
+    virtual string errorString() const = 0; // Último error
+
+    void setLinkLostHandler(TransportLostHandler handler) { linkLost = handler; } // A quién avisar cuando el transporte se pierde
+
+protected:
+    TransportLostHandler linkLost; // Aviso de transporte perdido
+};
+
+#ifdef __linux__
+
+#include <termios.h>
+
+class PosixTransport : public Transport { // Lo común a los backends con un descriptor no bloqueante
+public:
+    PosixTransport(); // Constructor
+    ~PosixTransport(); // Destructor, cierra si sigue abierto
+
+    void close() override;
+    bool isOpen() const override;
+    bool isHealthy() const override;
+    bool write(const uint8_t *data, size_t size, int timeoutMs) override;
+    int writeSome(const uint8_t *data, size_t size) override;
+    int read(uint8_t *buffer, size_t size, int timeoutMs) override;
+    int pollFd() const override;
+    string errorString() const override;
+
+protected:
+    virtual void release() {} // Lo propio de cada backend antes de cerrar el descriptor (restaurar el termios)
+    bool fail(const string &reason); // Apunta el error, avisa la primera vez y devuelve false
+    bool failErrno(const string &what); // fail con el texto de errno
+
+    int fd;            // Descriptor no bloqueante, -1 si está cerrado
+    bool healthy;      // Sin errores irrecuperables desde que se abrió
+    bool isSocket;     // En un socket leer 0 bytes es que el otro lado cerró, en un tty solo que no hay nada
+    string lastError;  // Último error
+};
+
+class TermiosTransport : public PosixTransport { // Puerto serie (o pty) en crudo con termios, sin el plugin de Qt
+public:
+    ~TermiosTransport(); // Destructor, restaura el puerto si sigue abierto
+
+    bool open(const string &name) override; // Ruta del dispositivo, con o sin TRANSPORT_TERMIOS_PREFIX
+
+protected:
+    void release() override;
+
+private:
+    termios original; // Configuración anterior del puerto, se restaura al cerrar
+};
+
+class SocketTransport : public PosixTransport { // Puente TCP (tipo ser2net) o socket Unix hacia un emulador local
+public:
+    bool open(const string &name) override; // tcp:puerto, tcp:host:puerto o unix:ruta
+};
+
+bool isPosixTransportName(const string &name); // El nombre lleva un prefijo de transporte POSIX (termios:, tcp: o unix:)
+unique_ptr<Transport> createPosixTransport(const string &name); // Sockets por su prefijo, cualquier otro nombre con termios
+
+#endif // __linux__
+
+#endif // TRANSPORT_H
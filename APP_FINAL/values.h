@@ -23,9 +23,61 @@ using namespace std;
 #define INT_TIME_ADDRESS 0x098 // Dirección de memoria correspondiente a TINT
 #define INT_PERIOD_ADDRESS 0x094 // Dirección de memoria correspondiente a TFRAME
 #define GPOL_ADDRESS 0x090 // Dirección de memoria correspondiente a GPOL
+#define MCK_ADDRESS 0x028 // Dirección de memoria correspondiente al MCK (igual que MCKREGISTER, en numérico)
+#define OUTPUT_ADDRESS 0x0B0 // Dirección de memoria correspondiente al OUTPUT (igual que OUTPUTREGISTER, en numérico)
 
 #define WRITE_PACKET_SIZE 12 // Tamaño de paquetes de escritura (y respuesta, ambos en bytes)
 #define READ_PACKET_SIZE 8 // Tamaño de paquetes de lectura (en bytes)
+#define RESPONSE_PACKET_SIZE 8 // Tamaño de paquetes de respuesta, tanto de lectura como de escritura (en bytes)
+#define RESPONSE_TIMEOUT 1000 // Tiempo máximo de espera para recibir una respuesta completa (en ms)
+#define PIPELINE_DEPTH 4 // Máximo de lecturas en vuelo a la vez en modo pipelining (1 = esperar cada respuesta)
+#define PIPELINE_MAX_DEPTH 16 // Límite de setPipelineDepth, la ráfaga se monta en un buffer fijo de este tamaño
+#define PIPELINE_DRAIN_TIME 20 // Silencio en la línea (ms) para darla por vaciada tras un fallo con lecturas en vuelo
+#define READ_FRAME_CACHE_SIZE 8 // Peticiones de lectura de registros custom que se guardan ya codificadas
+#define RX_BUFFER_SIZE 256 // Bytes que caben en el buffer de recepción del SerialManager (sobra para varias respuestas en vuelo)
+#define CACHE_MAX_AGE_TIME 2000 // Tiempo (ms) que se fía la caché de TINT, TFRAME y GPOL antes de volver a leerlos
+#define RTT_MIN_TIMEOUT 20 // Timeout mínimo (ms) de una respuesta aunque el sensor conteste mucho antes (margen para el USB y el sistema)
+#define RETRY_MAX 2 // Reintentos como mucho de una transacción que acaba en timeout, CRC incorrecto, trama incompleta o NOTOK
+#define SCHEDULER_WINDOWS 2 // Ráfagas que el planificador deja pasar al hilo serie: la que está en el cable y la siguiente ya montada
+#define LOG_MAX_LINES 1000 // Líneas que se quedan en la caja de logs, las más antiguas se van borrando
+#define LOG_DRAIN_INTERVAL 50 // Cada cuánto (ms) pasa la UI lo que haya en la cola de logs a la caja de texto
+#define LOG_DRAIN_BATCH 2000 // Máximo de líneas que se pintan en cada pasada, lo que sobre espera a la siguiente
+#define LOG_QUEUE_CAPACITY 100000 // Líneas que caben en la cola de logs antes de empezar a descartar
+#define LOG_LEVEL_VARIABLE "EOLE_LOG_LEVEL" // Variable de entorno con el nivel de los logs (trace, debug, info, warning, error, off)
+#define LOG_SEGMENT_PREFIX "EOLE_log_" // Nombre de los ficheros que va escribiendo el escritor continuo de logs en EOLE_logs
+#define LOG_FILE_BUFFER_SIZE 65536 // Bytes que se acumulan como mucho antes de escribir en el fichero de logs
+#define LOG_LINE_MAX_SIZE 1024 // Línea de log más larga que se espera (fecha y nivel incluidos), lo que se pasa el buffer antes de vaciarse
+#define LOG_FILE_MAX_SIZE (4 * 1024 * 1024) // Tamaño a partir del cual se pasa a un fichero de logs nuevo (en bytes)
+#define LOG_FILE_MAX_AGE 3600 // Tiempo a partir del cual se pasa a un fichero de logs nuevo (en segundos)
+#define LOG_DISK_BUDGET (64 * 1024 * 1024) // Espacio máximo para los ficheros de logs cerrados, se borran los más antiguos (en bytes)
+#define LOG_WRITER_POLL_TIME 50 // Cada cuánto (ms) mira el escritor de logs si hay líneas nuevas
+#define LOG_COMPRESSION_LEVEL 6 // Nivel de compresión de los ficheros de logs cerrados (0-9)
+#define METRICS_PORT_VARIABLE "EOLE_METRICS_PORT" // Variable de entorno con el puerto del endpoint de métricas (sin ella no se abre)
+#define METRICS_MAX_REQUEST_SIZE 8192 // Cabecera HTTP más larga que se acepta en el endpoint de métricas (en bytes)
+#define CAPTURE_VARIABLE "EOLE_CAPTURE" // Variable de entorno para capturar el tráfico serie en EOLE_logs (EOLE_CAPTURE=1)
+#define CAPTURE_MAP_SIZE (4 * 1024 * 1024) // Trozo del fichero de captura que se mapea en memoria cada vez (múltiplo del bloque)
+#define HOTPLUG_EVENT_SIZE 8192 // Tamaño máximo de un evento de hotplug del kernel o de udev (en bytes)
+#define HOTPLUG_FALLBACK_INTERVAL 1000 // Cada cuánto (ms) se enumeran los puertos si el sistema no avisa de los cambios
+#define HEARTBEAT_VARIABLE "EOLE_HEARTBEAT" // Variable de entorno con el intervalo (ms) de la lectura de comprobación con el puerto en reposo
+#define HEARTBEAT_MAX_MISSES 2 // Timeouts seguidos (de cualquier lectura o escritura) para dar el sensor por perdido con el heartbeat activo
+#define DISCOVERY_TIMEOUT 150 // Tiempo máximo (ms) que se espera la respuesta de un puerto al buscar sensores
+#define DISCOVERY_USB_IDS_VARIABLE "EOLE_USB_IDS" // Variable de entorno con los VID o VID:PID (hex, separados por comas) que se sondean, "*" para todos
+#define DISCOVERY_DEFAULT_USB_IDS "0403,10C4,067B,1A86" // Conversores USB-serie habituales (FTDI, Silicon Labs, Prolific, WCH)
+#define DISCOVERY_SETTINGS_ORGANIZATION "EOLEAPP" // QSettings donde se guarda la caché de puertos (mismo nombre que el instalador)
+#define DISCOVERY_SETTINGS_APPLICATION "EOLEAPP Toolkit" // Aplicación dentro de esa organización
+#define DISCOVERY_SETTINGS_GROUP "discovery" // Un subgrupo por puerto dentro de este
+#define REACTOR_VARIABLE "EOLE_SERIAL_BACKEND" // Variable de entorno para elegir el backend serie del manejador (solo Linux)
+#define REACTOR_BACKEND "epoll" // Valor que activa el reactor epoll (serialreactor.h) en lugar de un SerialWorker por puerto
+#define TRANSPORT_VARIABLE "EOLE_TRANSPORT" // Variable de entorno para elegir el transporte de los puertos serie (solo Linux)
+#define TRANSPORT_TERMIOS_BACKEND "termios" // Valor que usa termios en crudo en lugar de QSerialPort para todos los puertos serie
+#define TRANSPORT_TERMIOS_PREFIX "termios:" // Prefijo del nombre de puerto para abrir ese puerto con termios en crudo (termios:/dev/ttyUSB0)
+#define TRANSPORT_TCP_PREFIX "tcp:" // Prefijo del nombre de puerto para un puente TCP tipo ser2net (tcp:4001 o tcp:host:4001)
+#define TRANSPORT_UNIX_PREFIX "unix:" // Prefijo del nombre de puerto para un socket Unix, por ejemplo hacia el emulador (unix:/tmp/eole.sock)
+#define TRANSPORT_TCP_DEFAULT_HOST "127.0.0.1" // Host de tcp:puerto cuando no se indica
+#define LOW_LATENCY_VARIABLE "EOLE_LOW_LATENCY" // Variable de entorno para activar el modo de baja latencia de los puertos serie (EOLE_LOW_LATENCY=1, solo Linux)
+#define LOW_LATENCY_TIMER 1 // latency_timer (ms) que se pone a los adaptadores USB-serie en modo de baja latencia
+#define LOW_LATENCY_RTT_SAMPLES 5 // Lecturas del MCK para medir la ida y vuelta antes y después de activar la baja latencia (se da la mediana)
+#define TRANSPORT_ENDPOINTS_VARIABLE "EOLE_ENDPOINTS" // Variable de entorno con puertos tcp: o unix: (separados por comas) que se añaden a la lista
 
 #define TWO_VIDEO_OUTPUTS 2 // Si tiene 2 video outputs (tiene por default)
 #define FOUR_VIDEO_OUTPUTS 4 // Si tiene 4 video outputs (hay que forzar que tenga)